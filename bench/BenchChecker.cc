@@ -0,0 +1,83 @@
+
+#include "benchmark/benchmark.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/Support/Graph.hpp"
+
+#include "Inputs.hpp"
+
+using namespace bolt;
+
+static void checkWorkload(benchmark::State& State, WorkloadGenerator Generate) {
+  auto& Text = getWorkload(Generate, State.range(0));
+  LanguageConfig Config;
+  std::size_t UnificationCount = 0;
+  for (auto _: State) {
+    State.PauseTiming();
+    DiagnosticStore DS;
+    auto SF = parseWorkload(Text, DS);
+    Checker C { Config, DS };
+    State.ResumeTiming();
+    C.check(SF);
+    State.PauseTiming();
+    if (DS.countDiagnostics() > 0) {
+      State.SkipWithError("the generated program contains type errors");
+      break;
+    }
+    UnificationCount = C.getUnificationCount();
+    SF->unref();
+    State.ResumeTiming();
+  }
+  State.SetBytesProcessed(State.iterations() * Text.size());
+  State.SetComplexityN(Text.size());
+  State.counters["unifications"] = UnificationCount;
+}
+
+static void BM_Check(benchmark::State& State) {
+  checkWorkload(State, generateFunctions);
+}
+
+static void BM_Unify(benchmark::State& State) {
+  checkWorkload(State, generateTupleFunctions);
+}
+
+static void BM_CheckMixed(benchmark::State& State) {
+  checkWorkload(State, generateMixed);
+}
+
+/**
+ * Build a graph of \p Count vertices that are grouped in cycles of eight,
+ * where every cycle also points to the one before it.
+ */
+static Graph<std::size_t> buildCycles(std::size_t Count) {
+  Graph<std::size_t> G;
+  for (std::size_t I = 0; I < Count; I++) {
+    G.addVertex(I);
+    if (I % 8 == 7) {
+      G.addEdge(I, I - 7);
+    } else if (I + 1 < Count) {
+      G.addEdge(I, I + 1);
+    }
+    if (I >= 8) {
+      G.addEdge(I, I - 8);
+    }
+  }
+  return G;
+}
+
+static void BM_StrongConnect(benchmark::State& State) {
+  auto G = buildCycles(State.range(0));
+  for (auto _: State) {
+    benchmark::DoNotOptimize(G.strongconnect());
+  }
+  State.SetItemsProcessed(State.iterations() * State.range(0));
+}
+
+// Checking is a lot slower than parsing and never frees its types, so the
+// largest inputs would mostly measure the memory allocator.
+BENCHMARK(BM_Check)->RangeMultiplier(10)->Range(1 << 10, 10 << 20)->Unit(benchmark::kMillisecond)->Complexity(benchmark::oN);
+BENCHMARK(BM_Unify)->RangeMultiplier(10)->Range(1 << 10, 10 << 20)->Unit(benchmark::kMillisecond)->Complexity(benchmark::oN);
+BENCHMARK(BM_CheckMixed)->RangeMultiplier(10)->Range(1 << 10, 10 << 20)->Unit(benchmark::kMillisecond)->Complexity(benchmark::oN);
+BENCHMARK(BM_StrongConnect)->RangeMultiplier(10)->Range(1 << 6, 1 << 20)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,45 @@
+
+#include <sstream>
+
+#include "benchmark/benchmark.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/Evaluator.hpp"
+
+#include "Inputs.hpp"
+
+using namespace bolt;
+
+static void evaluateWorkload(benchmark::State& State, WorkloadGenerator Generate) {
+  auto& Text = getWorkload(Generate, State.range(0));
+  DiagnosticStore DS;
+  LanguageConfig Config;
+  auto SF = parseWorkload(Text, DS);
+  Checker C { Config, DS };
+  C.check(SF);
+  if (DS.countDiagnostics() > 0) {
+    State.SkipWithError("the generated program contains type errors");
+    return;
+  }
+  std::ostringstream Out;
+  for (auto _: State) {
+    Evaluator E { &C, Out };
+    Env GlobalEnv;
+    addBuiltins(GlobalEnv);
+    E.evaluate(SF, GlobalEnv);
+  }
+  State.SetBytesProcessed(State.iterations() * Text.size());
+}
+
+static void BM_Evaluate(benchmark::State& State) {
+  evaluateWorkload(State, generateFunctions);
+}
+
+static void BM_EvaluateCalls(benchmark::State& State) {
+  evaluateWorkload(State, generateCalls);
+}
+
+BENCHMARK(BM_Evaluate)->RangeMultiplier(10)->Range(1 << 10, 10 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EvaluateCalls)->RangeMultiplier(10)->Range(1 << 10, 10 << 20)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,115 @@
+
+#include "benchmark/benchmark.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/CSTVisitor.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/Scanner.hpp"
+#include "bolt/Parser.hpp"
+
+#include "Inputs.hpp"
+
+using namespace bolt;
+
+static void BM_Scan(benchmark::State& State) {
+  auto& Text = getWorkload(generateFunctions, State.range(0));
+  DiagnosticStore DS;
+  std::size_t TokenCount = 0;
+  for (auto _: State) {
+    TextFile File { "#<workload>", Text };
+    VectorStream<const ByteString, Char> Chars { Text, EOF };
+    Scanner S { DS, File, Chars };
+    for (;;) {
+      auto T = S.get();
+      auto Kind = T->getKind();
+      T->unref();
+      if (Kind == NodeKind::EndOfFile) {
+        break;
+      }
+    }
+    TokenCount = S.getTokenCount();
+  }
+  State.SetBytesProcessed(State.iterations() * Text.size());
+  State.counters["tokens"] = TokenCount;
+}
+
+static void BM_Punctuate(benchmark::State& State) {
+  auto& Text = getWorkload(generateFunctions, State.range(0));
+  DiagnosticStore DS;
+  for (auto _: State) {
+    TextFile File { "#<workload>", Text };
+    VectorStream<const ByteString, Char> Chars { Text, EOF };
+    Scanner S { DS, File, Chars };
+    Punctuator PT { S };
+    for (;;) {
+      auto T = PT.get();
+      auto Kind = T->getKind();
+      T->unref();
+      if (Kind == NodeKind::EndOfFile) {
+        break;
+      }
+    }
+  }
+  State.SetBytesProcessed(State.iterations() * Text.size());
+}
+
+static void BM_Parse(benchmark::State& State) {
+  auto& Text = getWorkload(generateFunctions, State.range(0));
+  DiagnosticStore DS;
+  for (auto _: State) {
+    auto SF = parseWorkload(Text, DS);
+    State.PauseTiming();
+    SF->unref();
+    State.ResumeTiming();
+  }
+  State.SetBytesProcessed(State.iterations() * Text.size());
+  State.SetComplexityN(Text.size());
+}
+
+struct RecursiveCountVisitor : public CSTVisitor<RecursiveCountVisitor> {
+  std::size_t Count = 0;
+  void visit(Node* N) {
+    Count++;
+    visitEachChild(N);
+  }
+};
+
+static void BM_Visit(benchmark::State& State) {
+  auto& Text = getWorkload(generateMixed, State.range(0));
+  DiagnosticStore DS;
+  auto SF = parseWorkload(Text, DS);
+  for (auto _: State) {
+    RecursiveCountVisitor V;
+    V.visit(SF);
+    benchmark::DoNotOptimize(V.Count);
+  }
+  SF->unref();
+  State.SetBytesProcessed(State.iterations() * Text.size());
+}
+
+struct WalkCountVisitor : public CSTVisitor<WalkCountVisitor> {
+  std::size_t Count = 0;
+  bool enterNode(Node* N) {
+    Count++;
+    return true;
+  }
+};
+
+static void BM_Walk(benchmark::State& State) {
+  auto& Text = getWorkload(generateMixed, State.range(0));
+  DiagnosticStore DS;
+  auto SF = parseWorkload(Text, DS);
+  for (auto _: State) {
+    WalkCountVisitor V;
+    V.walk(SF);
+    benchmark::DoNotOptimize(V.Count);
+  }
+  SF->unref();
+  State.SetBytesProcessed(State.iterations() * Text.size());
+}
+
+BENCHMARK(BM_Scan)->RangeMultiplier(10)->Range(1 << 10, 100 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Punctuate)->RangeMultiplier(10)->Range(1 << 10, 100 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Parse)->RangeMultiplier(10)->Range(1 << 10, 100 << 20)->Unit(benchmark::kMillisecond)->Complexity(benchmark::oN);
+BENCHMARK(BM_Visit)->RangeMultiplier(10)->Range(1 << 10, 10 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Walk)->RangeMultiplier(10)->Range(1 << 10, 10 << 20)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,71 @@
+
+#include <map>
+#include <tuple>
+
+#include "bolt/CST.hpp"
+#include "bolt/Scanner.hpp"
+#include "bolt/Parser.hpp"
+#include "bolt/Workload.hpp"
+
+#include "Inputs.hpp"
+
+namespace bolt {
+
+  const ByteString& getWorkload(WorkloadGenerator Generate, std::size_t Size) {
+    static std::map<std::tuple<WorkloadGenerator, std::size_t>, ByteString> Cache;
+    auto Key = std::make_tuple(Generate, Size);
+    auto Match = Cache.find(Key);
+    if (Match != Cache.end()) {
+      return Match->second;
+    }
+    return Cache.emplace(Key, Generate(Size)).first->second;
+  }
+
+  SourceFile* parseWorkload(const ByteString& Text, DiagnosticEngine& DE) {
+    TextFile File { "#<workload>", Text };
+    VectorStream<const ByteString, Char> Chars { Text, EOF };
+    Scanner S { DE, File, Chars };
+    Punctuator PT { S };
+    Parser P { File, PT, DE };
+    auto SF = P.parseSourceFile();
+    SF->setParents();
+    return SF;
+  }
+
+  ByteString generateFunctions(std::size_t Size) {
+    WorkloadOptions Options;
+    Options.Functions = 64;
+    Options.MinSize = Size;
+    return generateWorkload(Options);
+  }
+
+  ByteString generateCalls(std::size_t Size) {
+    WorkloadOptions Options;
+    Options.Recursions = 16;
+    Options.CycleLength = 8;
+    Options.MinSize = Size;
+    return generateWorkload(Options);
+  }
+
+  ByteString generateTupleFunctions(std::size_t Size) {
+    WorkloadOptions Options;
+    Options.Tuples = 64;
+    Options.MinSize = Size;
+    return generateWorkload(Options);
+  }
+
+  ByteString generateMixed(std::size_t Size) {
+    WorkloadOptions Options;
+    Options.Functions = 16;
+    Options.LetDepth = 8;
+    Options.CycleLength = 8;
+    Options.Recursions = 8;
+    Options.RecordWidth = 16;
+    Options.MatchCases = 16;
+    Options.ClassUses = 8;
+    Options.Tuples = 8;
+    Options.MinSize = Size;
+    return generateWorkload(Options);
+  }
+
+}
@@ -0,0 +1,48 @@
+
+#pragma once
+
+#include "bolt/ByteString.hpp"
+
+namespace bolt {
+
+  class DiagnosticEngine;
+  class SourceFile;
+
+  using WorkloadGenerator = ByteString(*)(std::size_t Size);
+
+  /**
+   * Get the output of \p Generate for the given size, generating it only the
+   * first time it is requested.
+   */
+  const ByteString& getWorkload(WorkloadGenerator Generate, std::size_t Size);
+
+  /**
+   * Parse a generated program and set the parents of its nodes.
+   */
+  SourceFile* parseWorkload(const ByteString& Text, DiagnosticEngine& DE);
+
+  /**
+   * Generate a program of roughly \p Size bytes that consists of small,
+   * annotated integer functions.
+   */
+  ByteString generateFunctions(std::size_t Size);
+
+  /**
+   * Generate a program of roughly \p Size bytes that consists of recursive
+   * functions and of functions that call each other in cycles.
+   */
+  ByteString generateCalls(std::size_t Size);
+
+  /**
+   * Generate a program of roughly \p Size bytes in which most of the work of
+   * the checker is unifying tuple and arrow types.
+   */
+  ByteString generateTupleFunctions(std::size_t Size);
+
+  /**
+   * Generate a program of roughly \p Size bytes that contains every kind of
+   * declaration that boltgen can produce.
+   */
+  ByteString generateMixed(std::size_t Size);
+
+}
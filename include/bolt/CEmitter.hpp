@@ -0,0 +1,131 @@
+
+#pragma once
+
+#include <ostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include "bolt/ByteString.hpp"
+#include "bolt/CST.hpp"
+#include "bolt/Type.hpp"
+#include "bolt/MatchCompiler.hpp"
+
+namespace bolt {
+
+  class Checker;
+  class DiagnosticEngine;
+
+  /**
+   * Lowers checked source files to a single portable C file.
+   *
+   * Int, Bool and tuples are represented unboxed using the types that were
+   * inferred by the checker. Enum members are allocated on a heap that is
+   * managed by a small garbage collector, which is part of the runtime that is
+   * written in front of the generated code.
+   *
+   * Polymorphic functions and functions that are used as values cannot be
+   * compiled yet. A NotSupportedDiagnostic is reported for them.
+   */
+  class CEmitter {
+
+    Checker& C;
+    DiagnosticEngine& DE;
+
+    MatchCompiler Compiler;
+
+    std::size_t NextTempId = 0;
+
+    ByteString TypeDecls;
+    ByteString Prototypes;
+    ByteString Globals;
+    ByteString Functions;
+    ByteString MainBody;
+
+    /**
+     * The buffer that statements are currently being written to.
+     */
+    ByteString* Body = nullptr;
+    unsigned Indent = 0;
+
+    /**
+     * Maps the C types of the elements of a tuple to the name of the struct
+     * that was generated for it.
+     */
+    std::unordered_map<ByteString, ByteString> TupleStructs;
+
+    struct MatchState {
+      MatchExpression* Match;
+      ByteString Value;
+      Type* ValueType;
+      ByteString Result;
+      ByteString EndLabel;
+
+      /**
+       * The enum member each value is known to have been constructed with, as
+       * determined by the switches that were passed to get to this point.
+       */
+      std::map<MatchPath, std::size_t> KnownTags;
+    };
+
+    ByteString createTemp();
+
+    void writeLine(const ByteString& Line);
+
+    void unsupported(ByteString Feature, Node* Source);
+
+    bool isBuiltinType(Type* Ty, Type* Builtin);
+
+    ByteString getCType(Type* Ty, Node* Source);
+    ByteString getTupleStruct(TTuple* Ty, Node* Source);
+
+    ByteString toWord(const ByteString& Expr, Type* Ty, Node* Source);
+    ByteString fromWord(const ByteString& Word, Type* Ty, Node* Source);
+
+    Type* getFieldType(Type* Ty, std::size_t Tag, std::size_t Index, Node* Source);
+
+    std::tuple<ByteString, Type*> resolvePath(MatchState& State, const MatchPath& Path);
+
+    void emitDecision(MatchState& State, Decision* D);
+
+    ByteString emitMatch(MatchExpression* M);
+    ByteString emitCall(CallExpression* Call);
+    ByteString emitExpression(Expression* X);
+
+    /**
+     * Let-declarations without parameters are compiled to variables. Reports
+     * the ones that cannot be compiled.
+     *
+     * \returns false if nothing has to be emitted for the declaration.
+     */
+    bool checkVariable(LetDeclaration* Let);
+
+    void emitStatement(Node* N);
+    void emitFunction(LetDeclaration* Let);
+
+  public:
+
+    CEmitter(Checker& C, DiagnosticEngine& DE);
+
+    void emit(SourceFile* SF);
+
+    /**
+     * Write the runtime together with everything that was emitted so far.
+     */
+    void write(std::ostream& Out);
+
+  };
+
+  /**
+   * Compile the C file at \p CPath to an executable at \p Output.
+   *
+   * The compiler is taken from the CC environment variable and defaults to
+   * `cc`. The paths are passed to it as separate arguments, so they are never
+   * interpreted by a shell.
+   *
+   * \returns the exit status of the compiler or -1 if it could not be started
+   * or did not exit normally.
+   */
+  int compileC(const std::string& CPath, const std::string& Output);
+
+}
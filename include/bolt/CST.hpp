@@ -1,6 +1,7 @@
 #ifndef BOLT_CST_HPP
 #define BOLT_CST_HPP
 
+#include <cstdint>
 #include <limits>
 #include <unordered_map>
 #include <variant>
@@ -64,6 +65,8 @@ namespace bolt {
 
   class TextFile {
 
+    std::size_t Id;
+
     ByteString Path;
     ByteString Text;
 
@@ -73,16 +76,38 @@ namespace bolt {
 
     TextFile(ByteString Path, ByteString Text);
 
+    /**
+     * A number that is unique to this file and that is greater than the number
+     * of every file that was created before it. Copies share the number of the
+     * file they were copied from.
+     */
+    inline std::size_t getId() const noexcept {
+      return Id;
+    }
+
     size_t getLine(size_t Offset) const;
     size_t getColumn(size_t Offset) const;
     size_t getStartOffsetOfLine(size_t Line) const;
     size_t getEndOffsetOfLine(size_t Line) const;
 
+    /**
+     * Get the offset in bytes of the character at \p Loc.
+     */
+    size_t getOffset(TextLoc Loc) const;
+
     size_t getLineCount() const;
 
     ByteString getPath() const;
 
-    ByteString getText() const;
+    ByteStringView getText() const;
+
+    /**
+     * Replace the text between \p StartOffset and \p EndOffset with \p NewText.
+     *
+     * The line offsets are patched rather than computed again, so only the
+     * new text is scanned for line terminators.
+     */
+    void replace(size_t StartOffset, size_t EndOffset, ByteStringView NewText);
 
   };
 
@@ -157,6 +182,7 @@ namespace bolt {
     PrefixExpression,
     RecordExpressionField,
     RecordExpression,
+    InvalidExpression,
     ExpressionStatement,
     ReturnStatement,
     IfStatement,
@@ -245,6 +271,13 @@ namespace bolt {
 
     virtual Scope* getScope();
 
+    /**
+     * Nodes are small and there are many of them, so they are carved out of
+     * larger blocks of memory instead of being allocated one by one.
+     */
+    static void* operator new(std::size_t Size);
+    static void operator delete(void* Ptr, std::size_t Size);
+
     virtual ~Node() {}
 
   };
@@ -258,8 +291,27 @@ namespace bolt {
 
   class Scope {
 
+    struct Symbol {
+      ByteString Name;
+      SymbolKind Kind;
+      Node* Decl;
+    };
+
     Node* Source;
-    std::unordered_multimap<ByteString, std::tuple<Node*, SymbolKind>> Mapping;
+
+    /**
+     * All symbols of this scope, sorted by name and then by kind.
+     *
+     * Most scopes only contain a handful of names, which are found with a
+     * binary search in this array.
+     */
+    std::vector<Symbol> Symbols;
+
+    /**
+     * Maps a name to its first entry in Symbols. Only built for scopes that
+     * are too large to search efficiently, such as those of source files.
+     */
+    std::unordered_map<ByteStringView, std::size_t> Index;
 
     void addSymbol(ByteString Name, Node* Decl, SymbolKind Kind);
 
@@ -296,11 +348,15 @@ namespace bolt {
 
   class Token : public Node {
 
-    TextLoc StartLoc;
+    // Stored as 32-bit numbers because there are a lot of tokens
+    std::uint32_t StartLine;
+    std::uint32_t StartColumn;
 
   public:
 
-    Token(NodeKind Type, TextLoc StartLoc): Node(Type), StartLoc(StartLoc) {}
+    Token(NodeKind Type, TextLoc StartLoc): Node(Type) {
+      setStartLoc(StartLoc);
+    }
 
     virtual std::string getText() const = 0;
 
@@ -313,17 +369,24 @@ namespace bolt {
     }
 
     inline TextLoc getStartLoc() const {
-      return StartLoc;
+      return TextLoc { StartLine, StartColumn };
+    }
+
+    inline void setStartLoc(TextLoc NewLoc) {
+      ZEN_ASSERT(NewLoc.Line <= std::numeric_limits<std::uint32_t>::max()
+              && NewLoc.Column <= std::numeric_limits<std::uint32_t>::max());
+      StartLine = NewLoc.Line;
+      StartColumn = NewLoc.Column;
     }
 
     TextLoc getEndLoc() const;
 
     inline size_t getStartLine() const override {
-      return StartLoc.Line;
+      return StartLine;
     }
 
     inline size_t getStartColumn() const override {
-      return StartLoc.Column;
+      return StartColumn;
     }
 
     inline size_t getEndLine() const override {
@@ -1396,6 +1459,10 @@ namespace bolt {
   };
 
   class ReferenceExpression : public Expression {
+
+    bool IsResolved = false;
+    Node* Declaration = nullptr;
+
   public:
 
     std::vector<std::tuple<IdentifierAlt*, Dot*>> ModulePath;
@@ -1425,6 +1492,26 @@ namespace bolt {
 
     SymbolPath getSymbolPath() const;
 
+    /**
+     * Find the declaration this expression refers to.
+     *
+     * Only the first call climbs the scopes; the result is remembered so that
+     * the checker and later passes all share the same binding.
+     *
+     * \returns nullptr when the name has no declaration in the source code,
+     *          such as for builtins.
+     */
+    Node* getDeclaration();
+
+    /**
+     * Make the next call to getDeclaration() look up the name again, e.g.
+     * after the declarations around this expression were parsed again.
+     */
+    inline void forgetDeclaration() {
+      IsResolved = false;
+      Declaration = nullptr;
+    }
+
   };
 
   class MatchCase : public Node { 
@@ -1753,6 +1840,26 @@ namespace bolt {
 
   };
 
+  /**
+   * Takes the place of an expression that could not be parsed.
+   *
+   * It holds the tokens that were skipped while recovering from the error, so
+   * that the rest of the tree can still be checked and every token remains
+   * part of it.
+   */
+  class InvalidExpression : public Expression {
+  public:
+
+    std::vector<Token*> Tokens;
+
+    inline InvalidExpression(std::vector<Token*> Tokens):
+      Expression(NodeKind::InvalidExpression), Tokens(Tokens) {}
+
+    Token* getFirstToken() const override;
+    Token* getLastToken() const override;
+
+  };
+
   class Statement : public Node, public AnnotationContainer {
   protected:
 
@@ -2251,8 +2358,15 @@ namespace bolt {
 
     std::vector<Node*> Elements;
 
-    SourceFile(TextFile& File, std::vector<Node*> Elements):
-      Node(NodeKind::SourceFile), File(File), Elements(Elements) {}
+    /**
+     * Where the line fold of each element starts.
+     *
+     * This is not always the first token of the element, since the parser
+     * drops tokens it could not make sense of.
+     */
+    std::vector<TextLoc> ElementStarts;
+
+    SourceFile(TextFile& File, std::vector<Node*> Elements, std::vector<TextLoc> ElementStarts = {});
 
     inline TextFile& getTextFile() {
       return File;
@@ -2272,6 +2386,15 @@ namespace bolt {
       return TheScope;
     }
 
+    /**
+     * Replace the elements in [\p First, \p Last) with \p NewElements, whose
+     * line folds start at \p NewStarts.
+     *
+     * The old elements are released and the scope of this file will be built
+     * again on the next lookup.
+     */
+    void replaceElements(std::size_t First, std::size_t Last, std::vector<Node*> NewElements, std::vector<TextLoc> NewStarts);
+
     static bool classof(const Node* N) {
       return N->getKind() == NodeKind::SourceFile;
     }
@@ -2327,6 +2450,7 @@ namespace bolt {
   template<> inline NodeKind getNodeType<CallExpression>() { return NodeKind::CallExpression; }
   template<> inline NodeKind getNodeType<InfixExpression>() { return NodeKind::InfixExpression; }
   template<> inline NodeKind getNodeType<PrefixExpression>() { return NodeKind::PrefixExpression; }
+  template<> inline NodeKind getNodeType<InvalidExpression>() { return NodeKind::InvalidExpression; }
   template<> inline NodeKind getNodeType<ExpressionStatement>() { return NodeKind::ExpressionStatement; }
   template<> inline NodeKind getNodeType<ReturnStatement>() { return NodeKind::ReturnStatement; }
   template<> inline NodeKind getNodeType<IfStatement>() { return NodeKind::IfStatement; }
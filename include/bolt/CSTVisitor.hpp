@@ -1,6 +1,10 @@
 
 #pragma once
 
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
 #include "CST.hpp"
 #include "zen/config.hpp"
 
@@ -12,6 +16,18 @@ namespace bolt {
   class CSTVisitor {
   public:
 
+    /**
+     * Visit \p Root and everything below it without overflowing the C++ stack
+     * on deeply nested trees.
+     *
+     * enterNode() is called before the children of a node and may return false
+     * to skip them. leaveNode() is called after the children of every node that
+     * was entered.
+     */
+    void walk(Node* Root) {
+      walkRecursive(Root, 0);
+    }
+
     void visit(Node* N) {
 
 #define BOLT_GEN_CASE(name) \
@@ -89,6 +105,7 @@ namespace bolt {
         BOLT_GEN_CASE(PrefixExpression)
         BOLT_GEN_CASE(RecordExpressionField)
         BOLT_GEN_CASE(RecordExpression)
+        BOLT_GEN_CASE(InvalidExpression)
         BOLT_GEN_CASE(ExpressionStatement)
         BOLT_GEN_CASE(ReturnStatement)
         BOLT_GEN_CASE(IfStatement)
@@ -109,8 +126,30 @@ namespace bolt {
       }
     }
 
+  private:
+
+    template<typename W>
+    friend struct CSTChildWalker;
+
+    /**
+     * Below this depth walk() uses plain recursion, which is faster than
+     * keeping a stack on the heap. Deeper subtrees are walked iteratively.
+     */
+    static constexpr std::size_t MaxRecursiveWalkDepth = 256;
+
+    void walkRecursive(Node* N, std::size_t Depth);
+
+    void walkIterative(Node* Root);
+
   protected:
 
+    bool enterNode(Node* N) {
+      return true;
+    }
+
+    void leaveNode(Node* N) {
+    }
+
     void visitNode(Node* N) {
       visitEachChild(N);
     }
@@ -419,6 +458,10 @@ namespace bolt {
       static_cast<D*>(this)->visitExpression(N);
     }
 
+    void visitInvalidExpression(InvalidExpression* N) {
+      static_cast<D*>(this)->visitExpression(N);
+    }
+
     void visitStatement(Statement* N) {
       static_cast<D*>(this)->visitNode(N);
     }
@@ -579,6 +622,7 @@ namespace bolt {
         BOLT_GEN_CHILD_CASE(PrefixExpression)
         BOLT_GEN_CHILD_CASE(RecordExpressionField)
         BOLT_GEN_CHILD_CASE(RecordExpression)
+        BOLT_GEN_CHILD_CASE(InvalidExpression)
         BOLT_GEN_CHILD_CASE(ExpressionStatement)
         BOLT_GEN_CHILD_CASE(ReturnStatement)
         BOLT_GEN_CHILD_CASE(IfStatement)
@@ -962,6 +1006,15 @@ namespace bolt {
       BOLT_VISIT(N->RBrace);
     }
 
+    void visitEachChild(InvalidExpression* N) {
+      for (auto A: N->Annotations) {
+        BOLT_VISIT(A);
+      }
+      for (auto T: N->Tokens) {
+        BOLT_VISIT(T);
+      }
+    }
+
     void visitEachChild(ExpressionStatement* N) {
       for (auto A: N->Annotations) {
         BOLT_VISIT(A);
@@ -1127,4 +1180,85 @@ namespace bolt {
 
   };
 
+  /**
+   * Continues walk() on every direct child of a node.
+   */
+  template<typename W>
+  struct CSTChildWalker : public CSTVisitor<CSTChildWalker<W>> {
+
+    W& Walker;
+    std::size_t Depth;
+
+    CSTChildWalker(W& Walker, std::size_t Depth):
+      Walker(Walker), Depth(Depth) {}
+
+    void visit(Node* N) {
+      Walker.walkRecursive(N, Depth);
+    }
+
+  };
+
+  /**
+   * Pushes the direct children of a node onto the stack of walk().
+   */
+  struct CSTChildCollector : public CSTVisitor<CSTChildCollector> {
+
+    std::vector<Node*>& Stack;
+
+    CSTChildCollector(std::vector<Node*>& Stack):
+      Stack(Stack) {}
+
+    void visit(Node* N) {
+      Stack.push_back(N);
+    }
+
+  };
+
+  template<typename D, typename R>
+  void CSTVisitor<D, R>::walkRecursive(Node* N, std::size_t Depth) {
+    if (Depth == MaxRecursiveWalkDepth) {
+      walkIterative(N);
+      return;
+    }
+    if (!static_cast<D*>(this)->enterNode(N)) {
+      return;
+    }
+    CSTChildWalker<CSTVisitor> Children { *this, Depth + 1 };
+    Children.visitEachChild(N);
+    static_cast<D*>(this)->leaveNode(N);
+  }
+
+  template<typename D, typename R>
+  void CSTVisitor<D, R>::walkIterative(Node* Root) {
+    // A null pointer on the stack means that the node below it must be left.
+    // Most visitors don't define leaveNode(), so these are only pushed if
+    // it was overridden.
+    constexpr bool HasLeave = !std::is_same_v<decltype(&D::leaveNode), decltype(&CSTVisitor::leaveNode)>;
+    std::vector<Node*> Stack { Root };
+    CSTChildCollector Children { Stack };
+    while (!Stack.empty()) {
+      auto N = Stack.back();
+      Stack.pop_back();
+      if (HasLeave && N == nullptr) {
+        N = Stack.back();
+        Stack.pop_back();
+        static_cast<D*>(this)->leaveNode(N);
+        continue;
+      }
+      if (!static_cast<D*>(this)->enterNode(N)) {
+        continue;
+      }
+      if (HasLeave) {
+        Stack.push_back(N);
+        Stack.push_back(nullptr);
+      }
+      auto Start = Stack.size();
+      Children.visitEachChild(N);
+      // The first child must be on top of the stack
+      if (Stack.size() - Start > 1) {
+        std::reverse(Stack.begin() + Start, Stack.end());
+      }
+    }
+  }
+
 }
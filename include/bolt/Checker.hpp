@@ -7,6 +7,7 @@
 #include "bolt/Common.hpp"
 #include "bolt/CST.hpp"
 #include "bolt/Type.hpp"
+#include "bolt/Trace.hpp"
 #include "bolt/Support/Graph.hpp"
 
 #include <cstdlib>
@@ -163,17 +164,89 @@ namespace bolt {
 
   };
 
+  /**
+   * The types and bindings that every source file starts with, such as `Int`
+   * and `+`.
+   *
+   * A prelude never changes after it was built. One instance can therefore be
+   * shared by any amount of checkers, including checkers on other threads.
+   */
+  class Prelude {
+
+    TypeEnv Env;
+
+    size_t ConTypeCount = 0;
+    size_t TypeVarCount = 0;
+
+    Type* BoolType;
+    Type* ListType;
+    Type* IntType;
+    Type* StringType;
+
+    Prelude();
+
+  public:
+
+    /**
+     * Get the prelude of the language. It is built the first time it is
+     * requested.
+     */
+    static const Prelude& getDefault();
+
+    Scheme* lookup(const ByteString& Name) const;
+
+    /**
+     * The amount of type constructors in this prelude. Checkers number their
+     * own types starting from here.
+     */
+    inline size_t getConTypeCount() const {
+      return ConTypeCount;
+    }
+
+    /**
+     * The amount of type variables in this prelude. Checkers number their own
+     * type variables starting from here.
+     */
+    inline size_t getTypeVarCount() const {
+      return TypeVarCount;
+    }
+
+    inline Type* getBoolType() const {
+      return BoolType;
+    }
+
+    inline Type* getListType() const {
+      return ListType;
+    }
+
+    inline Type* getIntType() const {
+      return IntType;
+    }
+
+    inline Type* getStringType() const {
+      return StringType;
+    }
+
+  };
+
   class Checker {
 
     friend class Unifier;
     friend class UnificationFrame;
+    friend class InterfaceReader;
 
     const LanguageConfig& Config;
     DiagnosticEngine& DE;
+    const Prelude& ThePrelude;
 
     size_t NextConTypeId = 0;
     size_t NextTypeVarId = 0;
 
+    size_t SolvedConstraintCount = 0;
+    size_t UnificationCount = 0;
+
+    TraceWriter* Trace = nullptr;
+
     Type* BoolType;
     Type* ListType;
     Type* IntType;
@@ -181,7 +254,22 @@ namespace bolt {
 
     Graph<Node*> RefGraph;
 
-    std::unordered_map<ByteString, std::vector<InstanceDeclaration*>> InstanceMap;
+    /**
+     * The types for which an instance of a type class exists, indexed by the
+     * name of the type class.
+     */
+    std::unordered_map<ByteString, std::vector<Type*>> InstanceMap;
+
+    /**
+     * The public bindings of other modules, indexed by the name of the module.
+     */
+    std::unordered_map<ByteString, TypeEnv> ImportedModules;
+
+    /**
+     * Types that were declared in other modules, indexed by their qualified
+     * name, so that every interface refers to the same type.
+     */
+    std::unordered_map<ByteString, TCon*> ImportedTypes;
 
     /// Inference context management
 
@@ -230,6 +318,11 @@ namespace bolt {
 
     Scheme* lookup(ByteString Name);
 
+    /**
+     * Find a public binding of a module that was loaded with loadInterface().
+     */
+    Scheme* lookupQualified(const SymbolPath& Path);
+
     /**
      * Looks up a type/variable and  ensures that it is a monomorphic type.
      *
@@ -273,7 +366,7 @@ namespace bolt {
 
   public:
 
-    Checker(const LanguageConfig& Config, DiagnosticEngine& DE);
+    Checker(const LanguageConfig& Config, DiagnosticEngine& DE, const Prelude& ThePrelude = Prelude::getDefault());
 
     /**
      * \internal
@@ -282,6 +375,34 @@ namespace bolt {
 
     void check(SourceFile* SF);
 
+    /**
+     * Write the public declarations and the instances of a checked source
+     * file in the format that is read by loadInterface().
+     */
+    void writeInterface(SourceFile* SF, ByteStringView ModuleName, ByteString& Out);
+
+    /**
+     * Make the declarations in the interface of another module available to
+     * the source files that are checked afterwards, as `Module.name`.
+     *
+     * \returns false if \p Data is not a valid module interface.
+     */
+    bool loadInterface(ByteStringView Data);
+
+    inline bool hasModule(ByteStringView Name) const {
+      return ImportedModules.count(ByteString(Name));
+    }
+
+    /**
+     * Record how long each declaration, each group of mutually recursive
+     * declarations and each phase of the solver takes.
+     *
+     * Pass `nullptr` to stop tracing.
+     */
+    inline void setTrace(TraceWriter* W) {
+      Trace = W;
+    }
+
     inline Type* getBoolType() const {
       return BoolType;
     }
@@ -294,8 +415,31 @@ namespace bolt {
       return IntType;
     }
 
+    inline Type* getListType() const {
+      return ListType;
+    }
+
     Type* getType(TypedNode* Node);
 
+    inline size_t getTypeVarCount() const {
+      return NextTypeVarId;
+    }
+
+    /**
+     * Get how many equality constraints were solved so far.
+     */
+    inline size_t getSolvedConstraintCount() const {
+      return SolvedConstraintCount;
+    }
+
+    /**
+     * Get how many pairs of types were unified so far, including the ones
+     * nested inside of other types.
+     */
+    inline size_t getUnificationCount() const {
+      return UnificationCount;
+    }
+
   };
 
 }
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 
 #include "bolt/ByteString.hpp"
 #include "bolt/CST.hpp"
@@ -14,6 +15,12 @@ namespace bolt {
   class TypeclassSignature;
   class Diagnostic;
 
+  /**
+   * Get a short human-readable description of a kind of node, such as
+   * "an integer literal".
+   */
+  std::string describe(NodeKind Kind);
+
   enum class Color {
     None,
     Black,
@@ -120,11 +127,16 @@ namespace bolt {
 
   /**
    * Prints any diagnostic message that was added to it to the console.
+   *
+   * Diagnostics are first formatted into a buffer that is reused between
+   * diagnostics. The output stream only receives complete diagnostics.
    */
   class ConsolePrinter {
 
     std::ostream& Out;
 
+    ByteString Buffer;
+
     Style ActiveStyle;
 
     void setForegroundColor(Color C);
@@ -171,6 +183,10 @@ namespace bolt {
     void write(std::size_t N);
     void write(char C);
 
+    void renderDiagnostic(const Diagnostic& D);
+
+    void flush();
+
   public:
 
     unsigned ExcerptLinesPre = 2;
@@ -184,6 +200,12 @@ namespace bolt {
 
     void writeDiagnostic(const Diagnostic& D);
 
+    /**
+     * Write many diagnostics using as few writes to the output stream as
+     * possible.
+     */
+    void writeDiagnostics(const std::vector<Diagnostic*>& Diagnostics);
+
   };
 
 }
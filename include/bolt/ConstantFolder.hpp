@@ -0,0 +1,86 @@
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "bolt/ByteString.hpp"
+#include "bolt/CST.hpp"
+#include "bolt/Evaluator.hpp"
+
+namespace bolt {
+
+  class Checker;
+
+  /**
+   * Rewrites expressions of a checked source file that always produce the
+   * same integer or string into a literal.
+   *
+   * Integer arithmetic on literals, references to variables that are bound to
+   * a constant and calls of small, non-recursive functions with constant
+   * arguments are computed once by this pass instead of every time they are
+   * evaluated.
+   *
+   * The new literals get the type of the expression they replace, so the
+   * evaluator and the C backend can use them like any other checked node.
+   * The expressions that were replaced are unreffed.
+   */
+  class ConstantFolder {
+
+    Evaluator E;
+
+    std::size_t FoldedCount = 0;
+
+    /**
+     * Declarations of which the body was already folded or is being folded
+     * right now.
+     */
+    std::unordered_set<LetDeclaration*> Visited;
+
+    /**
+     * Whether a function can be called at compile time. Functions that are
+     * still being examined are mapped to false, so that recursive functions
+     * are never inlined.
+     */
+    std::unordered_map<LetDeclaration*, bool> InlineableFunctions;
+
+    /**
+     * Names bound by the match cases that are currently being folded.
+     *
+     * These are not part of any Scope and shadow declarations with the same
+     * name.
+     */
+    std::vector<ByteString> CaseBindings;
+
+    LetDeclaration* resolveLet(ReferenceExpression* Ref);
+
+    bool isBuiltinOperator(InfixExpression* Infix);
+
+    bool isInlineable(LetDeclaration* Let);
+    bool isInlineableExpression(Expression* X, LetDeclaration* Let, std::size_t& Size);
+
+    Expression* createLiteral(Expression* Original, const Value& V);
+
+    Expression* foldExpression(Expression* X);
+
+    void foldLet(LetDeclaration* Let);
+    void foldNode(Node* N);
+
+  public:
+
+    ConstantFolder(Checker& C);
+
+    void fold(SourceFile* SF);
+
+    /**
+     * Get the amount of expressions that were replaced by a literal so far.
+     */
+    inline std::size_t getFoldedCount() const noexcept {
+      return FoldedCount;
+    }
+
+  };
+
+}
+
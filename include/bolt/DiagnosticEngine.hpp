@@ -4,6 +4,10 @@
 #include <utility>
 #include <vector>
 #include <iostream>
+#include <sstream>
+
+#include "bolt/ByteString.hpp"
+#include "bolt/ConsolePrinter.hpp"
 
 namespace bolt {
 
@@ -16,19 +20,26 @@ namespace bolt {
   class DiagnosticEngine {
   protected:
 
-    bool HasError = false;
+    std::size_t ErrorCount = 0;
 
     virtual void addDiagnostic(Diagnostic* Diagnostic) = 0;
 
   public:
 
     inline bool hasError() const noexcept {
-      return HasError;
+      return ErrorCount > 0;
+    }
+
+    /**
+     * How many errors were added since this engine was created.
+     */
+    inline std::size_t getErrorCount() const noexcept {
+      return ErrorCount;
     }
 
     template<typename D, typename ...Ts>
     void add(Ts&&... Args) {
-      HasError = true;
+      ErrorCount++;
       addDiagnostic(new D { std::forward<Ts>(Args)... });
     }
 
@@ -44,16 +55,24 @@ namespace bolt {
 
     std::vector<Diagnostic*> Diagnostics;
 
-    void addDiagnostic(Diagnostic* Diagnostic) {
-      Diagnostics.push_back(Diagnostic);
-    }
+    void addDiagnostic(Diagnostic* Diagnostic);
 
     void clear() {
       Diagnostics.clear();
     }
 
+    /**
+     * Order the diagnostics by file and by their position in that file.
+     */
     void sort();
 
+    /**
+     * Move the diagnostics of \p Other into this store.
+     *
+     * Both stores must have been sorted. The result is sorted as well.
+     */
+    void merge(DiagnosticStore& Other);
+
     std::size_t countDiagnostics() const noexcept {
       return Diagnostics.size();
     }
@@ -76,4 +95,99 @@ namespace bolt {
 
   };
 
+  /**
+   * Append \p Text to \p Out as a quoted JSON string.
+   */
+  void writeJSONString(ByteString& Out, ByteStringView Text);
+
+  /**
+   * Renders the message of a diagnostic as a single line of plain text, for
+   * tools that show the location of the diagnostic themselves.
+   */
+  class DiagnosticMessageRenderer {
+
+    std::ostringstream Stream;
+    ConsolePrinter Printer;
+
+  public:
+
+    DiagnosticMessageRenderer();
+
+    /**
+     * Get the first line of the message, without the "error:" prefix.
+     */
+    ByteString getMessage(const Diagnostic& D);
+
+  };
+
+  enum class JSONDiagnosticsFormat {
+
+    /**
+     * Write one JSON object per line as soon as a diagnostic is added.
+     */
+    Lines,
+
+    /**
+     * Write a single SARIF 2.1.0 log containing all diagnostics.
+     *
+     * Results are still written as soon as they are added. The log is closed
+     * by finish().
+     */
+    SARIF,
+
+  };
+
+  /**
+   * Writes diagnostics in a format that is meant to be read by other programs.
+   *
+   * Every record contains the code of the diagnostic, the file and range it
+   * refers to, a plain-text message and the relevant details of the
+   * diagnostic, such as the types that failed to unify.
+   */
+  class JSONDiagnostics : public DiagnosticEngine {
+
+    std::ostream& Out;
+
+    JSONDiagnosticsFormat Format;
+
+    DiagnosticMessageRenderer Messages;
+
+    /**
+     * Reused between diagnostics to format a single record in.
+     */
+    ByteString Record;
+
+    bool HasStarted = false;
+    bool HasFinished = false;
+
+    void writeRecord(const Diagnostic& D);
+    void writeResult(const Diagnostic& D);
+
+    void start();
+
+  protected:
+
+    void addDiagnostic(Diagnostic* Diagnostic) override;
+
+  public:
+
+    JSONDiagnostics(std::ostream& Out, JSONDiagnosticsFormat Format = JSONDiagnosticsFormat::Lines);
+
+    /**
+     * Write a diagnostic that is owned by someone else, such as a
+     * DiagnosticStore.
+     */
+    void writeDiagnostic(const Diagnostic& D);
+
+    /**
+     * Write whatever is needed to make the output a complete document.
+     *
+     * Does nothing in JSON Lines mode or when called a second time.
+     */
+    void finish();
+
+    ~JSONDiagnostics();
+
+  };
+
 }
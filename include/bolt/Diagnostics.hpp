@@ -21,6 +21,34 @@ namespace bolt {
     TupleIndexOutOfRange,
     InvalidTypeToTypeclass,
     FieldNotFound,
+    NotSupported,
+  };
+
+  /**
+   * The file and the range of text a diagnostic refers to.
+   *
+   * File is nullptr for diagnostics that do not refer to any source code.
+   */
+  struct DiagnosticLocation {
+    const TextFile* File;
+    TextRange Range;
+  };
+
+  /**
+   * Determines the order in which diagnostics are presented to the user:
+   * first by file, then by position in the file and finally by code.
+   *
+   * Files are ordered by their id, which is the order in which they were
+   * loaded. Diagnostics without a file have id 0 and come first.
+   */
+  struct DiagnosticSortKey {
+
+    std::size_t File = 0;
+    std::size_t Offset = 0;
+    unsigned Code = 0;
+
+    bool operator<(const DiagnosticSortKey& Other) const;
+
   };
 
   class Diagnostic : std::runtime_error {
@@ -33,6 +61,13 @@ namespace bolt {
 
   public:
 
+    /**
+     * Filled in by DiagnosticStore when the diagnostic is added, so that
+     * sorting does not have to look up the location of the diagnostic over
+     * and over again.
+     */
+    DiagnosticSortKey SortKey;
+
     inline DiagnosticKind getKind() const noexcept {
       return Kind;
     }
@@ -65,11 +100,27 @@ namespace bolt {
   public:
 
     TextFile& File;
+
+    /**
+     * The token that was found instead, which is kept alive for as long as
+     * the diagnostic is. The parser may already have released it, e.g. when
+     * it skipped over the rest of a declaration.
+     */
     Token* Actual;
+
     std::vector<NodeKind> Expected;
 
     inline UnexpectedTokenDiagnostic(TextFile& File, Token* Actual, std::vector<NodeKind> Expected):
-      Diagnostic(DiagnosticKind::UnexpectedToken), File(File), Actual(Actual), Expected(Expected) {}
+      Diagnostic(DiagnosticKind::UnexpectedToken), File(File), Actual(Actual), Expected(Expected) {
+        Actual->ref();
+      }
+
+    UnexpectedTokenDiagnostic(const UnexpectedTokenDiagnostic&) = delete;
+    UnexpectedTokenDiagnostic& operator=(const UnexpectedTokenDiagnostic&) = delete;
+
+    inline ~UnexpectedTokenDiagnostic() {
+      Actual->unref();
+    }
 
     unsigned getCode() const noexcept override {
       return 1101;
@@ -217,4 +268,28 @@ namespace bolt {
 
   };
 
+  class NotSupportedDiagnostic : public Diagnostic {
+  public:
+
+    ByteString Feature;
+    Node* Source;
+
+    inline NotSupportedDiagnostic(ByteString Feature, Node* Source):
+      Diagnostic(DiagnosticKind::NotSupported), Feature(Feature), Source(Source) {}
+
+    inline Node* getNode() const override {
+      return Source;
+    }
+
+    unsigned getCode() const noexcept override {
+      return 3001;
+    }
+
+  };
+
+  /**
+   * Find out which part of which file a diagnostic is about.
+   */
+  DiagnosticLocation getLocation(const Diagnostic& D);
+
 }
@@ -1,37 +1,100 @@
 
 #pragma once
 
+#include <memory>
 #include <unordered_map>
-#include <functional>
+#include <span>
+#include <string>
+#include <ostream>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 #include "bolt/ByteString.hpp"
 #include "bolt/CST.hpp"
+#include "bolt/Type.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/MatchCompiler.hpp"
 
 namespace bolt {
 
+  class Value;
+  class Context;
+  class Env;
+
+  /**
+   * Thrown when a program cannot continue running, such as when none of the
+   * cases of a match-expression apply to its value.
+   */
+  class RuntimeError : public std::runtime_error {
+  public:
+
+    using std::runtime_error::runtime_error;
+
+  };
+
+  /**
+   * A function implemented in C++ that can be called from Bolt.
+   *
+   * The arguments are passed as a view into memory owned by the caller, so
+   * calling a native function does not need to allocate.
+   *
+   * Use Env::addNative to register a C++ function with a typed signature
+   * instead of writing one of these by hand.
+   */
+  using NativeFunction = Value (*)(Context&, std::span<const Value>);
+
   enum class ValueKind {
     Empty,
     String,
     Integer,
     Tuple,
+    Variant,
+    Constructor,
     SourceFunction,
     NativeFunction,
+    MatchFunction,
   };
 
   class Value {
 
-    using NativeFunction = std::function<Value(std::vector<Value>)>;
-
     using Tuple = std::vector<Value>;
 
+    struct Variant {
+      std::size_t Tag;
+      std::vector<Value> Fields;
+    };
+
+    /**
+     * A function that was declared with let, together with the environment
+     * it was declared in, which has to outlive it.
+     */
+    struct SourceClosure {
+      LetDeclaration* D;
+      Env* E;
+    };
+
+    /**
+     * A match-expression without a value, together with the environment it
+     * was evaluated in.
+     */
+    struct MatchClosure {
+      MatchExpression* M;
+      std::shared_ptr<Env> E;
+    };
+
     ValueKind Kind;
 
     union {
       ByteString S;
       Integer I;
-      LetDeclaration* D;
+      SourceClosure SC;
+      MatchClosure MC;
       NativeFunction F;
+      std::size_t C;
       Tuple T;
+      Variant V;
     };
 
   public:
@@ -45,15 +108,25 @@ namespace bolt {
     Value(Integer I):
       Kind(ValueKind::Integer), I(I) {}
 
-    Value(LetDeclaration* D):
-      Kind(ValueKind::SourceFunction), D(D) {}
+    Value(LetDeclaration* D, Env* E):
+      Kind(ValueKind::SourceFunction), SC { D, E } {}
 
     Value(NativeFunction F):
       Kind(ValueKind::NativeFunction), F(F) {}
 
+    /**
+     * Create a function out of a match-expression without a value, which
+     * matches on its only argument.
+     */
+    Value(MatchExpression* M, std::shared_ptr<Env> E):
+      Kind(ValueKind::MatchFunction), MC { M, std::move(E) } {}
+
     Value(std::vector<Value> T):
       Kind(ValueKind::Tuple), T(T) {}
 
+    Value(Variant V):
+      Kind(ValueKind::Variant), V(V) {}
+
     Value(const Value& V):
       Kind(V.Kind) {
         switch (Kind) {
@@ -66,11 +139,20 @@ namespace bolt {
           case ValueKind::Tuple:
             new (&I) Tuple(V.T);
             break;
+          case ValueKind::Variant:
+            new (&this->V) Variant(V.V);
+            break;
           case ValueKind::SourceFunction:
-            new (&D) LetDeclaration*(V.D);
+            SC = V.SC;
             break;
           case ValueKind::NativeFunction:
-            new (&F) NativeFunction(V.F);
+            F = V.F;
+            break;
+          case ValueKind::MatchFunction:
+            new (&MC) MatchClosure(V.MC);
+            break;
+          case ValueKind::Constructor:
+            C = V.C;
             break;
           case ValueKind::Empty:
             break;
@@ -78,6 +160,10 @@ namespace bolt {
       }
 
     Value& operator=(const Value& Other) noexcept {
+      if (this == &Other) {
+        return *this;
+      }
+      this->~Value();
       Kind = Other.Kind;
       switch (Kind) {
         case ValueKind::String:
@@ -89,11 +175,20 @@ namespace bolt {
         case ValueKind::Tuple:
           new (&I) Tuple(Other.T);
           break;
+        case ValueKind::Variant:
+          new (&V) Variant(Other.V);
+          break;
         case ValueKind::SourceFunction:
-          new (&D) LetDeclaration*(Other.D);
+          SC = Other.SC;
           break;
         case ValueKind::NativeFunction:
-          new (&F) NativeFunction(Other.F);
+          F = Other.F;
+          break;
+        case ValueKind::MatchFunction:
+          new (&MC) MatchClosure(Other.MC);
+          break;
+        case ValueKind::Constructor:
+          C = Other.C;
           break;
         case ValueKind::Empty:
           break;
@@ -112,12 +207,74 @@ namespace bolt {
       return S;
     }
 
-    inline LetDeclaration* getDeclaration() {
+    inline const ByteString& asString() const {
+      ZEN_ASSERT(Kind == ValueKind::String);
+      return S;
+    }
+
+    inline Integer asInteger() const {
+      ZEN_ASSERT(Kind == ValueKind::Integer);
+      return I;
+    }
+
+    /**
+     * Get the position of the enum member this value was constructed with.
+     */
+    inline std::size_t getTag() const {
+      switch (Kind) {
+        case ValueKind::Variant:
+          return V.Tag;
+        case ValueKind::Constructor:
+          return C;
+        default:
+          ZEN_UNREACHABLE
+      }
+    }
+
+    /**
+     * Get the element of a tuple or the field of an enum member at the given
+     * position.
+     */
+    inline Value& at(std::size_t Index) {
+      switch (Kind) {
+        case ValueKind::Tuple:
+          ZEN_ASSERT(Index < T.size());
+          return T[Index];
+        case ValueKind::Variant:
+          ZEN_ASSERT(Index < V.Fields.size());
+          return V.Fields[Index];
+        default:
+          ZEN_UNREACHABLE
+      }
+    }
+
+    inline LetDeclaration* getDeclaration() const {
       ZEN_ASSERT(Kind == ValueKind::SourceFunction);
-      return D;
+      return SC.D;
     }
 
-    inline NativeFunction getBinding() {
+    /**
+     * Get the environment the function was declared in.
+     */
+    inline Env* getDeclarationEnv() const {
+      ZEN_ASSERT(Kind == ValueKind::SourceFunction);
+      return SC.E;
+    }
+
+    inline MatchExpression* getMatchExpression() const {
+      ZEN_ASSERT(Kind == ValueKind::MatchFunction);
+      return MC.M;
+    }
+
+    /**
+     * Get the environment the match-expression was evaluated in.
+     */
+    inline Env* getMatchEnv() const {
+      ZEN_ASSERT(Kind == ValueKind::MatchFunction);
+      return MC.E.get();
+    }
+
+    inline NativeFunction getBinding() const {
       ZEN_ASSERT(Kind == ValueKind::NativeFunction);
       return F;
     }
@@ -126,6 +283,21 @@ namespace bolt {
       return Value(F);
     }
 
+    static Value variant(std::size_t Tag, std::vector<Value> Fields) {
+      return Value(Variant { Tag, Fields });
+    }
+
+    /**
+     * Create a function that builds a value of the enum member at position
+     * \p Tag out of its arguments.
+     */
+    static Value constructor(std::size_t Tag) {
+      Value Out;
+      Out.Kind = ValueKind::Constructor;
+      Out.C = Tag;
+      return Out;
+    }
+
     static Value unit() {
       return Value(Tuple {});
     }
@@ -141,10 +313,16 @@ namespace bolt {
         case ValueKind::Tuple:
           T.~Tuple();
           break;
+        case ValueKind::Variant:
+          V.~Variant();
+          break;
         case ValueKind::SourceFunction:
           break;
+        case ValueKind::MatchFunction:
+          MC.~MatchClosure();
+          break;
         case ValueKind::NativeFunction:
-          F.~NativeFunction();
+        case ValueKind::Constructor:
           break;
         case ValueKind::Empty:
           break;
@@ -153,35 +331,307 @@ namespace bolt {
 
   };
 
+  /**
+   * State that is available to native functions.
+   */
+  class Context {
+  public:
+
+    /**
+     * Where builtins that print something write their output to.
+     */
+    std::ostream& Out;
+
+    Context(std::ostream& Out):
+      Out(Out) {}
+
+  };
+
+  /**
+   * Describes how a C++ type is passed to and returned from a native function
+   * and which Bolt type it corresponds to.
+   *
+   * Only the types that are specialized below can be used in the signature of
+   * a native function. Using any other type results in a compile error.
+   */
+  template<typename T>
+  struct NativeType;
+
+  template<>
+  struct NativeType<Integer> {
+
+    static Type* getType(const Prelude& P) {
+      return P.getIntType();
+    }
+
+    static Integer unwrap(const Value& V) {
+      return V.asInteger();
+    }
+
+    static Value wrap(Integer I) {
+      return I;
+    }
+
+  };
+
+  template<>
+  struct NativeType<ByteStringView> {
+
+    static Type* getType(const Prelude& P) {
+      return P.getStringType();
+    }
+
+    static ByteStringView unwrap(const Value& V) {
+      return V.asString();
+    }
+
+  };
+
+  template<>
+  struct NativeType<ByteString> {
+
+    static Type* getType(const Prelude& P) {
+      return P.getStringType();
+    }
+
+    static Value wrap(ByteString S) {
+      return S;
+    }
+
+  };
+
+  /**
+   * Passes any value as-is. It has no Bolt type, so functions that use it can
+   * be added to an Env but cannot be builtins.
+   */
+  template<>
+  struct NativeType<Value> {
+
+    static const Value& unwrap(const Value& V) {
+      return V;
+    }
+
+    static Value wrap(Value V) {
+      return V;
+    }
+
+  };
+
+  template<auto Fn>
+  struct NativeWrapper;
+
+  /**
+   * Generates a NativeFunction that unpacks its arguments before forwarding
+   * them to \p Fn.
+   *
+   * Only the number of arguments is checked. Callers rely on the checker for
+   * their types, which it knows from the type that getType() derives from
+   * the signature of \p Fn.
+   */
+  template<typename R, typename ...Ts, R(*Fn)(Context&, Ts...)>
+  struct NativeWrapper<Fn> {
+
+    static constexpr std::size_t Arity = sizeof...(Ts);
+
+    template<std::size_t ...Is>
+    static Value call(Context& Ctx, std::span<const Value> Args, std::index_sequence<Is...>) {
+      if constexpr (std::is_void_v<R>) {
+        Fn(Ctx, NativeType<std::remove_cvref_t<Ts>>::unwrap(Args[Is])...);
+        return Value::unit();
+      } else {
+        return NativeType<R>::wrap(Fn(Ctx, NativeType<std::remove_cvref_t<Ts>>::unwrap(Args[Is])...));
+      }
+    }
+
+    static Value call(Context& Ctx, std::span<const Value> Args) {
+      if (Args.size() != Arity) {
+        throw RuntimeError("native function expected " + std::to_string(Arity) + " arguments but got " + std::to_string(Args.size()));
+      }
+      return call(Ctx, Args, std::index_sequence_for<Ts...> {});
+    }
+
+    /**
+     * Build the Bolt type of \p Fn, such as `Int -> Int -> Int` for a function
+     * taking and returning Integer. Functions returning void return `()`.
+     */
+    static Type* getType(const Prelude& P) {
+      Type* ReturnType;
+      if constexpr (std::is_void_v<R>) {
+        ReturnType = new TTuple({});
+      } else {
+        ReturnType = NativeType<R>::getType(P);
+      }
+      return TArrow::build({ NativeType<std::remove_cvref_t<Ts>>::getType(P)... }, ReturnType);
+    }
+
+  };
+
+  /**
+   * A function that is built into the language.
+   *
+   * The checker and the evaluator both get the function from here, so the
+   * type the checker assigns to it always matches its implementation.
+   */
+  struct Builtin {
+
+    ByteString Name;
+
+    NativeFunction Fn;
+
+    Type* (*GetType)(const Prelude&);
+
+  };
+
+  /**
+   * Describe the C++ function \p Fn as a builtin with the given name.
+   */
+  template<auto Fn>
+  Builtin builtin(const ByteString& Name) {
+    return { Name, &NativeWrapper<Fn>::call, &NativeWrapper<Fn>::getType };
+  }
+
+  /**
+   * Get the functions that are built into the language.
+   */
+  const std::vector<Builtin>& getBuiltins();
+
   class Env {
 
+    Env* Parent;
+
     std::unordered_map<ByteString, Value> Bindings;
 
   public:
 
+    Env(Env* Parent = nullptr):
+      Parent(Parent) {}
+
     void add(const ByteString& Name, Value V) {
       Bindings.emplace(Name, V);
     }
 
+    /**
+     * Make the C++ function \p Fn available under the given name.
+     *
+     * The first parameter of \p Fn must be a Context&. The types of the other
+     * parameters and of the return value are checked at compile time using
+     * NativeType.
+     *
+     * The checker does not know about \p Fn, so callers are responsible for
+     * passing the right arguments. Add \p Fn to getBuiltins() instead to
+     * make it part of the language.
+     */
+    template<auto Fn>
+    void addNative(const ByteString& Name) {
+      add(Name, &NativeWrapper<Fn>::call);
+    }
+
+    /**
+     * Get an environment with the same bindings as this one that stays alive
+     * for as long as it is referred to, even after a call frame it copied
+     * the bindings of returned.
+     *
+     * The outermost environment is shared rather than copied, so that
+     * bindings that are added to it later remain visible. A function that is
+     * declared at the top level can therefore refer to itself. The outermost
+     * environment has to outlive the result.
+     */
+    std::shared_ptr<Env> capture() {
+      auto Root = this;
+      while (Root->Parent != nullptr) {
+        Root = Root->Parent;
+      }
+      if (Root == this) {
+        // An empty owner makes the pointer not delete the environment
+        return std::shared_ptr<Env>(std::shared_ptr<Env>(), this);
+      }
+      auto Out = std::make_shared<Env>(Root);
+      for (auto Curr = this; Curr != Root; Curr = Curr->Parent) {
+        // Inner bindings are added first and shadow the outer ones
+        for (const auto& [Name, V]: Curr->Bindings) {
+          Out->Bindings.emplace(Name, V);
+        }
+      }
+      return Out;
+    }
+
     Value& lookup(const ByteString& Name) {
-      auto Match = Bindings.find(Name);
-      ZEN_ASSERT(Match != Bindings.end());
-      return Match->second;
+      auto Curr = this;
+      do {
+        auto Match = Curr->Bindings.find(Name);
+        if (Match != Curr->Bindings.end()) {
+          return Match->second;
+        }
+        Curr = Curr->Parent;
+      } while (Curr != nullptr);
+      ZEN_UNREACHABLE
     }
 
   };
 
+  class Checker;
+
+  /**
+   * An arithmetic operation that is performed directly on two integers instead
+   * of being looked up and called as a function.
+   *
+   * Integers wrap around on overflow. Division truncates towards zero.
+   */
+  enum class IntegerOp {
+    None,
+    Add,
+    Sub,
+    Mul,
+    Div,
+  };
+
   class Evaluator {
 
+    Checker* C;
+
+    Context Ctx;
+
+    std::unordered_map<InfixExpression*, IntegerOp> IntegerOps;
+
+    MatchCompiler Compiler;
+
+    std::unordered_map<MatchExpression*, Decision*> DecisionTrees;
+
+    Decision* getDecisionTree(MatchExpression* M);
+
+    Value evaluateMatch(MatchExpression* M, Value& V, Env& E);
+
   public:
 
-    void assignPattern(Pattern* P, Value& V, Env& E);
+    /**
+     * \param C If given, the types inferred by this checker will be used to
+     * select faster operations.
+     */
+    Evaluator(Checker* C = nullptr, std::ostream& Out = std::cout):
+      C(C), Ctx(Out) {}
+
+    /**
+     * Determine whether the given expression can be computed using an
+     * IntegerOp, based on the types inferred by the checker.
+     *
+     * Returns IntegerOp::None when the operator refers to a declaration in
+     * the program instead of to the builtin.
+     */
+    IntegerOp getIntegerOp(InfixExpression* Infix);
 
-    Value apply(Value Op, std::vector<Value> Args);
+    void assignPattern(Pattern* P, const Value& V, Env& E);
+
+    Value apply(const Value& Op, std::span<const Value> Args);
 
     Value evaluateExpression(Expression* N, Env& E);
 
     void evaluate(Node* N, Env& E);
 
   };
+
+  /**
+   * Add the functions that are built into the language to the given
+   * environment.
+   */
+  void addBuiltins(Env& E);
 }
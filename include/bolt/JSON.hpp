@@ -0,0 +1,104 @@
+
+#pragma once
+
+#include <optional>
+#include <tuple>
+#include <vector>
+
+#include "bolt/ByteString.hpp"
+
+namespace bolt {
+
+  enum class JSONKind {
+    Null,
+    Boolean,
+    Number,
+    String,
+    Array,
+    Object,
+  };
+
+  /**
+   * A parsed JSON document, as received from editors and other tools.
+   *
+   * Members of an object are kept in the order they were written. Objects
+   * sent by tools are small, so they are searched linearly.
+   */
+  class JSONValue {
+
+    JSONKind Kind = JSONKind::Null;
+
+    bool Boolean = false;
+    double Number = 0;
+    ByteString String;
+    std::vector<JSONValue> Elements;
+    std::vector<std::tuple<ByteString, JSONValue>> Members;
+
+  public:
+
+    JSONValue() = default;
+
+    inline JSONKind getKind() const noexcept {
+      return Kind;
+    }
+
+    inline bool isNull() const noexcept {
+      return Kind == JSONKind::Null;
+    }
+
+    inline bool isString() const noexcept {
+      return Kind == JSONKind::String;
+    }
+
+    inline bool isNumber() const noexcept {
+      return Kind == JSONKind::Number;
+    }
+
+    inline bool isArray() const noexcept {
+      return Kind == JSONKind::Array;
+    }
+
+    inline bool isObject() const noexcept {
+      return Kind == JSONKind::Object;
+    }
+
+    inline bool asBoolean() const noexcept {
+      return Boolean;
+    }
+
+    inline double asNumber() const noexcept {
+      return Number;
+    }
+
+    inline const ByteString& asString() const noexcept {
+      return String;
+    }
+
+    inline const std::vector<JSONValue>& getElements() const noexcept {
+      return Elements;
+    }
+
+    /**
+     * Get the member with the given name.
+     *
+     * \returns nullptr if this is not an object or if there is no such member.
+     */
+    const JSONValue* get(ByteStringView Name) const;
+
+    /**
+     * Follow a path of member names, such as `{ "params", "textDocument", "uri" }`.
+     */
+    const JSONValue* get(std::initializer_list<ByteStringView> Path) const;
+
+    /**
+     * Parse a complete JSON document.
+     *
+     * \returns std::nullopt if \p Text is not valid JSON.
+     */
+    static std::optional<JSONValue> parse(ByteStringView Text);
+
+    friend class JSONParser;
+
+  };
+
+}
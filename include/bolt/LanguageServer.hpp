@@ -0,0 +1,134 @@
+
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+
+#include "bolt/ByteString.hpp"
+#include "bolt/CST.hpp"
+#include "bolt/Common.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/JSON.hpp"
+
+namespace bolt {
+
+  class Checker;
+
+  /**
+   * Answers requests of an editor using the Language Server Protocol.
+   *
+   * Messages are read from and written to a stream using the base protocol,
+   * which prefixes every JSON-RPC message with a Content-Length header.
+   *
+   * Documents are kept in memory while they are open in the editor. Changes
+   * to the text are spliced into the document, only the top-level elements
+   * that were edited are parsed again and the result is checked again right
+   * away, after which the diagnostics are published. Hovering
+   * over an expression shows its type.
+   *
+   * Columns are counted in bytes when the client supports UTF-8 positions
+   * and in UTF-16 code units otherwise, as the protocol requires.
+   */
+  class LanguageServer {
+
+    enum class PositionEncoding {
+      UTF8,
+      UTF16,
+    };
+
+    struct Document {
+
+      /**
+       * The diagnostics of parsing the text, which reparseSourceFile() keeps
+       * up to date while the text is edited.
+       */
+      DiagnosticStore ParseDiagnostics;
+
+      /**
+       * The diagnostics of the last time the document was checked.
+       */
+      std::unique_ptr<DiagnosticStore> CheckDiagnostics;
+
+      SourceFile* SF = nullptr;
+
+      Checker* C = nullptr;
+
+      ~Document();
+
+    };
+
+    const LanguageConfig& Config;
+
+    std::ostream& Out;
+
+    std::unordered_map<ByteString, std::unique_ptr<Document>> Documents;
+
+    DiagnosticMessageRenderer Messages;
+
+    bool ShutdownRequested = false;
+
+    /**
+     * What the character of a position counts, as agreed upon when the
+     * client initialized the server.
+     */
+    PositionEncoding Encoding = PositionEncoding::UTF16;
+
+    /**
+     * How many times a document was parsed and checked.
+     */
+    std::size_t RebuildCount = 0;
+
+    /**
+     * Parse the document at \p URI that was just opened.
+     */
+    Document* open(const ByteString& URI, ByteStringView Text);
+
+    /**
+     * Check the document again after its text changed.
+     */
+    void rebuild(Document* Doc);
+
+    /**
+     * Convert a zero-based LSP position to an offset in \p File.
+     */
+    std::size_t getOffset(const TextFile& File, const JSONValue& Position) const;
+
+    void writePosition(ByteString& Out, const TextFile& File, const TextLoc& Loc) const;
+    void writeRange(ByteString& Out, const TextFile& File, const TextRange& Range) const;
+
+    void publishDiagnostics(const ByteString& URI, Document* Doc);
+
+    ByteString hover(Document* Doc, const JSONValue& Position);
+
+    void send(const ByteString& Message);
+    void sendResult(const JSONValue& Id, ByteStringView Result);
+    void sendError(const JSONValue& Id, int Code, ByteStringView Message);
+
+  public:
+
+    LanguageServer(const LanguageConfig& Config, std::ostream& Out);
+
+    /**
+     * Answer a single JSON-RPC message.
+     *
+     * \returns false if the client asked the server to exit.
+     */
+    bool handle(const JSONValue& Message);
+
+    inline std::size_t getRebuildCount() const noexcept {
+      return RebuildCount;
+    }
+
+    /**
+     * Answer messages read from \p In until the client asks the server to
+     * exit or closes the stream.
+     *
+     * \returns The exit code for the process.
+     */
+    int serve(std::istream& In);
+
+  };
+
+}
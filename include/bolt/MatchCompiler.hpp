@@ -0,0 +1,263 @@
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <vector>
+#include <unordered_map>
+
+#include "bolt/CST.hpp"
+
+namespace bolt {
+
+  /**
+   * Indicates how to get from the value that is being matched on to a value
+   * nested somewhere inside of it.
+   *
+   * Each element is an index into the fields of a variant member, the elements
+   * of a tuple or the elements of a list, depending on what was tested before.
+   */
+  using MatchPath = std::vector<std::size_t>;
+
+  enum class DecisionKind {
+    Fail,
+    Leaf,
+    Switch,
+  };
+
+  class Decision {
+
+    const DecisionKind Kind;
+
+  protected:
+
+    inline Decision(DecisionKind Kind):
+      Kind(Kind) {}
+
+  public:
+
+    inline DecisionKind getKind() const noexcept {
+      return Kind;
+    }
+
+    virtual ~Decision() {}
+
+  };
+
+  /**
+   * Reached when none of the match cases apply to the value.
+   */
+  class DecisionFail : public Decision {
+  public:
+
+    inline DecisionFail():
+      Decision(DecisionKind::Fail) {}
+
+    static bool classof(const Decision* D) {
+      return D->getKind() == DecisionKind::Fail;
+    }
+
+  };
+
+  class DecisionLeaf : public Decision {
+  public:
+
+    MatchCase* Case;
+
+    /**
+     * The variables that have to be bound before evaluating the expression of
+     * the match case, together with where their value can be found.
+     */
+    std::vector<std::tuple<BindPattern*, MatchPath>> Bindings;
+
+    inline DecisionLeaf(
+      MatchCase* Case,
+      std::vector<std::tuple<BindPattern*, MatchPath>> Bindings
+    ): Decision(DecisionKind::Leaf),
+       Case(Case),
+       Bindings(Bindings) {}
+
+    static bool classof(const Decision* D) {
+      return D->getKind() == DecisionKind::Leaf;
+    }
+
+  };
+
+  enum class SwitchKind {
+
+    /**
+     * Test the tag of a variant member. Jumps through a table indexed by the
+     * position of the member in its enum declaration.
+     */
+    Constructor,
+
+    /**
+     * Test an integer or string literal.
+     */
+    Literal,
+
+    /**
+     * Test the amount of elements in a list.
+     */
+    Length,
+
+  };
+
+  class DecisionSwitch : public Decision {
+  public:
+
+    SwitchKind Test;
+    MatchPath Path;
+
+    /**
+     * Only used for SwitchKind::Constructor. Contains one entry for each member
+     * of the enum. Members that are not mentioned in any of the match cases
+     * point to Default.
+     */
+    std::vector<Decision*> Table;
+
+    /**
+     * Used for SwitchKind::Literal and SwitchKind::Length. List lengths are
+     * stored as an Integer.
+     */
+    std::unordered_map<LiteralValue, Decision*> Cases;
+
+    Decision* Default;
+
+    inline DecisionSwitch(
+      SwitchKind Test,
+      MatchPath Path,
+      Decision* Default
+    ): Decision(DecisionKind::Switch),
+       Test(Test),
+       Path(Path),
+       Default(Default) {}
+
+    inline Decision* getCase(std::size_t Tag) const {
+      ZEN_ASSERT(Test == SwitchKind::Constructor && Tag < Table.size());
+      return Table[Tag];
+    }
+
+    inline Decision* getCase(const LiteralValue& Value) const {
+      ZEN_ASSERT(Test != SwitchKind::Constructor);
+      auto Match = Cases.find(Value);
+      return Match != Cases.end() ? Match->second : Default;
+    }
+
+    static bool classof(const Decision* D) {
+      return D->getKind() == DecisionKind::Switch;
+    }
+
+  };
+
+  /**
+   * Information about a single member of an enum declaration as it is needed
+   * for compiling patterns.
+   */
+  struct ConstructorInfo {
+
+    /**
+     * The position of the member inside its enum declaration.
+     */
+    std::size_t Tag;
+
+    /**
+     * The amount of fields the member holds.
+     */
+    std::size_t Arity;
+
+    /**
+     * The total amount of members in the enum declaration.
+     */
+    std::size_t Span;
+
+  };
+
+  /**
+   * Turns the cases of a match-expression into a decision tree.
+   *
+   * Each value is tested at most once on any path through the tree, no matter
+   * how many match cases inspect it. Tests on enum members dispatch through a
+   * table, so that a match over a large enum does not test each case one after
+   * another.
+   *
+   * The result only refers to the CST, so both the evaluator and code
+   * generators can consume it. The decisions are owned by the compiler and
+   * are freed together with it.
+   */
+  class MatchCompiler {
+
+    struct Row {
+      std::vector<Pattern*> Patterns;
+      MatchCase* Case;
+      std::vector<std::tuple<BindPattern*, MatchPath>> Bindings;
+    };
+
+    using Matrix = std::vector<Row>;
+
+    std::vector<std::unique_ptr<Decision>> Decisions;
+
+    DecisionFail TheFail;
+
+    /**
+     * The first pattern of the match-expression that is being compiled that
+     * refers to a constructor without a declaration.
+     */
+    NamedPattern* UnknownConstructor = nullptr;
+
+    template<typename T, typename ...Ts>
+    T* create(Ts&&... Args) {
+      auto D = new T(std::forward<Ts>(Args)...);
+      Decisions.push_back(std::unique_ptr<Decision>(D));
+      return D;
+    }
+
+    void normalize(Row& R, const std::vector<MatchPath>& Paths);
+
+    Decision* compile(std::vector<MatchPath> Paths, Matrix Rows);
+
+    Decision* compileConstructors(std::vector<MatchPath>& Paths, Matrix& Rows, std::size_t Column);
+    Decision* compileLiterals(std::vector<MatchPath>& Paths, Matrix& Rows, std::size_t Column);
+    Decision* compileLists(std::vector<MatchPath>& Paths, Matrix& Rows, std::size_t Column);
+
+    /**
+     * Replace column \p Column by \p Arity new columns that hold the nested
+     * patterns of the rows.
+     */
+    static std::vector<MatchPath> expandPaths(const std::vector<MatchPath>& Paths, std::size_t Column, std::size_t Arity);
+
+    static Matrix getDefaultRows(const Matrix& Rows, std::size_t Column);
+
+  public:
+
+    /**
+     * Look up the enum member that is referred to by the given pattern.
+     */
+    static std::optional<ConstructorInfo> getConstructorInfo(NamedPattern* P);
+
+    /**
+     * Look up the enum member with the given name that is visible from \p
+     * Source.
+     *
+     * Returns nothing if the member is not declared in the source file, such
+     * as when it comes from another module.
+     */
+    static std::optional<ConstructorInfo> getConstructorInfo(Node* Source, const ByteString& Name);
+
+    /**
+     * Compile the cases of \p M into a decision tree.
+     *
+     * Returns nullptr if one of the patterns refers to a constructor that
+     * getConstructorInfo() cannot find. getUnknownConstructor() then returns
+     * that pattern.
+     */
+    Decision* compile(MatchExpression* M);
+
+    inline NamedPattern* getUnknownConstructor() const {
+      return UnknownConstructor;
+    }
+
+  };
+
+}
+
@@ -0,0 +1,57 @@
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <tuple>
+#include <vector>
+
+#include "bolt/ByteString.hpp"
+
+namespace bolt {
+
+  class LanguageConfig;
+  class SourceFile;
+
+  /**
+   * The extension of files that contain the interface of a module, as
+   * written by Checker::writeInterface().
+   */
+  constexpr const char* ModuleInterfaceExtension = ".bolti";
+
+  /**
+   * The extension of files that record what the interface of a module was
+   * computed from, as returned by getModuleStamp().
+   */
+  constexpr const char* ModuleStampExtension = ".boltstamp";
+
+  /**
+   * Get the name other modules use to refer to the module in \p Path, which
+   * is the name of the file without its extension.
+   */
+  ByteString getModuleNameForPath(const std::filesystem::path& Path);
+
+  /**
+   * Get the names of all modules \p SF refers to, such as `Math` in
+   * `Math.add 1 2`, sorted and without duplicates.
+   */
+  std::vector<ByteString> getImportedModules(SourceFile* SF);
+
+  /**
+   * Hash \p Data in a way that gives the same result on every run and every
+   * platform, unlike std::hash.
+   */
+  std::uint64_t getFingerprint(ByteStringView Data, std::uint64_t Hash = 14695981039346656037ull);
+
+  /**
+   * Summarize everything the interface of a module is computed from: its
+   * source text and the interfaces of the modules it imports, given as pairs
+   * of a name and an interface that is empty when there is none.
+   *
+   * Only the interfaces of the imported modules take part, so a change to a
+   * module that leaves its interface as it was does not change the stamps of
+   * the modules that import it.
+   */
+  ByteString getModuleStamp(const LanguageConfig& Config, ByteStringView Text, const std::vector<std::tuple<ByteString, ByteString>>& Imports);
+
+}
@@ -10,6 +10,7 @@
 namespace bolt {
 
   class DiagnosticEngine;
+  class DiagnosticStore;
   class Scanner;
 
   enum OperatorFlags {
@@ -67,6 +68,12 @@ namespace bolt {
 
     OperatorTable ExprOperators;
 
+    /**
+     * The tokens skipToLineFoldEnd() skipped over that were not placed in the
+     * tree yet.
+     */
+    std::vector<Token*> Skipped;
+
     Token* peekFirstTokenAfterAnnotationsAndModifiers();
 
     Token* expectToken(NodeKind Ty);
@@ -99,6 +106,21 @@ namespace bolt {
     void checkLineFoldEnd();
     void skipToLineFoldEnd();
 
+    /**
+     * Move the tokens that were skipped into a new InvalidExpression.
+     *
+     * \returns nullptr if no tokens were skipped.
+     */
+    InvalidExpression* takeSkippedTokens();
+
+    void discardSkippedTokens();
+
+    /**
+     * Keep the tokens of an element that could not be parsed in the tree, so
+     * that the elements around it can still be checked.
+     */
+    Node* recoverElement(Node* Element);
+
   public:
 
     Parser(TextFile& File, Stream<Token*>& S, DiagnosticEngine& DE);
@@ -142,9 +164,32 @@ namespace bolt {
 
     Node* parseSourceElement();
 
+    /**
+     * Parse top-level elements until the end of the token stream.
+     *
+     * \param Starts Receives where the line fold of each element starts.
+     */
+    std::vector<Node*> parseSourceElements(std::vector<TextLoc>& Starts);
+
     SourceFile* parseSourceFile();
 
   };
 
+  /**
+   * Replace the text between \p StartOffset and \p EndOffset of \p SF with
+   * \p NewText and parse again only the top-level elements that the edit
+   * touched.
+   *
+   * The tokens of the elements after the edit are moved to their new lines.
+   * When the new text could change how the rest of the file is parsed, such
+   * as when it opens a '{' that is not closed, the whole file is parsed again.
+   *
+   * \param DS The diagnostics of parsing \p SF. Those of the text that was
+   *           parsed again are replaced by new ones.
+   *
+   * \returns How many top-level elements were parsed.
+   */
+  std::size_t reparseSourceFile(SourceFile* SF, std::size_t StartOffset, std::size_t EndOffset, ByteStringView NewText, DiagnosticStore& DS);
+
 }
 
@@ -48,13 +48,35 @@ namespace bolt {
 
     Token* readNullable();
 
+    std::size_t TokenCount = 0;
+
+    bool UnterminatedString = false;
+
   protected:
 
     Token* read() override;
 
   public:
 
-    Scanner(DiagnosticEngine& DE, TextFile& File, Stream<Char>& Chars);
+    /**
+     * \param Start The location of the first character of \p Chars, for when
+     *              only a part of \p File is scanned.
+     */
+    Scanner(DiagnosticEngine& DE, TextFile& File, Stream<Char>& Chars, TextLoc Start = TextLoc {});
+
+    /**
+     * Get how many tokens were produced so far.
+     */
+    inline std::size_t getTokenCount() const noexcept {
+      return TokenCount;
+    }
+
+    /**
+     * Check whether the characters ran out in the middle of a string literal.
+     */
+    inline bool hasUnterminatedString() const noexcept {
+      return UnterminatedString;
+    }
 
   };
 
@@ -71,6 +93,8 @@ namespace bolt {
     std::stack<FrameType> Frames;
     std::stack<TextLoc> Locations;
 
+    bool UnclosedBrace = false;
+
   protected:
 
     virtual Token* read() override;
@@ -79,6 +103,13 @@ namespace bolt {
 
     Punctuator(Stream<Token*>& Tokens);
 
+    /**
+     * Check whether the tokens ran out while a '{' was still open.
+     */
+    inline bool hasUnclosedBrace() const noexcept {
+      return UnclosedBrace;
+    }
+
   };
 
 }
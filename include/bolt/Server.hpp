@@ -0,0 +1,111 @@
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+
+#include "bolt/ByteString.hpp"
+#include "bolt/CST.hpp"
+#include "bolt/Common.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+
+namespace bolt {
+
+  class Checker;
+
+  /**
+   * Keeps parsed and checked source files in memory between requests, so
+   * that checking a file that did not change costs no more than a call to
+   * stat().
+   *
+   * Requests are single lines of text and are answered with zero or more
+   * diagnostics in JSON Lines format, followed by a single status record:
+   *
+   *  - `check <file>...` reports the diagnostics of the given files,
+   *    reparsing and rechecking only those that were modified
+   *  - `changed <file>...` makes the next `check` read the files again, even
+   *    if their modification time is the same
+   *  - `forget <file>...` removes the files from memory
+   *  - `shutdown` stops the server
+   *
+   * Files are separated by whitespace and can therefore not contain spaces.
+   */
+  class CompileServer {
+
+    struct CachedFile {
+
+      /**
+       * Diagnostics of the parser refer to this file, so it must live as
+       * long as they do.
+       */
+      std::unique_ptr<TextFile> File;
+
+      std::filesystem::file_time_type ModifiedTime;
+
+      /**
+       * Set when a client told us the file changed.
+       */
+      bool IsStale = false;
+
+      DiagnosticStore Diagnostics;
+
+      SourceFile* SF = nullptr;
+
+      /**
+       * Owns the schemes and types of the declarations in this file.
+       */
+      Checker* C = nullptr;
+
+      ~CachedFile();
+
+    };
+
+    const LanguageConfig& Config;
+
+    std::unordered_map<ByteString, std::unique_ptr<CachedFile>> Files;
+
+    /**
+     * How many files were parsed and checked since the server was started.
+     */
+    std::size_t RebuildCount = 0;
+
+    /**
+     * Make sure the cached version of the file at \p Path is up-to-date.
+     *
+     * \returns nullptr if the file could not be read.
+     */
+    CachedFile* update(const ByteString& Path);
+
+    void writeStatus(std::ostream& Out, ByteStringView Status, ByteStringView Extra = {});
+
+  public:
+
+    CompileServer(const LanguageConfig& Config);
+
+    /**
+     * Answer a single request.
+     *
+     * \returns false if the server was asked to stop.
+     */
+    bool handle(ByteStringView Request, std::ostream& Out);
+
+    /**
+     * Get how many times a file was parsed and checked, for testing purposes.
+     */
+    inline std::size_t getRebuildCount() const noexcept {
+      return RebuildCount;
+    }
+
+    /**
+     * Answer requests on a Unix domain socket until a client sends
+     * `shutdown`.
+     *
+     * \returns The exit code for the process.
+     */
+    int serve(const std::string& SocketPath);
+
+  };
+
+}
@@ -0,0 +1,104 @@
+
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <tuple>
+#include <vector>
+
+#include "bolt/ByteString.hpp"
+
+namespace bolt {
+
+  /**
+   * Collects how long each phase of the compiler took and how much work it
+   * did.
+   *
+   * Nothing is measured while the statistics are disabled, so instrumented
+   * code can stay in place in production builds.
+   */
+  class Statistics {
+  public:
+
+    using Clock = std::chrono::steady_clock;
+
+  private:
+
+    bool Enabled;
+
+    std::vector<std::tuple<ByteString, Clock::duration>> Timers;
+    std::vector<std::tuple<ByteString, std::size_t>> Counters;
+
+  public:
+
+    Statistics(bool Enabled = false):
+      Enabled(Enabled) {}
+
+    inline bool isEnabled() const noexcept {
+      return Enabled;
+    }
+
+    /**
+     * Add the given duration to the timer with the given name.
+     *
+     * Timers are reported in the order in which they were first used.
+     */
+    void addTime(ByteStringView Name, Clock::duration Duration);
+
+    /**
+     * Add \p Count to the counter with the given name.
+     */
+    void addCount(ByteStringView Name, std::size_t Count);
+
+    std::size_t getCount(ByteStringView Name) const;
+
+    /**
+     * Get the total time that was recorded by the timer with the given name.
+     */
+    Clock::duration getTime(ByteStringView Name) const;
+
+    void writeTimers(std::ostream& Out) const;
+    void writeCounters(std::ostream& Out) const;
+
+    /**
+     * Write the timers and the counters as a single JSON object.
+     */
+    void writeJSON(std::ostream& Out, bool IncludeTimers = true, bool IncludeCounters = true) const;
+
+  };
+
+  /**
+   * Adds the time between its construction and its destruction to a timer.
+   */
+  class ScopedTimer {
+
+    Statistics& S;
+    const char* Name;
+    Statistics::Clock::time_point Start;
+
+  public:
+
+    inline ScopedTimer(Statistics& S, const char* Name):
+      S(S), Name(Name) {
+        if (S.isEnabled()) {
+          Start = Statistics::Clock::now();
+        }
+      }
+
+    inline ~ScopedTimer() {
+      if (S.isEnabled()) {
+        S.addTime(Name, Statistics::Clock::now() - Start);
+      }
+    }
+
+  };
+
+  /**
+   * Get the maximum amount of memory this process has used, in kibibytes.
+   *
+   * \returns 0 if the platform does not support this.
+   */
+  std::size_t getPeakMemoryUsage();
+
+}
+
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bolt/Support/Graph.hpp"
+
+namespace bolt {
+
+  /**
+   * What happened while running the tasks of a graph.
+   */
+  struct ScheduleResult {
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * The sum of the time each task took.
+     */
+    Clock::duration TotalTime {};
+
+    /**
+     * How long the slowest chain of tasks that depend on each other took.
+     *
+     * No amount of threads can finish sooner than this.
+     */
+    Clock::duration CriticalPathTime {};
+
+    /**
+     * How many tasks are on the slowest chain.
+     */
+    std::size_t CriticalPathLength = 0;
+
+  };
+
+  /**
+   * Run \p Fn once for every strongly connected component of \p G, using up
+   * to \p Jobs threads.
+   *
+   * An edge from A to B means that A depends on B: the task of a component
+   * only starts when the tasks of all components it depends on finished.
+   * Vertices that depend on each other end up in the same component and are
+   * therefore handled by a single task.
+   *
+   * \p Fn is called with a `const std::vector<V>&` and may be called from any
+   * thread, including the calling one.
+   */
+  template<typename V, typename F>
+  ScheduleResult runInDependencyOrder(const Graph<V>& G, std::size_t Jobs, F Fn) {
+
+    using Clock = ScheduleResult::Clock;
+
+    struct Task {
+      std::vector<V> Vertices;
+      std::vector<std::size_t> Dependents;
+      std::vector<std::size_t> Dependencies;
+      std::size_t PendingCount = 0;
+      Clock::duration Time {};
+    };
+
+    // Components are returned in such a way that a component comes after all
+    // of the components it depends on.
+    std::vector<Task> Tasks;
+    std::unordered_map<V, std::size_t> TaskOf;
+    for (auto& SCC: G.strongconnect()) {
+      for (const auto& Vert: SCC) {
+        TaskOf.emplace(Vert, Tasks.size());
+      }
+      Tasks.push_back(Task { std::move(SCC) });
+    }
+
+    for (std::size_t I = 0; I < Tasks.size(); I++) {
+      for (const auto& From: Tasks[I].Vertices) {
+        for (const auto& To: G.getTargetVertices(From)) {
+          auto J = TaskOf[To];
+          if (J == I || std::find(Tasks[I].Dependencies.begin(), Tasks[I].Dependencies.end(), J) != Tasks[I].Dependencies.end()) {
+            continue;
+          }
+          Tasks[I].Dependencies.push_back(J);
+          Tasks[J].Dependents.push_back(I);
+          Tasks[I].PendingCount++;
+        }
+      }
+    }
+
+    std::mutex Mutex;
+    std::condition_variable Changed;
+    std::deque<std::size_t> Ready;
+    std::size_t FinishedCount = 0;
+
+    for (std::size_t I = 0; I < Tasks.size(); I++) {
+      if (Tasks[I].PendingCount == 0) {
+        Ready.push_back(I);
+      }
+    }
+
+    auto Work = [&]() {
+      std::unique_lock Lock { Mutex };
+      for (;;) {
+        Changed.wait(Lock, [&] { return !Ready.empty() || FinishedCount == Tasks.size(); });
+        if (Ready.empty()) {
+          break;
+        }
+        auto I = Ready.front();
+        Ready.pop_front();
+        Lock.unlock();
+        auto Start = Clock::now();
+        Fn(static_cast<const std::vector<V>&>(Tasks[I].Vertices));
+        auto Time = Clock::now() - Start;
+        Lock.lock();
+        Tasks[I].Time = Time;
+        FinishedCount++;
+        for (auto J: Tasks[I].Dependents) {
+          if (--Tasks[J].PendingCount == 0) {
+            Ready.push_back(J);
+          }
+        }
+        Changed.notify_all();
+      }
+    };
+
+    std::vector<std::thread> Workers;
+    for (std::size_t I = 1; I < std::min(Jobs, Tasks.size()); I++) {
+      Workers.emplace_back(Work);
+    }
+    Work();
+    for (auto& Worker: Workers) {
+      Worker.join();
+    }
+
+    // Dependencies always come first, so one pass suffices to find the
+    // longest path.
+    ScheduleResult Result;
+    std::vector<Clock::duration> FinishTime(Tasks.size());
+    std::vector<std::size_t> PathLength(Tasks.size());
+    for (std::size_t I = 0; I < Tasks.size(); I++) {
+      Clock::duration Longest {};
+      std::size_t Length = 0;
+      for (auto J: Tasks[I].Dependencies) {
+        if (FinishTime[J] > Longest || (FinishTime[J] == Longest && PathLength[J] > Length)) {
+          Longest = FinishTime[J];
+          Length = PathLength[J];
+        }
+      }
+      FinishTime[I] = Longest + Tasks[I].Time;
+      PathLength[I] = Length + 1;
+      Result.TotalTime += Tasks[I].Time;
+      if (FinishTime[I] > Result.CriticalPathTime
+          || (FinishTime[I] == Result.CriticalPathTime && PathLength[I] > Result.CriticalPathLength)) {
+        Result.CriticalPathTime = FinishTime[I];
+        Result.CriticalPathLength = PathLength[I];
+      }
+    }
+    return Result;
+  }
+
+}
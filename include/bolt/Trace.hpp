@@ -0,0 +1,131 @@
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "bolt/ByteString.hpp"
+
+namespace bolt {
+
+  class Node;
+
+  /**
+   * Writes events in the Trace Event Format, which can be opened in
+   * chrome://tracing or Perfetto.
+   *
+   * Events are written as soon as they are complete, so a trace of a large
+   * program never has to be kept in memory.
+   *
+   * Events may be added from several threads at once. Each thread gets its
+   * own track in the viewer.
+   */
+  class TraceWriter {
+  public:
+
+    using Clock = std::chrono::steady_clock;
+
+  private:
+
+    std::ostream& Out;
+
+    Clock::time_point Origin;
+
+    ByteString Buffer;
+
+    std::mutex Mutex;
+
+    std::unordered_map<std::thread::id, std::size_t> ThreadIds;
+
+    bool HasEvents = false;
+    bool HasFinished = false;
+
+  public:
+
+    TraceWriter(std::ostream& Out);
+
+    /**
+     * Write a single event that started at \p Start and ended at \p End.
+     *
+     * \param Args Key-value pairs that are shown when the event is selected.
+     */
+    void addEvent(
+      ByteStringView Name,
+      ByteStringView Category,
+      Clock::time_point Start,
+      Clock::time_point End,
+      const std::vector<std::tuple<ByteString, ByteString>>& Args = {}
+    );
+
+    /**
+     * Close the trace. No more events can be added afterwards.
+     */
+    void finish();
+
+    ~TraceWriter();
+
+  };
+
+  /**
+   * Records the time between its construction and its destruction as an
+   * event.
+   *
+   * When no writer is given nothing is measured, so the checker can be
+   * instrumented without slowing it down.
+   */
+  class TraceEvent {
+
+    TraceWriter* W;
+    ByteString Name;
+    const char* Category;
+    TraceWriter::Clock::time_point Start;
+    std::vector<std::tuple<ByteString, ByteString>> Args;
+
+  public:
+
+    inline TraceEvent(TraceWriter* W, const char* Category, ByteStringView Name):
+      W(W), Category(Category) {
+        if (W != nullptr) {
+          this->Name = Name;
+          Start = TraceWriter::Clock::now();
+        }
+      }
+
+    TraceEvent(const TraceEvent&) = delete;
+    TraceEvent& operator=(const TraceEvent&) = delete;
+
+    inline bool isEnabled() const noexcept {
+      return W != nullptr;
+    }
+
+    /**
+     * Replace the name that was given to the constructor, for when the name
+     * is expensive to compute and should only be computed when tracing.
+     */
+    inline void setName(ByteStringView NewName) {
+      if (W != nullptr) {
+        Name = NewName;
+      }
+    }
+
+    void addArg(ByteStringView Key, ByteStringView Value);
+
+    /**
+     * Add the file and the range of text that \p N covers to this event.
+     */
+    void addSourceRange(Node* N);
+
+    inline ~TraceEvent() {
+      if (W != nullptr) {
+        W->addEvent(Name, Category, Start, TraceWriter::Clock::now(), Args);
+      }
+    }
+
+  };
+
+}
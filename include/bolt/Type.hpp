@@ -227,8 +227,14 @@ namespace bolt {
     const size_t Id;
     ByteString DisplayName;
 
-    inline TCon(const size_t Id, ByteString DisplayName):
-      Type(TypeKind::Con), Id(Id), DisplayName(DisplayName) {}
+    /**
+     * The module that declared this type if it was loaded from a module
+     * interface, or empty otherwise.
+     */
+    ByteString Module;
+
+    inline TCon(const size_t Id, ByteString DisplayName, ByteString Module = {}):
+      Type(TypeKind::Con), Id(Id), DisplayName(DisplayName), Module(Module) {}
 
     static bool classof(const Type* Ty) {
       return Ty->getKind() == TypeKind::Con;
@@ -0,0 +1,80 @@
+
+#pragma once
+
+#include "bolt/ByteString.hpp"
+
+namespace bolt {
+
+  /**
+   * Describes a synthetic program that is used to find out how the compiler
+   * scales.
+   *
+   * Every part of the program is generated once per repetition with names
+   * that are unique to that repetition, so a program can be made as large as
+   * needed without changing its shape.
+   */
+  struct WorkloadOptions {
+
+    /**
+     * How many small integer functions to generate. Each function is
+     * applied to the result of the one before it.
+     */
+    std::size_t Functions = 0;
+
+    /**
+     * How deep to nest functions that are declared inside of other
+     * functions. The innermost function uses a parameter of the outermost.
+     */
+    std::size_t LetDepth = 0;
+
+    /**
+     * How many functions call each other in a single cycle.
+     */
+    std::size_t CycleLength = 0;
+
+    /**
+     * How many recursive functions to generate. Each one calls itself to a
+     * depth of ten and passes every intermediate result to a helper function
+     * that is declared at the top level.
+     */
+    std::size_t Recursions = 0;
+
+    /**
+     * How many fields the generated record has. Every field is read once.
+     */
+    std::size_t RecordWidth = 0;
+
+    /**
+     * How many cases the generated match-expression has.
+     */
+    std::size_t MatchCases = 0;
+
+    /**
+     * How many times a function that is constrained by a type class is
+     * applied, alternating between three instances.
+     */
+    std::size_t ClassUses = 0;
+
+    /**
+     * How many polymorphic functions that build nested tuples to generate.
+     */
+    std::size_t Tuples = 0;
+
+    /**
+     * How many times to generate all of the above.
+     */
+    std::size_t Repeat = 1;
+
+    /**
+     * Keep repeating until the program is at least this many bytes long.
+     */
+    std::size_t MinSize = 0;
+
+  };
+
+  /**
+   * Generate a program that passes the type checker without diagnostics.
+   */
+  ByteString generateWorkload(const WorkloadOptions& Options);
+
+}
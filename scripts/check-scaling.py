@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+
+"""
+Check that parsing and type checking take time that is linear in the size of
+the program.
+
+Programs of increasing size are generated with boltgen and checked with
+`bolt --time-passes`. For every shape of program the growth exponent is
+estimated from a least-squares fit of log(time) against log(size). The script
+fails when an exponent is larger than --max-exponent.
+"""
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+SHAPES = {
+    'functions': [ '--functions=64' ],
+    'let-depth': [ '--let-depth=32' ],
+    'cycles': [ '--cycle-length=32' ],
+    'records': [ '--record-width=32' ],
+    'matches': [ '--match-cases=32' ],
+    'classes': [ '--class-uses=32' ],
+    'tuples': [ '--tuples=32' ],
+}
+
+PHASES = [ 'parse', 'check' ]
+
+def measure(bolt, boltgen, shape_args, size, runs):
+    with tempfile.NamedTemporaryFile(suffix='.bolt', delete=False) as f:
+        path = f.name
+        subprocess.run([ boltgen, f'--size={size}' ] + shape_args, stdout=f, check=True)
+    try:
+        best = {}
+        for _ in range(runs):
+            result = subprocess.run(
+                [ bolt, '--time-passes', '--stats-format=json', 'check', path ],
+                stdout=subprocess.DEVNULL,
+                stderr=subprocess.PIPE,
+                text=True,
+            )
+            if result.returncode != 0:
+                raise RuntimeError(f'bolt reported diagnostics for a generated program of {size} bytes')
+            timers = json.loads(result.stderr.strip().splitlines()[-1])['timers']
+            for phase in PHASES:
+                best[phase] = min(best.get(phase, math.inf), timers.get(phase, 0.0))
+        return best
+    finally:
+        os.unlink(path)
+
+def fit_exponent(sizes, times):
+    points = [ (math.log(s), math.log(t)) for s, t in zip(sizes, times) if t > 0 ]
+    if len(points) < 2:
+        return 0.0
+    mean_x = sum(x for x, _ in points) / len(points)
+    mean_y = sum(y for _, y in points) / len(points)
+    num = sum((x - mean_x) * (y - mean_y) for x, y in points)
+    den = sum((x - mean_x) ** 2 for x, _ in points)
+    return num / den
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--bolt', default='build/bolt', help='Path to the bolt executable')
+    parser.add_argument('--boltgen', default='build/boltgen', help='Path to the boltgen executable')
+    parser.add_argument('--sizes', default='100000,200000,400000,800000', help='Comma-separated program sizes in bytes')
+    parser.add_argument('--shapes', default=','.join(SHAPES), help='Comma-separated shapes to test')
+    parser.add_argument('--runs', type=int, default=3, help='How many times to check every program; the fastest run is used')
+    parser.add_argument('--max-exponent', type=float, default=1.3, help='The largest growth exponent that is accepted')
+    args = parser.parse_args()
+
+    sizes = [ int(s) for s in args.sizes.split(',') ]
+    failed = False
+
+    for shape in args.shapes.split(','):
+        samples = [ measure(args.bolt, args.boltgen, SHAPES[shape], size, args.runs) for size in sizes ]
+        for phase in PHASES:
+            times = [ sample[phase] for sample in samples ]
+            exponent = fit_exponent(sizes, times)
+            status = 'ok'
+            if exponent > args.max_exponent:
+                status = 'SUPER-LINEAR'
+                failed = True
+            timings = ' '.join(f'{t:.4f}s' for t in times)
+            print(f'{shape:>10} {phase:>6}  n^{exponent:.2f}  {status:<12}  {timings}')
+
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
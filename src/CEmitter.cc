@@ -0,0 +1,1105 @@
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+#include "zen/config.hpp"
+
+#include "bolt/CST.hpp"
+#include "bolt/Type.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/Diagnostics.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/CEmitter.hpp"
+
+namespace bolt {
+
+  static const char* Runtime = R"c(/* Generated by the Bolt compiler. Do not edit. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+typedef char bolt_unit;
+
+typedef union {
+  int64_t i;
+  bool b;
+  const char* s;
+  void* p;
+} bolt_word;
+
+typedef struct {
+  uint64_t tag;
+  bolt_word fields[];
+} bolt_variant;
+
+static void bolt_panic(const char* message) {
+  fprintf(stderr, "error: %s\n", message);
+  exit(1);
+}
+
+static inline void bolt_match_failure(void) {
+  bolt_panic("no match case applies to the given value");
+}
+
+/* A conservative mark-and-sweep garbage collector. Every word on the stack,
+   in the saved registers, in a registered root or inside a live object that
+   points anywhere inside an object keeps that object alive. An optimizing C
+   compiler may only keep a pointer into the middle of an object around, so
+   pointers to the start of an object are not enough. */
+
+typedef struct bolt_object {
+  struct bolt_object* next;
+  size_t size;
+  bool marked;
+} bolt_object;
+
+typedef struct {
+  void* start;
+  size_t size;
+} bolt_root;
+
+static bolt_object* bolt_objects = NULL;
+static size_t bolt_object_count = 0;
+static size_t bolt_allocated = 0;
+static size_t bolt_threshold = 1 << 20;
+static char* bolt_stack_bottom = NULL;
+
+static bolt_root* bolt_roots = NULL;
+static size_t bolt_root_count = 0;
+
+static bolt_object** bolt_sorted = NULL;
+static size_t bolt_sorted_capacity = 0;
+
+static bolt_object** bolt_mark_stack = NULL;
+static size_t bolt_mark_count = 0;
+static size_t bolt_mark_capacity = 0;
+
+static void* bolt_checked(void* ptr) {
+  if (ptr == NULL) {
+    bolt_panic("out of memory");
+  }
+  return ptr;
+}
+
+static inline void bolt_add_root(void* start, size_t size) {
+  bolt_roots = bolt_checked(realloc(bolt_roots, (bolt_root_count + 1) * sizeof(bolt_root)));
+  bolt_roots[bolt_root_count].start = start;
+  bolt_roots[bolt_root_count].size = size;
+  bolt_root_count++;
+}
+
+static char* bolt_payload(bolt_object* object) {
+  return (char*)(object + 1);
+}
+
+static int bolt_compare_objects(const void* a, const void* b) {
+  uintptr_t left = (uintptr_t)*(bolt_object* const*)a;
+  uintptr_t right = (uintptr_t)*(bolt_object* const*)b;
+  return left < right ? -1 : left > right;
+}
+
+/* Sort all objects by their address so that the object a scanned word points
+   into can be found with a binary search. */
+static void bolt_sort_objects(void) {
+  if (bolt_sorted_capacity < bolt_object_count) {
+    free(bolt_sorted);
+    bolt_sorted = bolt_checked(malloc(bolt_object_count * sizeof(bolt_object*)));
+    bolt_sorted_capacity = bolt_object_count;
+  }
+  size_t count = 0;
+  for (bolt_object* object = bolt_objects; object != NULL; object = object->next) {
+    bolt_sorted[count++] = object;
+  }
+  qsort(bolt_sorted, count, sizeof(bolt_object*), bolt_compare_objects);
+}
+
+/* Find the object of which the payload contains the given address. */
+static bolt_object* bolt_find_object(char* ptr) {
+  uintptr_t address = (uintptr_t)ptr;
+  size_t low = 0;
+  size_t high = bolt_object_count;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if ((uintptr_t)bolt_payload(bolt_sorted[middle]) <= address) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == 0) {
+    return NULL;
+  }
+  bolt_object* object = bolt_sorted[low - 1];
+  uintptr_t start = (uintptr_t)bolt_payload(object);
+  /* Empty objects can still be referred to by their start */
+  size_t size = object->size > 0 ? object->size : 1;
+  return address - start < size ? object : NULL;
+}
+
+static void bolt_scan(char* start, size_t size) {
+  for (size_t i = 0; i + sizeof(void*) <= size; i += sizeof(void*)) {
+    char* word;
+    memcpy(&word, start + i, sizeof(word));
+    bolt_object* object = bolt_find_object(word);
+    if (object == NULL || object->marked) {
+      continue;
+    }
+    object->marked = true;
+    if (bolt_mark_count == bolt_mark_capacity) {
+      bolt_mark_capacity = bolt_mark_capacity == 0 ? 64 : bolt_mark_capacity * 2;
+      bolt_mark_stack = bolt_checked(realloc(bolt_mark_stack, bolt_mark_capacity * sizeof(bolt_object*)));
+    }
+    bolt_mark_stack[bolt_mark_count++] = object;
+  }
+}
+
+static void bolt_scan_stack(void) {
+  char here;
+  char* low = &here < bolt_stack_bottom ? &here : bolt_stack_bottom;
+  char* high = &here < bolt_stack_bottom ? bolt_stack_bottom : &here;
+  low = (char*)((uintptr_t)low & ~(uintptr_t)(sizeof(void*) - 1));
+  bolt_scan(low, high - low);
+}
+
+static void bolt_collect(void) {
+  /* Some C libraries mangle registers that are saved in a jmp_buf, so the
+     compiler is asked to spill them onto the stack as well. The stack is
+     scanned from a frame that cannot be inlined, so that frame lies below
+     everything that was spilled. */
+#if defined(__GNUC__)
+  __builtin_unwind_init();
+#endif
+  jmp_buf registers;
+  setjmp(registers);
+  bolt_sort_objects();
+  void (*volatile scan_stack)(void) = bolt_scan_stack;
+  scan_stack();
+  bolt_scan((char*)&registers, sizeof(registers));
+  for (size_t i = 0; i < bolt_root_count; i++) {
+    bolt_scan(bolt_roots[i].start, bolt_roots[i].size);
+  }
+  while (bolt_mark_count > 0) {
+    bolt_object* object = bolt_mark_stack[--bolt_mark_count];
+    bolt_scan(bolt_payload(object), object->size);
+  }
+  bolt_object** link = &bolt_objects;
+  while (*link != NULL) {
+    bolt_object* object = *link;
+    if (object->marked) {
+      object->marked = false;
+      link = &object->next;
+    } else {
+      *link = object->next;
+      bolt_object_count--;
+      bolt_allocated -= object->size;
+      free(object);
+    }
+  }
+}
+
+static void* bolt_alloc(size_t size) {
+  if (bolt_allocated + size > bolt_threshold) {
+    bolt_collect();
+    if (bolt_allocated + size > bolt_threshold / 2) {
+      bolt_threshold *= 2;
+    }
+  }
+  bolt_object* object = bolt_checked(malloc(sizeof(bolt_object) + size));
+  object->next = bolt_objects;
+  object->size = size;
+  object->marked = false;
+  bolt_objects = object;
+  bolt_object_count++;
+  bolt_allocated += size;
+  memset(bolt_payload(object), 0, size);
+  return bolt_payload(object);
+}
+
+static inline void* bolt_box(const void* value, size_t size) {
+  void* ptr = bolt_alloc(size);
+  memcpy(ptr, value, size);
+  return ptr;
+}
+
+static inline bolt_variant* bolt_make_variant(uint64_t tag, size_t arity) {
+  bolt_variant* variant = bolt_alloc(sizeof(bolt_variant) + arity * sizeof(bolt_word));
+  variant->tag = tag;
+  return variant;
+}
+
+/* Integers wrap around on overflow. Division truncates towards zero. */
+
+static inline int64_t bolt_add(int64_t left, int64_t right) {
+  return (int64_t)((uint64_t)left + (uint64_t)right);
+}
+
+static inline int64_t bolt_sub(int64_t left, int64_t right) {
+  return (int64_t)((uint64_t)left - (uint64_t)right);
+}
+
+static inline int64_t bolt_mul(int64_t left, int64_t right) {
+  return (int64_t)((uint64_t)left * (uint64_t)right);
+}
+
+static inline int64_t bolt_div(int64_t left, int64_t right) {
+  if (right == 0) {
+    bolt_panic("division by zero");
+  }
+  if (right == -1) {
+    return (int64_t)(0 - (uint64_t)left);
+  }
+  return left / right;
+}
+
+static inline bolt_unit bolt_print(const char* text) {
+  puts(text);
+  return 0;
+}
+
+)c";
+
+  /**
+   * Turn a Bolt name into a C identifier.
+   *
+   * An underscore becomes two underscores, so that it cannot be confused
+   * with the start of an escaped character and no two names are mapped to
+   * the same identifier.
+   */
+  static ByteString mangle(const ByteString& Name) {
+    ByteString Out = "b_";
+    for (auto Ch: Name) {
+      if ((Ch >= 'a' && Ch <= 'z') || (Ch >= 'A' && Ch <= 'Z') || (Ch >= '0' && Ch <= '9')) {
+        Out.push_back(Ch);
+      } else if (Ch == '_') {
+        Out.append("__");
+      } else {
+        char Buffer[8];
+        std::snprintf(Buffer, sizeof(Buffer), "_x%02x", static_cast<unsigned char>(Ch));
+        Out.append(Buffer);
+      }
+    }
+    return Out;
+  }
+
+  static ByteString escapeString(const ByteString& Text) {
+    ByteString Out = "\"";
+    for (auto Ch: Text) {
+      switch (Ch) {
+        case '"':
+          Out.append("\\\"");
+          break;
+        case '\\':
+          Out.append("\\\\");
+          break;
+        case '\n':
+          Out.append("\\n");
+          break;
+        case '\t':
+          Out.append("\\t");
+          break;
+        default:
+          if (Ch >= 32 && Ch < 127) {
+            Out.push_back(Ch);
+          } else {
+            char Buffer[8];
+            std::snprintf(Buffer, sizeof(Buffer), "\\%03o", static_cast<unsigned char>(Ch));
+            Out.append(Buffer);
+          }
+      }
+    }
+    Out.push_back('"');
+    return Out;
+  }
+
+  static ByteString writeInteger(Integer I) {
+    return "INT64_C(" + std::to_string(I) + ")";
+  }
+
+  /**
+   * Follow type variables that were unified with another type.
+   */
+  static Type* prune(Type* Ty) {
+    while (Ty->getKind() == TypeKind::Var) {
+      auto Solved = Ty->solve();
+      if (Solved == Ty) {
+        break;
+      }
+      Ty = Solved;
+    }
+    return Ty;
+  }
+
+  static bool hasTypeVars(Type* Ty) {
+    Ty = prune(Ty);
+    switch (Ty->getKind()) {
+      case TypeKind::Var:
+        return true;
+      case TypeKind::Arrow:
+      {
+        auto Arrow = static_cast<TArrow*>(Ty);
+        return hasTypeVars(Arrow->ParamType) || hasTypeVars(Arrow->ReturnType);
+      }
+      case TypeKind::App:
+      {
+        auto App = static_cast<TApp*>(Ty);
+        return hasTypeVars(App->Op) || hasTypeVars(App->Arg);
+      }
+      case TypeKind::Tuple:
+        for (auto ElementType: static_cast<TTuple*>(Ty)->ElementTypes) {
+          if (hasTypeVars(ElementType)) {
+            return true;
+          }
+        }
+        return false;
+      default:
+        return false;
+    }
+  }
+
+  CEmitter::CEmitter(Checker& C, DiagnosticEngine& DE):
+    C(C), DE(DE) {}
+
+  ByteString CEmitter::createTemp() {
+    return "t" + std::to_string(NextTempId++);
+  }
+
+  void CEmitter::writeLine(const ByteString& Line) {
+    Body->append(Indent * 2, ' ');
+    Body->append(Line);
+    Body->push_back('\n');
+  }
+
+  void CEmitter::unsupported(ByteString Feature, Node* Source) {
+    DE.add<NotSupportedDiagnostic>(Feature, Source);
+  }
+
+  bool CEmitter::isBuiltinType(Type* Ty, Type* Builtin) {
+    return *prune(Ty) == *Builtin;
+  }
+
+  ByteString CEmitter::getTupleStruct(TTuple* Ty, Node* Source) {
+    std::vector<ByteString> ElementTypes;
+    ByteString Key;
+    for (auto ElementType: Ty->ElementTypes) {
+      auto CType = getCType(ElementType, Source);
+      Key.append(CType);
+      Key.push_back(',');
+      ElementTypes.push_back(CType);
+    }
+    auto Match = TupleStructs.find(Key);
+    if (Match != TupleStructs.end()) {
+      return Match->second;
+    }
+    auto Name = "bolt_tuple_" + std::to_string(TupleStructs.size());
+    TypeDecls.append("typedef struct {\n");
+    for (std::size_t I = 0; I < ElementTypes.size(); I++) {
+      TypeDecls.append("  " + ElementTypes[I] + " f" + std::to_string(I) + ";\n");
+    }
+    TypeDecls.append("} " + Name + ";\n\n");
+    TupleStructs.emplace(Key, Name);
+    return Name;
+  }
+
+  ByteString CEmitter::getCType(Type* Ty, Node* Source) {
+    Ty = prune(Ty);
+    switch (Ty->getKind()) {
+      case TypeKind::Con:
+        if (*Ty == *C.getIntType()) {
+          return "int64_t";
+        }
+        if (*Ty == *C.getBoolType()) {
+          return "bool";
+        }
+        if (*Ty == *C.getStringType()) {
+          return "const char*";
+        }
+        if (*Ty == *C.getListType()) {
+          unsupported("lists", Source);
+          return "bolt_word";
+        }
+        return "bolt_variant*";
+      case TypeKind::App:
+      {
+        auto Op = prune(static_cast<TApp*>(Ty)->Op);
+        while (Op->getKind() == TypeKind::App) {
+          Op = prune(static_cast<TApp*>(Op)->Op);
+        }
+        if (*Op == *C.getListType()) {
+          unsupported("lists", Source);
+          return "bolt_word";
+        }
+        return "bolt_variant*";
+      }
+      case TypeKind::Tuple:
+      {
+        auto Tuple = static_cast<TTuple*>(Ty);
+        if (Tuple->ElementTypes.empty()) {
+          return "bolt_unit";
+        }
+        return getTupleStruct(Tuple, Source);
+      }
+      case TypeKind::Var:
+        unsupported("polymorphic values", Source);
+        return "bolt_word";
+      case TypeKind::Arrow:
+        unsupported("functions used as values", Source);
+        return "bolt_word";
+      default:
+        unsupported("values of this type", Source);
+        return "bolt_word";
+    }
+  }
+
+  ByteString CEmitter::toWord(const ByteString& Expr, Type* Ty, Node* Source) {
+    auto CType = getCType(Ty, Source);
+    Ty = prune(Ty);
+    if (isBuiltinType(Ty, C.getIntType())) {
+      return "(bolt_word) { .i = " + Expr + " }";
+    }
+    if (isBuiltinType(Ty, C.getBoolType())) {
+      return "(bolt_word) { .b = " + Expr + " }";
+    }
+    if (isBuiltinType(Ty, C.getStringType())) {
+      return "(bolt_word) { .s = " + Expr + " }";
+    }
+    if (CType == "bolt_unit") {
+      return "(bolt_word) { .i = 0 }";
+    }
+    if (Ty->getKind() == TypeKind::Tuple) {
+      // Tuples are stored unboxed everywhere except inside enum members
+      auto Temp = createTemp();
+      writeLine(CType + " " + Temp + " = " + Expr + ";");
+      return "(bolt_word) { .p = bolt_box(&" + Temp + ", sizeof(" + CType + ")) }";
+    }
+    return "(bolt_word) { .p = " + Expr + " }";
+  }
+
+  ByteString CEmitter::fromWord(const ByteString& Word, Type* Ty, Node* Source) {
+    auto CType = getCType(Ty, Source);
+    Ty = prune(Ty);
+    if (isBuiltinType(Ty, C.getIntType())) {
+      return "(" + Word + ").i";
+    }
+    if (isBuiltinType(Ty, C.getBoolType())) {
+      return "(" + Word + ").b";
+    }
+    if (isBuiltinType(Ty, C.getStringType())) {
+      return "(" + Word + ").s";
+    }
+    if (CType == "bolt_unit") {
+      return "((bolt_unit) 0)";
+    }
+    if (Ty->getKind() == TypeKind::Tuple) {
+      return "(*(" + CType + "*) (" + Word + ").p)";
+    }
+    return "((" + CType + ") (" + Word + ").p)";
+  }
+
+  Type* CEmitter::getFieldType(Type* Ty, std::size_t Tag, std::size_t Index, Node* Source) {
+    std::vector<Type*> Args;
+    Ty = prune(Ty);
+    while (Ty->getKind() == TypeKind::App) {
+      auto App = static_cast<TApp*>(Ty);
+      Args.insert(Args.begin(), App->Arg);
+      Ty = prune(App->Op);
+    }
+    ZEN_ASSERT(Ty->getKind() == TypeKind::Con);
+    auto Decl = Source->getScope()->lookup({ {}, static_cast<TCon*>(Ty)->DisplayName }, SymbolKind::Type);
+    ZEN_ASSERT(Decl != nullptr && Decl->getKind() == NodeKind::VariantDeclaration);
+    auto Variant = static_cast<VariantDeclaration*>(Decl);
+    auto Member = Variant->Members[Tag];
+    ZEN_ASSERT(Member->getKind() == NodeKind::TupleVariantDeclarationMember);
+    auto FieldType = static_cast<TupleVariantDeclarationMember*>(Member)->Elements[Index]->getType();
+    // The field type refers to the type variables of the enum declaration,
+    // which we replace with the type arguments of the matched value.
+    return FieldType->rewrite([&](Type* Ty2) -> Type* {
+      if (Ty2->getKind() == TypeKind::Var && static_cast<TVar*>(Ty2)->isRigid()) {
+        auto Name = static_cast<TVarRigid*>(Ty2)->Name;
+        for (std::size_t I = 0; I < Variant->TVs.size() && I < Args.size(); I++) {
+          if (Variant->TVs[I]->Name->getCanonicalText() == Name) {
+            return Args[I];
+          }
+        }
+      }
+      return Ty2;
+    });
+  }
+
+  std::tuple<ByteString, Type*> CEmitter::resolvePath(MatchState& State, const MatchPath& Path) {
+    auto Expr = State.Value;
+    auto Ty = State.ValueType;
+    MatchPath Prefix;
+    for (auto Index: Path) {
+      Ty = prune(Ty);
+      if (Ty->getKind() == TypeKind::Tuple) {
+        Expr = "(" + Expr + ").f" + std::to_string(Index);
+        Ty = static_cast<TTuple*>(Ty)->ElementTypes[Index];
+      } else {
+        auto Match = State.KnownTags.find(Prefix);
+        ZEN_ASSERT(Match != State.KnownTags.end());
+        auto FieldType = getFieldType(Ty, Match->second, Index, State.Match);
+        Expr = fromWord("(" + Expr + ")->fields[" + std::to_string(Index) + "]", FieldType, State.Match);
+        Ty = FieldType;
+      }
+      Prefix.push_back(Index);
+    }
+    return { Expr, Ty };
+  }
+
+  void CEmitter::emitDecision(MatchState& State, Decision* D) {
+    switch (D->getKind()) {
+      case DecisionKind::Fail:
+        writeLine("bolt_match_failure();");
+        break;
+      case DecisionKind::Leaf:
+      {
+        auto Leaf = static_cast<DecisionLeaf*>(D);
+        writeLine("{");
+        Indent++;
+        for (auto& [Pattern, Path]: Leaf->Bindings) {
+          auto Name = Pattern->Name->getCanonicalText();
+          if (Name == "_") {
+            continue;
+          }
+          auto [Expr, Ty] = resolvePath(State, Path);
+          writeLine(getCType(Ty, Pattern) + " " + mangle(Name) + " = " + Expr + ";");
+        }
+        auto Result = emitExpression(Leaf->Case->Expression);
+        writeLine(State.Result + " = " + Result + ";");
+        writeLine("goto " + State.EndLabel + ";");
+        Indent--;
+        writeLine("}");
+        break;
+      }
+      case DecisionKind::Switch:
+      {
+        auto Switch = static_cast<DecisionSwitch*>(D);
+        auto [Expr, Ty] = resolvePath(State, Switch->Path);
+        switch (Switch->Test) {
+          case SwitchKind::Constructor:
+          {
+            auto Tag = isBuiltinType(Ty, C.getBoolType()) ? "(uint64_t) (" + Expr + ")" : "(" + Expr + ")->tag";
+            writeLine("switch (" + Tag + ") {");
+            for (std::size_t I = 0; I < Switch->Table.size(); I++) {
+              if (Switch->Table[I] == Switch->Default) {
+                continue;
+              }
+              writeLine("case " + std::to_string(I) + ": {");
+              Indent++;
+              State.KnownTags[Switch->Path] = I;
+              emitDecision(State, Switch->Table[I]);
+              State.KnownTags.erase(Switch->Path);
+              Indent--;
+              writeLine("}");
+            }
+            writeLine("default: {");
+            Indent++;
+            emitDecision(State, Switch->Default);
+            Indent--;
+            writeLine("}");
+            writeLine("}");
+            break;
+          }
+          case SwitchKind::Literal:
+          {
+            // Sorted so that the generated code does not depend on hashing
+            std::vector<std::tuple<LiteralValue, Decision*>> Cases(Switch->Cases.begin(), Switch->Cases.end());
+            std::sort(Cases.begin(), Cases.end());
+            if (isBuiltinType(Ty, C.getStringType())) {
+              auto Keyword = "if";
+              for (auto& [Value, Target]: Cases) {
+                writeLine(ByteString(Keyword) + " (strcmp(" + Expr + ", " + escapeString(std::get<ByteString>(Value)) + ") == 0) {");
+                Indent++;
+                emitDecision(State, Target);
+                Indent--;
+                Keyword = "} else if";
+              }
+              writeLine("} else {");
+              Indent++;
+              emitDecision(State, Switch->Default);
+              Indent--;
+              writeLine("}");
+            } else {
+              writeLine("switch (" + Expr + ") {");
+              for (auto& [Value, Target]: Cases) {
+                writeLine("case " + writeInteger(std::get<Integer>(Value)) + ": {");
+                Indent++;
+                emitDecision(State, Target);
+                Indent--;
+                writeLine("}");
+              }
+              writeLine("default: {");
+              Indent++;
+              emitDecision(State, Switch->Default);
+              Indent--;
+              writeLine("}");
+              writeLine("}");
+            }
+            break;
+          }
+          case SwitchKind::Length:
+            unsupported("list patterns", State.Match);
+            break;
+        }
+        break;
+      }
+    }
+  }
+
+  ByteString CEmitter::emitMatch(MatchExpression* M) {
+    if (M->Value == nullptr) {
+      unsupported("match-expressions without a value", M);
+      return "0";
+    }
+    auto ValueType = C.getType(M->Value);
+    auto ValueExpr = emitExpression(M->Value);
+    auto Value = createTemp();
+    writeLine(getCType(ValueType, M->Value) + " " + Value + " = " + ValueExpr + ";");
+    auto Result = createTemp();
+    writeLine(getCType(C.getType(M), M) + " " + Result + ";");
+    MatchState State { M, Value, ValueType, Result, "end_" + createTemp(), {} };
+    auto Tree = Compiler.compile(M);
+    if (Tree == nullptr) {
+      unsupported("constructors of other modules", Compiler.getUnknownConstructor());
+      return Result;
+    }
+    emitDecision(State, Tree);
+    writeLine(State.EndLabel + ":;");
+    return Result;
+  }
+
+  ByteString CEmitter::emitCall(CallExpression* Call) {
+    if (Call->Function->getKind() != NodeKind::ReferenceExpression) {
+      unsupported("calls to computed functions", Call);
+      return "0";
+    }
+    auto Ref = static_cast<ReferenceExpression*>(Call->Function);
+    auto Name = Ref->Name->getCanonicalText();
+
+    std::vector<ByteString> Args;
+    for (auto Arg: Call->Args) {
+      Args.push_back(emitExpression(Arg));
+    }
+
+    if (Ref->Name->getKind() == NodeKind::IdentifierAlt) {
+      auto Info = MatchCompiler::getConstructorInfo(Ref, Name);
+      if (!Info) {
+        unsupported("constructors of other modules", Call);
+        return "0";
+      }
+      if (Info->Arity != Args.size()) {
+        unsupported("partially applied constructors", Call);
+        return "0";
+      }
+      std::vector<ByteString> Words;
+      for (std::size_t I = 0; I < Args.size(); I++) {
+        Words.push_back(toWord(Args[I], C.getType(Call->Args[I]), Call->Args[I]));
+      }
+      auto Temp = createTemp();
+      writeLine("bolt_variant* " + Temp + " = bolt_make_variant(" + std::to_string(Info->Tag) + ", " + std::to_string(Info->Arity) + ");");
+      for (std::size_t I = 0; I < Words.size(); I++) {
+        writeLine(Temp + "->fields[" + std::to_string(I) + "] = " + Words[I] + ";");
+      }
+      return Temp;
+    }
+
+    auto Target = Ref->getDeclaration();
+    auto Temp = createTemp();
+    auto Type = getCType(C.getType(Call), Call);
+
+    if (Target == nullptr && Name == "print") {
+      writeLine(Type + " " + Temp + " = bolt_print(" + Args[0] + ");");
+      return Temp;
+    }
+
+    if (Target == nullptr || Target->getKind() != NodeKind::LetDeclaration || Target->Parent->getKind() != NodeKind::SourceFile) {
+      unsupported("calls to local functions", Call);
+      return "0";
+    }
+
+    auto Let = static_cast<LetDeclaration*>(Target);
+    if (Let->Params.size() != Args.size()) {
+      unsupported("partially applied functions", Call);
+      return "0";
+    }
+
+    ByteString Line = Type + " " + Temp + " = " + mangle(Name) + "(";
+    for (std::size_t I = 0; I < Args.size(); I++) {
+      if (I > 0) {
+        Line.append(", ");
+      }
+      Line.append(Args[I]);
+    }
+    Line.append(");");
+    writeLine(Line);
+    return Temp;
+  }
+
+  ByteString CEmitter::emitExpression(Expression* X) {
+    switch (X->getKind()) {
+      case NodeKind::LiteralExpression:
+      {
+        auto Lit = static_cast<LiteralExpression*>(X);
+        switch (Lit->Token->getKind()) {
+          case NodeKind::IntegerLiteral:
+            return writeInteger(static_cast<IntegerLiteral*>(Lit->Token)->V);
+          case NodeKind::StringLiteral:
+            return escapeString(static_cast<StringLiteral*>(Lit->Token)->Text);
+          default:
+            ZEN_UNREACHABLE
+        }
+      }
+      case NodeKind::ReferenceExpression:
+      {
+        auto Ref = static_cast<ReferenceExpression*>(X);
+        auto Name = Ref->Name->getCanonicalText();
+        if (Ref->Name->getKind() == NodeKind::IdentifierAlt) {
+          if (Name == "True" || Name == "False") {
+            return Name == "True" ? "true" : "false";
+          }
+          auto Info = MatchCompiler::getConstructorInfo(Ref, Name);
+          if (!Info) {
+            unsupported("constructors of other modules", X);
+            return "0";
+          }
+          if (Info->Arity != 0) {
+            unsupported("constructors used as values", X);
+            return "0";
+          }
+          auto Temp = createTemp();
+          writeLine("bolt_variant* " + Temp + " = bolt_make_variant(" + std::to_string(Info->Tag) + ", 0);");
+          return Temp;
+        }
+        auto Target = Ref->getDeclaration();
+        if ((Target == nullptr && Name == "print")
+            || (Target != nullptr && Target->getKind() == NodeKind::LetDeclaration && !static_cast<LetDeclaration*>(Target)->Params.empty())) {
+          unsupported("functions used as values", X);
+          return "0";
+        }
+        return mangle(Name);
+      }
+      case NodeKind::CallExpression:
+        return emitCall(static_cast<CallExpression*>(X));
+      case NodeKind::InfixExpression:
+      {
+        auto Infix = static_cast<InfixExpression*>(X);
+        auto Op = Infix->Operator->getText();
+        auto Left = emitExpression(Infix->Left);
+        auto Right = emitExpression(Infix->Right);
+        auto LeftType = C.getType(Infix->Left);
+        if (Op == "==") {
+          if (isBuiltinType(LeftType, C.getStringType())) {
+            return "(strcmp(" + Left + ", " + Right + ") == 0)";
+          }
+          if (isBuiltinType(LeftType, C.getIntType()) || isBuiltinType(LeftType, C.getBoolType())) {
+            return "(" + Left + " == " + Right + ")";
+          }
+          unsupported("comparing values of this type", X);
+          return "0";
+        }
+        const char* Fn;
+        if (Op == "+") {
+          Fn = "bolt_add";
+        } else if (Op == "-") {
+          Fn = "bolt_sub";
+        } else if (Op == "*") {
+          Fn = "bolt_mul";
+        } else if (Op == "/") {
+          Fn = "bolt_div";
+        } else {
+          unsupported("the operator " + Op, X);
+          return "0";
+        }
+        return ByteString(Fn) + "(" + Left + ", " + Right + ")";
+      }
+      case NodeKind::NestedExpression:
+        return "(" + emitExpression(static_cast<NestedExpression*>(X)->Inner) + ")";
+      case NodeKind::TupleExpression:
+      {
+        auto Tuple = static_cast<TupleExpression*>(X);
+        auto Type = getCType(C.getType(Tuple), X);
+        if (Tuple->Elements.empty()) {
+          return "((bolt_unit) 0)";
+        }
+        ByteString Out = "((" + Type + ") { ";
+        bool First = true;
+        for (auto [Element, Comma]: Tuple->Elements) {
+          if (!First) {
+            Out.append(", ");
+          }
+          First = false;
+          Out.append(emitExpression(Element));
+        }
+        Out.append(" })");
+        return Out;
+      }
+      case NodeKind::MatchExpression:
+        return emitMatch(static_cast<MatchExpression*>(X));
+      default:
+        unsupported("this kind of expression", X);
+        return "0";
+    }
+  }
+
+  bool CEmitter::checkVariable(LetDeclaration* Let) {
+    if (Let->Body == nullptr) {
+      // Only asserts the type of a pattern
+      return false;
+    }
+    if (Let->Pattern->getKind() != NodeKind::BindPattern) {
+      unsupported("destructuring let-declarations", Let);
+      return false;
+    }
+    if (Let->Body->getKind() != NodeKind::LetExprBody) {
+      unsupported("variables with a block body", Let);
+      return false;
+    }
+    return true;
+  }
+
+  void CEmitter::emitStatement(Node* N) {
+    switch (N->getKind()) {
+      case NodeKind::ExpressionStatement:
+      {
+        auto Expr = emitExpression(static_cast<ExpressionStatement*>(N)->Expression);
+        writeLine("(void) " + Expr + ";");
+        break;
+      }
+      case NodeKind::ReturnStatement:
+      {
+        auto Return = static_cast<ReturnStatement*>(N);
+        if (Return->Expression) {
+          auto Expr = emitExpression(Return->Expression);
+          writeLine("return " + Expr + ";");
+        } else {
+          writeLine("return 0;");
+        }
+        break;
+      }
+      case NodeKind::IfStatement:
+      {
+        // Each test is emitted inside the else-branch of the previous one so
+        // that any temporaries it needs are only computed when reached.
+        auto If = static_cast<IfStatement*>(N);
+        unsigned Depth = 0;
+        for (auto Part: If->Parts) {
+          if (Part->Test == nullptr) {
+            for (auto Element: Part->Elements) {
+              emitStatement(Element);
+            }
+            break;
+          }
+          auto Test = emitExpression(Part->Test);
+          writeLine("if (" + Test + ") {");
+          Indent++;
+          for (auto Element: Part->Elements) {
+            emitStatement(Element);
+          }
+          Indent--;
+          writeLine("} else {");
+          Indent++;
+          Depth++;
+        }
+        for (unsigned I = 0; I < Depth; I++) {
+          Indent--;
+          writeLine("}");
+        }
+        break;
+      }
+      case NodeKind::LetDeclaration:
+      {
+        auto Let = static_cast<LetDeclaration*>(N);
+        if (!Let->Params.empty()) {
+          unsupported("local functions", Let);
+          break;
+        }
+        if (!checkVariable(Let)) {
+          break;
+        }
+        auto Expr = emitExpression(static_cast<LetExprBody*>(Let->Body)->Expression);
+        writeLine(getCType(C.getType(Let), Let) + " " + mangle(Let->getNameAsString()) + " = " + Expr + ";");
+        break;
+      }
+      default:
+        unsupported("this kind of statement", N);
+    }
+  }
+
+  void CEmitter::emitFunction(LetDeclaration* Let) {
+
+    if (Let->Body == nullptr) {
+      return;
+    }
+
+    std::vector<Type*> ParamTypes;
+    auto Ty = C.getType(Let);
+    if (hasTypeVars(Ty)) {
+      unsupported("polymorphic functions", Let);
+      return;
+    }
+    for (std::size_t I = 0; I < Let->Params.size(); I++) {
+      Ty = prune(Ty);
+      ZEN_ASSERT(Ty->getKind() == TypeKind::Arrow);
+      auto Arrow = static_cast<TArrow*>(Ty);
+      ParamTypes.push_back(Arrow->ParamType);
+      Ty = Arrow->ReturnType;
+    }
+    auto ReturnType = getCType(Ty, Let);
+
+    ByteString Signature = "static " + ReturnType + " " + mangle(Let->getNameAsString()) + "(";
+    for (std::size_t I = 0; I < Let->Params.size(); I++) {
+      auto Param = Let->Params[I];
+      if (Param->Pattern->getKind() != NodeKind::BindPattern) {
+        unsupported("destructuring parameters", Param);
+        return;
+      }
+      if (I > 0) {
+        Signature.append(", ");
+      }
+      Signature.append(getCType(ParamTypes[I], Param) + " " + mangle(static_cast<BindPattern*>(Param->Pattern)->Name->getCanonicalText()));
+    }
+    if (Let->Params.empty()) {
+      Signature.append("void");
+    }
+    Signature.append(")");
+
+    ByteString FunctionBody;
+    Body = &FunctionBody;
+    Indent = 1;
+    switch (Let->Body->getKind()) {
+      case NodeKind::LetExprBody:
+      {
+        auto Expr = emitExpression(static_cast<LetExprBody*>(Let->Body)->Expression);
+        writeLine("return " + Expr + ";");
+        break;
+      }
+      case NodeKind::LetBlockBody:
+      {
+        for (auto Element: static_cast<LetBlockBody*>(Let->Body)->Elements) {
+          emitStatement(Element);
+        }
+        if (ReturnType == "bolt_unit") {
+          writeLine("return 0;");
+        }
+        break;
+      }
+      default:
+        ZEN_UNREACHABLE
+    }
+
+    Prototypes.append(Signature + ";\n");
+    Functions.append(Signature + " {\n" + FunctionBody + "}\n\n");
+  }
+
+  void CEmitter::emit(SourceFile* SF) {
+    for (auto Element: SF->Elements) {
+      switch (Element->getKind()) {
+        case NodeKind::LetDeclaration:
+        {
+          auto Let = static_cast<LetDeclaration*>(Element);
+          if (!Let->Params.empty()) {
+            emitFunction(Let);
+            break;
+          }
+          if (!checkVariable(Let)) {
+            break;
+          }
+          // Global variables are initialized at the start of main() in the
+          // order in which they were declared.
+          auto Name = mangle(Let->getNameAsString());
+          Globals.append("static " + getCType(C.getType(Let), Let) + " " + Name + ";\n");
+          Body = &MainBody;
+          Indent = 1;
+          writeLine("bolt_add_root(&" + Name + ", sizeof(" + Name + "));");
+          auto Expr = emitExpression(static_cast<LetExprBody*>(Let->Body)->Expression);
+          writeLine(Name + " = " + Expr + ";");
+          break;
+        }
+        case NodeKind::VariantDeclaration:
+        case NodeKind::RecordDeclaration:
+          // Enum members all share the same representation
+          break;
+        case NodeKind::ExpressionStatement:
+        case NodeKind::IfStatement:
+          Body = &MainBody;
+          Indent = 1;
+          emitStatement(Element);
+          break;
+        default:
+          unsupported("this kind of declaration", Element);
+      }
+    }
+  }
+
+  void CEmitter::write(std::ostream& Out) {
+    Out << Runtime;
+    Out << TypeDecls;
+    Out << Prototypes << "\n";
+    Out << Globals << "\n";
+    Out << Functions;
+    Out << "static void bolt_main(void) {\n" << MainBody << "}\n\n";
+    // bolt_main() is called through a volatile pointer so that it cannot be
+    // inlined, which guarantees that every stack frame the collector has to
+    // scan lies beyond bolt_stack_bottom.
+    Out << "int main(void) {\n"
+        << "  char bottom;\n"
+        << "  bolt_stack_bottom = &bottom;\n"
+        << "  void (*volatile entry)(void) = bolt_main;\n"
+        << "  entry();\n"
+        << "  return 0;\n"
+        << "}\n";
+  }
+
+  /// Makes sure that a path is never mistaken for an option of the compiler.
+  static std::string escapeOption(const std::string& Path) {
+    return !Path.empty() && Path[0] == '-' ? "./" + Path : Path;
+  }
+
+  int compileC(const std::string& CPath, const std::string& Output) {
+    // CC may contain flags, e.g. CC="gcc -m32"
+    auto CC = std::getenv("CC");
+    std::istringstream Words { CC != nullptr ? CC : "cc" };
+    std::vector<std::string> Args;
+    std::string Word;
+    while (Words >> Word) {
+      Args.push_back(Word);
+    }
+    if (Args.empty()) {
+      Args.push_back("cc");
+    }
+    Args.push_back("-O2");
+    Args.push_back("-o");
+    Args.push_back(escapeOption(Output));
+    Args.push_back(escapeOption(CPath));
+    std::vector<char*> Argv;
+    for (auto& Arg: Args) {
+      Argv.push_back(Arg.data());
+    }
+    Argv.push_back(nullptr);
+    pid_t Pid;
+    if (posix_spawnp(&Pid, Argv[0], nullptr, nullptr, Argv.data(), environ) != 0) {
+      return -1;
+    }
+    int Status;
+    while (waitpid(Pid, &Status, 0) == -1) {
+      if (errno != EINTR) {
+        return -1;
+      }
+    }
+    return WIFEXITED(Status) ? WEXITSTATUS(Status) : -1;
+  }
+
+}
@@ -1,4 +1,11 @@
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
 #include "zen/config.hpp"
 
 #include "bolt/CST.hpp"
@@ -6,8 +13,10 @@
 
 namespace bolt {
 
+  static std::atomic<std::size_t> NextTextFileId = 1;
+
   TextFile::TextFile(ByteString Path, ByteString Text):
-    Path(Path), Text(Text) {
+    Id(NextTextFileId++), Path(Path), Text(Text) {
       LineOffsets.push_back(0);
       for (size_t I = 0; I < Text.size(); I++) {
         auto Chr = Text[I];
@@ -35,14 +44,15 @@ namespace bolt {
     return LineOffsets[Line];
   }
 
+  size_t TextFile::getOffset(TextLoc Loc) const {
+    return getStartOffsetOfLine(Loc.Line) + Loc.Column - 1;
+  }
+
   size_t TextFile::getLine(size_t Offset) const {
     ZEN_ASSERT(Offset < Text.size());
-    for (size_t I = 0; I < LineOffsets.size(); ++I) {
-      if (LineOffsets[I] > Offset) {
-        return I;
-      }
-    }
-    ZEN_UNREACHABLE
+    auto Match = std::upper_bound(LineOffsets.begin(), LineOffsets.end(), Offset);
+    ZEN_ASSERT(Match != LineOffsets.end());
+    return Match - LineOffsets.begin();
   }
 
   size_t TextFile::getColumn(size_t Offset) const {
@@ -55,17 +65,57 @@ namespace bolt {
     return Path;
   }
 
-  ByteString TextFile::getText() const {
+  ByteStringView TextFile::getText() const {
     return Text;
   }
 
+  void TextFile::replace(size_t StartOffset, size_t EndOffset, ByteStringView NewText) {
+    ZEN_ASSERT(StartOffset <= EndOffset && EndOffset <= Text.size());
+    Text.replace(StartOffset, EndOffset - StartOffset, NewText);
+    // Every offset except the first one starts a line after a '\n'. Those of
+    // the line terminators that were removed are dropped, the ones after the
+    // edit are shifted and the ones inside the new text are inserted.
+    LineOffsets.pop_back();
+    auto First = std::upper_bound(LineOffsets.begin(), LineOffsets.end(), StartOffset);
+    auto Last = std::upper_bound(First, LineOffsets.end(), EndOffset);
+    for (auto Iter = Last; Iter != LineOffsets.end(); ++Iter) {
+      *Iter = *Iter - EndOffset + StartOffset + NewText.size();
+    }
+    std::vector<size_t> Inserted;
+    for (size_t I = 0; I < NewText.size(); I++) {
+      if (NewText[I] == '\n') {
+        Inserted.push_back(StartOffset + I + 1);
+      }
+    }
+    auto Pos = LineOffsets.erase(First, Last);
+    LineOffsets.insert(Pos, Inserted.begin(), Inserted.end());
+    LineOffsets.push_back(Text.size());
+  }
+
+  /**
+   * Scopes with more symbols than this get a hash table for lookups.
+   */
+  static constexpr std::size_t MaxScopeSizeWithoutIndex = 32;
+
   Scope::Scope(Node* Source):
     Source(Source) {
       scan(Source);
+      // When a name is declared twice with the same kind, the first
+      // declaration wins.
+      std::stable_sort(Symbols.begin(), Symbols.end(), [](const auto& A, const auto& B) {
+        return A.Name < B.Name || (A.Name == B.Name && A.Kind < B.Kind);
+      });
+      Symbols.shrink_to_fit();
+      if (Symbols.size() > MaxScopeSizeWithoutIndex) {
+        Index.reserve(Symbols.size());
+        for (std::size_t I = Symbols.size(); I-- > 0;) {
+          Index[Symbols[I].Name] = I;
+        }
+      }
     }
 
   void Scope::addSymbol(ByteString Name, Node* Decl, SymbolKind Kind) {
-    Mapping.emplace(Name, std::make_tuple(Decl, Kind));
+    Symbols.push_back(Symbol { Name, Kind, Decl });
   }
 
   void Scope::scan(Node* X) {
@@ -212,9 +262,25 @@ namespace bolt {
 
   Node* Scope::lookupDirect(SymbolPath Path, SymbolKind Kind) {
     ZEN_ASSERT(Path.Modules.empty());
-    auto Match = Mapping.find(Path.Name);
-    if (Match != Mapping.end() && std::get<1>(Match->second) == Kind) {
-      return std::get<0>(Match->second);
+    std::size_t I;
+    if (Index.empty()) {
+      auto Match = std::lower_bound(Symbols.begin(), Symbols.end(), Path.Name, [](const auto& S, const auto& Name) {
+        return S.Name < Name;
+      });
+      I = Match - Symbols.begin();
+    } else {
+      auto Match = Index.find(Path.Name);
+      if (Match == Index.end()) {
+        return nullptr;
+      }
+      I = Match->second;
+    }
+    // A constructor and a variable may have the same name, so check all
+    // symbols with this name and not just the first one.
+    for (; I < Symbols.size() && Symbols[I].Name == Path.Name; I++) {
+      if (Symbols[I].Kind == Kind) {
+        return Symbols[I].Decl;
+      }
     }
     return nullptr;
   }
@@ -287,8 +353,230 @@ namespace bolt {
     return Parent->getScope();
   }
 
+  /**
+   * Nodes are allocated in size classes of 8 bytes. Every block holds nodes of
+   * a single size class and keeps its own list of freed nodes. A block that
+   * becomes empty is handed back to the arena it was cut from, so that it can
+   * be used for another size class, and an arena whose blocks are all empty
+   * is given back to the system. This avoids the bookkeeping that malloc()
+   * adds to each allocation without holding on to memory that was freed.
+   *
+   * Blocks are aligned to their size, which allows finding the block of a
+   * node from its address. Nodes may be freed on another thread than the
+   * one that created them, so the pool is shared and guarded by a mutex.
+   */
+  static constexpr std::size_t NodeSizeStep = 8;
+  static constexpr std::size_t MaxPooledNodeSize = 256;
+  static constexpr std::size_t NodeBlockSize = 16 * 1024;
+  static constexpr std::size_t NodeBlocksPerArena = 64;
+
+  struct FreeNode {
+    FreeNode* Next;
+  };
+
+  struct NodeArena;
+
+  struct NodeBlock {
+
+    NodeArena* Arena;
+
+    /**
+     * The neighbours of this block in the list of blocks of its size class
+     * that have room left, or in the list of empty blocks of its arena.
+     */
+    NodeBlock* Prev = nullptr;
+    NodeBlock* Next = nullptr;
+
+    FreeNode* Free = nullptr;
+    char* BlockPtr;
+    std::size_t LiveCount = 0;
+
+    NodeBlock(NodeArena* Arena):
+      Arena(Arena), BlockPtr(reinterpret_cast<char*>(this) + getHeaderSize()) {}
+
+    static constexpr std::size_t getHeaderSize() {
+      return (sizeof(NodeBlock) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+    bool hasRoom(std::size_t Size) const {
+      return Free != nullptr || BlockPtr + Size <= reinterpret_cast<const char*>(this) + NodeBlockSize;
+    }
+
+  };
+
+  struct NodeArena {
+
+    /**
+     * The neighbours of this arena in the list of arenas that have an unused
+     * block.
+     */
+    NodeArena* Prev = nullptr;
+    NodeArena* Next = nullptr;
+
+    char* Memory;
+
+    NodeBlock* EmptyBlocks = nullptr;
+    std::size_t FreshBlockCount = NodeBlocksPerArena;
+    std::size_t UsedBlockCount = 0;
+
+    NodeArena():
+      Memory(static_cast<char*>(::operator new(NodeBlockSize * NodeBlocksPerArena, std::align_val_t(NodeBlockSize)))) {}
+
+    ~NodeArena() {
+      ::operator delete(Memory, std::align_val_t(NodeBlockSize));
+    }
+
+    bool hasRoom() const {
+      return EmptyBlocks != nullptr || FreshBlockCount > 0;
+    }
+
+  };
+
+  template<typename T>
+  static void unlink(T*& Head, T* Element) {
+    if (Element->Prev != nullptr) {
+      Element->Prev->Next = Element->Next;
+    } else {
+      Head = Element->Next;
+    }
+    if (Element->Next != nullptr) {
+      Element->Next->Prev = Element->Prev;
+    }
+  }
+
+  template<typename T>
+  static void pushFront(T*& Head, T* Element) {
+    Element->Prev = nullptr;
+    Element->Next = Head;
+    if (Head != nullptr) {
+      Head->Prev = Element;
+    }
+    Head = Element;
+  }
+
+  class NodePool {
+
+    std::mutex Mutex;
+
+    /**
+     * For every size class, the blocks that have room for another node. Full
+     * blocks are only referred to by the nodes that live in them.
+     */
+    NodeBlock* Blocks[MaxPooledNodeSize / NodeSizeStep] = {};
+
+    NodeArena* Arenas = nullptr;
+
+    NodeBlock* createBlock() {
+      auto Arena = Arenas;
+      if (Arena == nullptr) {
+        Arena = new NodeArena;
+        pushFront(Arenas, Arena);
+      }
+      void* Memory;
+      if (Arena->EmptyBlocks != nullptr) {
+        Memory = Arena->EmptyBlocks;
+        unlink(Arena->EmptyBlocks, Arena->EmptyBlocks);
+      } else {
+        Memory = Arena->Memory + (NodeBlocksPerArena - Arena->FreshBlockCount) * NodeBlockSize;
+        Arena->FreshBlockCount--;
+      }
+      Arena->UsedBlockCount++;
+      if (!Arena->hasRoom()) {
+        unlink(Arenas, Arena);
+      }
+      return new (Memory) NodeBlock(Arena);
+    }
+
+    void destroyBlock(NodeBlock* Block) {
+      auto Arena = Block->Arena;
+      auto WasFull = !Arena->hasRoom();
+      pushFront(Arena->EmptyBlocks, Block);
+      Arena->UsedBlockCount--;
+      if (!WasFull) {
+        unlink(Arenas, Arena);
+      }
+      if (Arena->UsedBlockCount == 0 && Arenas != nullptr) {
+        // Another arena has room, so this one is not needed to avoid going
+        // back to the system for the next block.
+        delete Arena;
+        return;
+      }
+      pushFront(Arenas, Arena);
+    }
+
+  public:
+
+    void* allocate(std::size_t Size) {
+      std::lock_guard Lock { Mutex };
+      auto& Head = Blocks[Size / NodeSizeStep - 1];
+      auto Block = Head;
+      if (Block == nullptr) {
+        Block = createBlock();
+        pushFront(Head, Block);
+      }
+      void* Ptr;
+      if (Block->Free != nullptr) {
+        Ptr = Block->Free;
+        Block->Free = Block->Free->Next;
+      } else {
+        Ptr = Block->BlockPtr;
+        Block->BlockPtr += Size;
+      }
+      Block->LiveCount++;
+      if (!Block->hasRoom(Size)) {
+        unlink(Head, Block);
+      }
+      return Ptr;
+    }
+
+    void deallocate(void* Ptr, std::size_t Size) {
+      std::lock_guard Lock { Mutex };
+      auto& Head = Blocks[Size / NodeSizeStep - 1];
+      auto Block = reinterpret_cast<NodeBlock*>(reinterpret_cast<std::uintptr_t>(Ptr) & ~(NodeBlockSize - 1));
+      auto WasFull = !Block->hasRoom(Size);
+      auto Node = static_cast<FreeNode*>(Ptr);
+      Node->Next = Block->Free;
+      Block->Free = Node;
+      Block->LiveCount--;
+      if (!WasFull) {
+        unlink(Head, Block);
+      }
+      if (Block->LiveCount == 0) {
+        destroyBlock(Block);
+        return;
+      }
+      // Nodes are taken from the front, so memory that was just freed and is
+      // likely still cached gets used first.
+      pushFront(Head, Block);
+    }
+
+  };
+
+  static NodePool Pool;
+
+  static std::size_t getPooledSize(std::size_t Size) {
+    return (Size + NodeSizeStep - 1) & ~(NodeSizeStep - 1);
+  }
+
+  void* Node::operator new(std::size_t Size) {
+    Size = getPooledSize(Size);
+    if (Size > MaxPooledNodeSize) {
+      return ::operator new(Size);
+    }
+    return Pool.allocate(Size);
+  }
+
+  void Node::operator delete(void* Ptr, std::size_t Size) {
+    Size = getPooledSize(Size);
+    if (Size > MaxPooledNodeSize) {
+      ::operator delete(Ptr);
+      return;
+    }
+    Pool.deallocate(Ptr, Size);
+  }
+
   TextLoc Token::getEndLoc() const {
-    auto Loc = StartLoc;
+    auto Loc = getStartLoc();
     Loc.advance(getText());
     return Loc;
   }
@@ -299,40 +587,43 @@ namespace bolt {
 
       std::vector<Node*> Parents { nullptr };
 
-      void visit(Node* N) {
+      bool enterNode(Node* N) {
         N->Parent = Parents.back();
         Parents.push_back(N);
-        visitEachChild(N);
+        return true;
+      }
+
+      void leaveNode(Node* N) {
         Parents.pop_back();
       }
 
     };
 
     SetParentsVisitor V;
-    V.visit(this);
+    V.walk(this);
 
   }
 
   void Node::unref() {
 
-    --RefCount;
+    // You may be wondering why we aren't unreffing the children in the
+    // destructor. This is due to a behaviour in Clang where a top-level
+    // destructor ~Node() wont get access to the fields in derived classes
+    // because they may already have been destroyed.
+    struct UnrefVisitor : public CSTVisitor<UnrefVisitor> {
 
-    if (RefCount == 0) {
+      bool enterNode(Node* N) {
+        return --N->RefCount == 0;
+      }
 
-      // You may be wondering why we aren't unreffing the children in the
-      // destructor. This is due to a behaviour in Clang where a top-level
-      // destructor ~Node() wont get access to the fields in derived classes
-      // because they may already have been destroyed.
-      struct UnrefVisitor : public CSTVisitor<UnrefVisitor> {
-        void visit(Node* N) {
-          N->unref();
-        }
-      };
-      UnrefVisitor V;
-      V.visitEachChild(this);
+      void leaveNode(Node* N) {
+        delete N;
+      }
 
-      delete this;
-    }
+    };
+
+    UnrefVisitor V;
+    V.walk(this);
 
   }
 
@@ -545,6 +836,14 @@ namespace bolt {
     return RBrace;
   }
 
+  Token* InvalidExpression::getFirstToken() const {
+    return Tokens.front();
+  }
+
+  Token* InvalidExpression::getLastToken() const {
+    return Tokens.back();
+  }
+
   Token* MemberExpression::getFirstToken() const {
     return E->getFirstToken();
   }
@@ -788,6 +1087,34 @@ namespace bolt {
     return BlockStart;
   }
 
+  SourceFile::SourceFile(TextFile& File, std::vector<Node*> Elements, std::vector<TextLoc> ElementStarts):
+    Node(NodeKind::SourceFile), File(File), Elements(Elements), ElementStarts(ElementStarts) {
+      if (this->ElementStarts.empty()) {
+        for (auto Element: Elements) {
+          this->ElementStarts.push_back(Element->getFirstToken()->getStartLoc());
+        }
+      }
+      ZEN_ASSERT(this->ElementStarts.size() == Elements.size());
+    }
+
+  void SourceFile::replaceElements(std::size_t First, std::size_t Last, std::vector<Node*> NewElements, std::vector<TextLoc> NewStarts) {
+    ZEN_ASSERT(First <= Last && Last <= Elements.size());
+    ZEN_ASSERT(NewElements.size() == NewStarts.size());
+    for (auto I = First; I < Last; I++) {
+      Elements[I]->unref();
+    }
+    for (auto Element: NewElements) {
+      Element->setParents();
+      Element->Parent = this;
+    }
+    Elements.erase(Elements.begin() + First, Elements.begin() + Last);
+    Elements.insert(Elements.begin() + First, NewElements.begin(), NewElements.end());
+    ElementStarts.erase(ElementStarts.begin() + First, ElementStarts.begin() + Last);
+    ElementStarts.insert(ElementStarts.begin() + First, NewStarts.begin(), NewStarts.end());
+    delete TheScope;
+    TheScope = nullptr;
+  }
+
   Token* SourceFile::getFirstToken() const {
     if (Elements.size()) {
       return Elements.front()->getFirstToken();
@@ -990,5 +1317,22 @@ namespace bolt {
     return SymbolPath { ModuleNames, Name->getCanonicalText() };
   }
 
+  SymbolPath ReferenceTypeExpression::getSymbolPath() const {
+    std::vector<ByteString> ModuleNames;
+    for (auto [Name, Dot]: ModulePath) {
+      ModuleNames.push_back(Name->getCanonicalText());
+    }
+    return SymbolPath { ModuleNames, Name->getCanonicalText() };
+  }
+
+  Node* ReferenceExpression::getDeclaration() {
+    if (!IsResolved) {
+      // Declarations of other modules are not part of the syntax tree
+      Declaration = ModulePath.empty() ? getScope()->lookup(getSymbolPath()) : nullptr;
+      IsResolved = true;
+    }
+    return Declaration;
+  }
+
 }
 
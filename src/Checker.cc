@@ -15,6 +15,7 @@
 #include "bolt/Diagnostics.hpp"
 #include "bolt/CST.hpp"
 #include "bolt/Checker.hpp"
+#include "bolt/Evaluator.hpp"
 
 namespace bolt {
 
@@ -66,12 +67,44 @@ namespace bolt {
 
   }
 
-  Checker::Checker(const LanguageConfig& Config, DiagnosticEngine& DE):
-    Config(Config), DE(DE) {
-      BoolType = createConType("Bool");
-      IntType = createConType("Int");
-      StringType = createConType("String");
-      ListType = createConType("List");
+  Prelude::Prelude() {
+    BoolType = new TCon(ConTypeCount++, "Bool");
+    IntType = new TCon(ConTypeCount++, "Int");
+    StringType = new TCon(ConTypeCount++, "String");
+    ListType = new TCon(ConTypeCount++, "List");
+    Env.emplace("String", new Forall(StringType));
+    Env.emplace("Int", new Forall(IntType));
+    Env.emplace("Bool", new Forall(BoolType));
+    Env.emplace("List", new Forall(ListType));
+    Env.emplace("True", new Forall(BoolType));
+    Env.emplace("False", new Forall(BoolType));
+    auto A = new TVar(TypeVarCount++, VarKind::Unification);
+    Env.emplace("==", new Forall(new TVSet { A }, new ConstraintSet, TArrow::build({ A, A }, BoolType)));
+    // The types of builtins are derived from their implementation
+    for (const auto& B: getBuiltins()) {
+      Env.emplace(B.Name, new Forall(B.GetType(*this)));
+    }
+  }
+
+  const Prelude& Prelude::getDefault() {
+    // The initialization of a static local is thread-safe
+    static const Prelude Default;
+    return Default;
+  }
+
+  Scheme* Prelude::lookup(const ByteString& Name) const {
+    auto Match = Env.find(Name);
+    return Match != Env.end() ? Match->second : nullptr;
+  }
+
+  Checker::Checker(const LanguageConfig& Config, DiagnosticEngine& DE, const Prelude& ThePrelude):
+    Config(Config), DE(DE), ThePrelude(ThePrelude) {
+      NextConTypeId = ThePrelude.getConTypeCount();
+      NextTypeVarId = ThePrelude.getTypeVarCount();
+      BoolType = ThePrelude.getBoolType();
+      IntType = ThePrelude.getIntType();
+      StringType = ThePrelude.getStringType();
+      ListType = ThePrelude.getListType();
     }
 
   Scheme* Checker::lookup(ByteString Name) {
@@ -86,7 +119,34 @@ namespace bolt {
         break;
       }
     }
-    return nullptr;
+    return ThePrelude.lookup(Name);
+  }
+
+  static ByteString getModuleName(const SymbolPath& Path) {
+    ByteString Out;
+    for (const auto& Name: Path.Modules) {
+      if (!Out.empty()) {
+        Out.push_back('.');
+      }
+      Out.append(Name);
+    }
+    return Out;
+  }
+
+  static ByteString getQualifiedName(const SymbolPath& Path) {
+    return getModuleName(Path) + "." + Path.Name;
+  }
+
+  Scheme* Checker::lookupQualified(const SymbolPath& Path) {
+    auto Module = ImportedModules.find(getModuleName(Path));
+    if (Module == ImportedModules.end()) {
+      return nullptr;
+    }
+    auto Match = Module->second.find(Path.Name);
+    if (Match == Module->second.end()) {
+      return nullptr;
+    }
+    return Match->second;
   }
 
   Type* Checker::lookupMono(ByteString Name) {
@@ -258,11 +318,8 @@ namespace bolt {
           inferTypeExpression(TE);
         }
 
-        auto Match = InstanceMap.find(Decl->Name->getCanonicalText());
-        if (Match == InstanceMap.end()) {
-          InstanceMap.emplace(Decl->Name->getCanonicalText(), std::vector { Decl });
-        } else {
-          Match->second.push_back(Decl);
+        if (!Decl->TypeExps.empty()) {
+          InstanceMap[Decl->Name->getCanonicalText()].push_back(Decl->TypeExps[0]->getType());
         }
 
         for (auto Element: Decl->Elements) {
@@ -413,6 +470,9 @@ namespace bolt {
       }
 
       void visitLetDeclaration(LetDeclaration* Let) {
+        // The tree might have been checked before, e.g. in a language server
+        Let->Visited = false;
+        Let->IsCycleActive = false;
         if (Let->isFunction()) {
           Let->Ctx = createDerivedContext();
           Contexts.push(Let->Ctx);
@@ -660,6 +720,12 @@ namespace bolt {
       {
         // Function declarations are handled separately in inferLetDeclaration()
         auto Decl = static_cast<LetDeclaration*>(N);
+        TraceEvent Event { Trace, "infer", "infer" };
+        if (Event.isEnabled()) {
+          Event.setName(Decl->getNameAsString());
+          Event.addArg("declaration", Decl->getNameAsString());
+          Event.addSourceRange(Decl);
+        }
         if (Decl->isFunction() && !Decl->Visited) {
           Decl->IsCycleActive = true;
           Decl->Visited = true;
@@ -798,10 +864,13 @@ namespace bolt {
       case NodeKind::ReferenceTypeExpression:
       {
         auto RefTE = static_cast<ReferenceTypeExpression*>(N);
-        auto Scm = lookup(RefTE->Name->getCanonicalText());
+        auto Scm = RefTE->ModulePath.empty()
+          ? lookup(RefTE->Name->getCanonicalText())
+          : lookupQualified(RefTE->getSymbolPath());
         Type* Ty;
         if (Scm == nullptr) {
-          DE.add<BindingNotFoundDiagnostic>(RefTE->Name->getCanonicalText(), RefTE->Name);
+          auto Path = RefTE->getSymbolPath();
+          DE.add<BindingNotFoundDiagnostic>(Path.Modules.empty() ? Path.Name : getQualifiedName(Path), RefTE->Name);
           Ty = createTypeVar();
         } else {
           Ty = instantiate(Scm, RefTE);
@@ -958,7 +1027,17 @@ namespace bolt {
       case NodeKind::ReferenceExpression:
       {
         auto Ref = static_cast<ReferenceExpression*>(X);
-        ZEN_ASSERT(Ref->ModulePath.empty());
+        if (!Ref->ModulePath.empty()) {
+          auto Path = Ref->getSymbolPath();
+          auto Scm = lookupQualified(Path);
+          if (!Scm) {
+            DE.add<BindingNotFoundDiagnostic>(getQualifiedName(Path), Ref->Name);
+            Ty = createTypeVar();
+            break;
+          }
+          Ty = instantiate(Scm, X);
+          break;
+        }
         if (Ref->Name->is<IdentifierAlt>()) {
           auto Scm = lookup(Ref->Name->getCanonicalText());
           if (!Scm) {
@@ -969,10 +1048,16 @@ namespace bolt {
           Ty = instantiate(Scm, X);
           break;
         }
-        auto Target = Ref->getScope()->lookup(Ref->getSymbolPath());
+        auto Target = Ref->getDeclaration();
         if (!Target) {
-          DE.add<BindingNotFoundDiagnostic>(Ref->Name->getCanonicalText(), Ref->Name);
-          Ty = createTypeVar();
+          // Builtins such as print do not have a declaration
+          auto Scm = lookup(Ref->Name->getCanonicalText());
+          if (!Scm) {
+            DE.add<BindingNotFoundDiagnostic>(Ref->Name->getCanonicalText(), Ref->Name);
+            Ty = createTypeVar();
+            break;
+          }
+          Ty = instantiate(Scm, X);
           break;
         }
         if (Target->getKind() == NodeKind::LetDeclaration) {
@@ -1064,6 +1149,12 @@ namespace bolt {
         break;
       }
 
+      case NodeKind::InvalidExpression:
+        // The parser already reported what is wrong with it, so it is allowed
+        // to have any type.
+        Ty = createTypeVar();
+        break;
+
       default:
         ZEN_UNREACHABLE
 
@@ -1171,17 +1262,31 @@ namespace bolt {
 
       std::stack<Node*> Stack;
 
-      void visitLetDeclaration(LetDeclaration* N) {
-        RefGraph.addVertex(N);
-        Stack.push(N);
-        visitEachChild(N);
-        Stack.pop();
+      bool enterNode(Node* N) {
+        switch (N->getKind()) {
+          case NodeKind::LetDeclaration:
+            RefGraph.addVertex(N);
+            Stack.push(N);
+            return true;
+          case NodeKind::ReferenceExpression:
+            visitReferenceExpression(static_cast<ReferenceExpression*>(N));
+            return false;
+          default:
+            return true;
+        }
+      }
+
+      void leaveNode(Node* N) {
+        if (N->getKind() == NodeKind::LetDeclaration) {
+          Stack.pop();
+        }
       }
 
       void visitReferenceExpression(ReferenceExpression* N) {
-        auto Y = static_cast<ReferenceExpression*>(N);
-        auto Def = Y->getScope()->lookup(Y->getSymbolPath());
-        // Name lookup failures will be reported directly in inferExpression().
+        // This binds every reference to its declaration before inference
+        // starts. Name lookup failures will be reported directly in
+        // inferExpression().
+        auto Def = N->getDeclaration();
         if (Def == nullptr || Def->getKind() == NodeKind::SourceFile) {
           return;
         }
@@ -1201,7 +1306,7 @@ namespace bolt {
     };
 
     Visitor V { {}, RefGraph };
-    V.visit(SF);
+    V.walk(SF);
 
   }
 
@@ -1210,41 +1315,66 @@ namespace bolt {
   }
 
   void Checker::check(SourceFile *SF) {
+    TraceEvent CheckEvent { Trace, "checker", "check" };
+    CheckEvent.addArg("file", SF->getTextFile().getPath());
     initialize(SF);
     setContext(SF->Ctx);
-    addBinding("String", new Forall(StringType));
-    addBinding("Int", new Forall(IntType));
-    addBinding("Bool", new Forall(BoolType));
-    addBinding("List", new Forall(ListType));
-    addBinding("True", new Forall(BoolType));
-    addBinding("False", new Forall(BoolType));
-    auto A = createTypeVar();
-    addBinding("==", new Forall(new TVSet { A }, new ConstraintSet, TArrow::build({ A, A }, BoolType)));
-    addBinding("+", new Forall(TArrow::build({ IntType, IntType }, IntType)));
-    addBinding("-", new Forall(TArrow::build({ IntType, IntType }, IntType)));
-    addBinding("*", new Forall(TArrow::build({ IntType, IntType }, IntType)));
-    addBinding("/", new Forall(TArrow::build({ IntType, IntType }, IntType)));
-    populate(SF);
-    forwardDeclare(SF);
-    auto SCCs = RefGraph.strongconnect();
+    {
+      TraceEvent Event { Trace, "checker", "populate" };
+      populate(SF);
+    }
+    {
+      TraceEvent Event { Trace, "checker", "forward-declare" };
+      forwardDeclare(SF);
+    }
+    std::vector<std::vector<Node*>> SCCs;
+    {
+      TraceEvent Event { Trace, "checker", "strongconnect" };
+      SCCs = RefGraph.strongconnect();
+      if (Event.isEnabled()) {
+        Event.addArg("components", std::to_string(SCCs.size()));
+      }
+    }
     for (auto Nodes: SCCs) {
+      TraceEvent Event { Trace, "scc", "scc" };
       auto TVs = new TVSet;
       auto Constraints = new ConstraintSet;
+      ByteString Names;
       for (auto N: Nodes) {
         if (N->getKind() != NodeKind::LetDeclaration) {
           continue;
         }
         auto Decl = static_cast<LetDeclaration*>(N);
+        if (Event.isEnabled()) {
+          if (Names.empty()) {
+            // The range of the first declaration is enough to find the group
+            Event.addSourceRange(Decl);
+          } else {
+            Names.append(", ");
+          }
+          Names.append(Decl->getNameAsString());
+        }
         forwardDeclareFunctionDeclaration(Decl, TVs, Constraints);
       }
+      if (Event.isEnabled()) {
+        Event.setName(Names);
+        Event.addArg("declarations", Names);
+      }
     }
     setContext(SF->Ctx);
-    infer(SF);
+    {
+      TraceEvent Event { Trace, "checker", "infer" };
+      infer(SF);
+    }
 
     // Important because otherwise some logic for some optimisations will kick in that are no longer active.
     ActiveContext = nullptr;
 
+    TraceEvent Event { Trace, "checker", "solve" };
     solve(new CMany(*SF->Ctx->Constraints));
+    if (Event.isEnabled()) {
+      Event.addArg("constraints", std::to_string(SF->Ctx->Constraints->size()));
+    }
   }
 
   void Checker::solve(Constraint* Constraint) {
@@ -1372,8 +1502,8 @@ namespace bolt {
       auto Match = C.InstanceMap.find(Class);
       std::vector<TypeclassContext> S;
       if (Match != C.InstanceMap.end()) {
-        for (auto Instance: Match->second) {
-          if (assignableTo(Ty.Orig, Instance->TypeExps[0]->getType())) {
+        for (auto InstanceTy: Match->second) {
+          if (assignableTo(Ty.Orig, InstanceTy)) {
             std::vector<TypeclassContext> S;
             for (auto Arg: Ty.Args) {
               TypeclassContext Classes;
@@ -1501,6 +1631,8 @@ namespace bolt {
 
   bool Unifier::unify(Type* A, Type* B, bool DidSwap) {
 
+    C.UnificationCount++;
+
     A = C.simplifyType(A);
     B = C.simplifyType(B);
 
@@ -1760,6 +1892,7 @@ namespace bolt {
 
   void Checker::solveEqual(CEqual* C) {
     // std::cerr << describe(C->Left) << " ~ " << describe(C->Right) << std::endl;
+    SolvedConstraintCount++;
     Unifier A { *this, C };
     A.unify();
   }
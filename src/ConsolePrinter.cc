@@ -45,7 +45,7 @@ namespace bolt {
     return std::ceil(std::log10(number+1));
   }
 
-  static std::string describe(NodeKind Type) {
+  std::string describe(NodeKind Type) {
     switch (Type) {
       case NodeKind::Identifier:
         return "an identifier starting with a lowercase letter";
@@ -268,77 +268,88 @@ namespace bolt {
     }
   }
 
-  void writeForegroundANSI(Color C, std::ostream& Out) {
+  void writeForegroundANSI(Color C, ByteString& Out) {
     switch (C) {
       case Color::None:
         break;
       case Color::Black:
-        Out << ANSI_FG_BLACK;
+        Out.append(ANSI_FG_BLACK);
         break;
       case Color::White:
-        Out << ANSI_FG_WHITE;
+        Out.append(ANSI_FG_WHITE);
         break;
       case Color::Red:
-        Out << ANSI_FG_RED;
+        Out.append(ANSI_FG_RED);
         break;
       case Color::Yellow:
-        Out << ANSI_FG_YELLOW;
+        Out.append(ANSI_FG_YELLOW);
         break;
       case Color::Green:
-        Out << ANSI_FG_GREEN;
+        Out.append(ANSI_FG_GREEN);
         break;
       case Color::Blue:
-        Out << ANSI_FG_BLUE;
+        Out.append(ANSI_FG_BLUE);
         break;
       case Color::Cyan:
-        Out << ANSI_FG_CYAN;
+        Out.append(ANSI_FG_CYAN);
         break;
       case Color::Magenta:
-        Out << ANSI_FG_MAGENTA;
+        Out.append(ANSI_FG_MAGENTA);
         break;
     }
   }
 
-  void writeBackgroundANSI(Color C, std::ostream& Out) {
+  void writeBackgroundANSI(Color C, ByteString& Out) {
     switch (C) {
       case Color::None:
         break;
       case Color::Black:
-        Out << ANSI_BG_BLACK;
+        Out.append(ANSI_BG_BLACK);
         break;
       case Color::White:
-        Out << ANSI_BG_WHITE;
+        Out.append(ANSI_BG_WHITE);
         break;
       case Color::Red:
-        Out << ANSI_BG_RED;
+        Out.append(ANSI_BG_RED);
         break;
       case Color::Yellow:
-        Out << ANSI_BG_YELLOW;
+        Out.append(ANSI_BG_YELLOW);
         break;
       case Color::Green:
-        Out << ANSI_BG_GREEN;
+        Out.append(ANSI_BG_GREEN);
         break;
       case Color::Blue:
-        Out << ANSI_BG_BLUE;
+        Out.append(ANSI_BG_BLUE);
         break;
       case Color::Cyan:
-        Out << ANSI_BG_CYAN;
+        Out.append(ANSI_BG_CYAN);
         break;
       case Color::Magenta:
-        Out << ANSI_BG_MAGENTA;
+        Out.append(ANSI_BG_MAGENTA);
         break;
     }
   }
 
+  /**
+   * The amount of bytes that may be buffered while writing many diagnostics
+   * at once before they are written to the output stream.
+   */
+  static constexpr std::size_t MaxBufferSize = 64 * 1024;
+
   ConsolePrinter::ConsolePrinter(std::ostream& Out):
     Out(Out) {}
 
+  void ConsolePrinter::flush() {
+    Out.write(Buffer.data(), Buffer.size());
+    Buffer.clear();
+  }
+
   void ConsolePrinter::setForegroundColor(Color C) {
     ActiveStyle.setForegroundColor(C);
     if (!EnableColors) {
       return;
     }
-    writeForegroundANSI(C, Out);
+    writeForegroundANSI(C, Buffer);
   }
 
   void ConsolePrinter::setBackgroundColor(Color C) {
@@ -347,21 +358,21 @@ namespace bolt {
       return;
     }
     if (C == Color::None) {
-      Out << ANSI_RESET;
+      Buffer.append(ANSI_RESET);
       applyStyles();
     }
-    writeBackgroundANSI(C, Out);
+    writeBackgroundANSI(C, Buffer);
   }
 
   void ConsolePrinter::applyStyles() {
     if (ActiveStyle.isBold()) {
-      Out << ANSI_BOLD;
+      Buffer.append(ANSI_BOLD);
     }
     if (ActiveStyle.isUnderline()) {
-      Out << ANSI_UNDERLINE;
+      Buffer.append(ANSI_UNDERLINE);
     }
     if (ActiveStyle.isItalic()) {
-      Out << ANSI_ITALIC;
+      Buffer.append(ANSI_ITALIC);
     }
     if (ActiveStyle.hasBackgroundColor()) {
       setBackgroundColor(ActiveStyle.getBackgroundColor());
@@ -377,9 +388,9 @@ namespace bolt {
       return;
     }
     if (Enable) {
-      Out << ANSI_BOLD;
+      Buffer.append(ANSI_BOLD);
     } else {
-      Out << ANSI_RESET;
+      Buffer.append(ANSI_RESET);
       applyStyles();
     }
   }
@@ -390,9 +401,9 @@ namespace bolt {
       return;
     }
     if (Enable) {
-      Out << ANSI_ITALIC;
+      Buffer.append(ANSI_ITALIC);
     } else {
-      Out << ANSI_RESET;
+      Buffer.append(ANSI_RESET);
       applyStyles();
     }
   }
@@ -403,9 +414,9 @@ namespace bolt {
       return;
     }
     if (Enable) {
-      Out << ANSI_UNDERLINE;
+      Buffer.append(ANSI_UNDERLINE);
     } else {
-      Out << ANSI_RESET;
+      Buffer.append(ANSI_RESET);
       applyStyles();
     }
   }
@@ -413,7 +424,7 @@ namespace bolt {
   void ConsolePrinter::resetStyles() {
     ActiveStyle.reset();
     if (EnableColors) {
-      Out << ANSI_RESET;
+      Buffer.append(ANSI_RESET);
     }
   }
 
@@ -423,15 +434,13 @@ namespace bolt {
   ) {
     ZEN_ASSERT(Text.size() <= GutterWidth);
     auto LeadingSpaces = GutterWidth - Text.size();
-    Out << "  ";
+    Buffer.append("  ");
     setForegroundColor(Color::Black);
     setBackgroundColor(Color::White);
-    for (std::size_t i = 0; i < LeadingSpaces; i++) {
-      Out << ' ';
-    }
-    Out << Text;
+    Buffer.append(LeadingSpaces, ' ');
+    Buffer.append(Text);
     resetStyles();
-    Out << " ";
+    Buffer.push_back(' ');
   }
 
   void ConsolePrinter::writeHighlight(
@@ -444,28 +453,24 @@ namespace bolt {
     if (Line < Range.Start.Line || Range.End.Line < Line) {
       return;
     }
-    Out << "  ";
+    Buffer.append("  ");
     setBackgroundColor(Color::White);
-    for (std::size_t i = 0; i < GutterWidth; i++) {
-      Out << ' ';
-    }
+    Buffer.append(GutterWidth, ' ');
     resetStyles();
-    Out << ' ';
+    Buffer.push_back(' ');
     std::size_t start_column = Range.Start.Line == Line ? Range.Start.Column : 1;
     std::size_t end_column = Range.End.Line == Line ? Range.End.Column : LineLength+1;
-    for (std::size_t i = 1; i < start_column; i++) {
-      Out << ' ';
+    if (start_column > 1) {
+      Buffer.append(start_column - 1, ' ');
     }
     setForegroundColor(HighlightColor);
     if (start_column == end_column) {
-      Out << "↖";
-    } else {
-      for (std::size_t i = start_column; i < end_column; i++) {
-        Out << '~';
-      }
+      Buffer.append("↖");
+    } else if (start_column < end_column) {
+      Buffer.append(end_column - start_column, '~');
     }
     resetStyles();
-    Out << '\n';
+    Buffer.push_back('\n');
   }
 
  void ConsolePrinter::writeExcerpt(
@@ -475,12 +480,15 @@ namespace bolt {
     Color HighlightColor
   ) {
 
+    if (!PrintExcerpts) {
+      return;
+    }
+
     auto LineCount = File.getLineCount();
     auto Text = File.getText();
     auto StartPos = ToPrint.Start;
     auto EndPos = ToPrint.End;
     auto StartLine = StartPos.Line-1 > ExcerptLinesPre ? StartPos.Line - ExcerptLinesPre : 1;
-    auto StartOffset = File.getStartOffsetOfLine(StartLine);
     auto EndLine = std::min(LineCount, EndPos.Line + ExcerptLinesPost);
     auto EndOffset = File.getEndOffsetOfLine(EndLine);
     auto GutterWidth = std::max<std::size_t>(2, countDigits(EndLine+1));
@@ -488,39 +496,35 @@ namespace bolt {
     auto HighlightEnd = ToHighlight.End;
     auto HighlightRange = TextRange { HighlightStart, HighlightEnd };
 
-    std::size_t CurrColumn = 1;
-    std::size_t CurrLine = StartLine;
-    bool AtBlankLine = true;
-    for (std::size_t I = StartOffset; I < EndOffset; I++) {
-      auto C = Text[I];
-      if (AtBlankLine) {
-        writeGutter(GutterWidth, std::to_string(CurrLine));
-      }
-      if (C == '\n') {
-        Out << C;
-        writeHighlight(GutterWidth, HighlightRange, HighlightColor, CurrLine, CurrColumn);
-        CurrLine++;
-        CurrColumn = 1;
-        AtBlankLine = true;
-      } else {
-        AtBlankLine = false;
-        Out << C;
-        CurrColumn++;
+    // Copy whole lines at once instead of going character by character
+    for (auto CurrLine = StartLine; CurrLine <= EndLine; CurrLine++) {
+      auto LineStart = File.getStartOffsetOfLine(CurrLine);
+      auto LineEnd = std::min(File.getEndOffsetOfLine(CurrLine), EndOffset);
+      if (LineStart >= LineEnd) {
+        break;
       }
+      auto Line = Text.substr(LineStart, LineEnd - LineStart);
+      writeGutter(GutterWidth, std::to_string(CurrLine));
+      if (Line.back() != '\n') {
+        Buffer.append(Line);
+        break;
+      }
+      Buffer.append(Line);
+      writeHighlight(GutterWidth, HighlightRange, HighlightColor, CurrLine, Line.size());
     }
 
   }
 
   void ConsolePrinter::write(const std::string_view& S) {
-    Out << S;
+    Buffer.append(S);
   }
 
   void ConsolePrinter::write(char C) {
-    Out << C;
+    Buffer.push_back(C);
   }
 
   void ConsolePrinter::write(std::size_t I) {
-    Out << I;
+    Buffer.append(std::to_string(I));
   }
 
   void ConsolePrinter::writeBinding(const ByteString& Name) {
@@ -691,6 +695,9 @@ namespace bolt {
   }
 
   void ConsolePrinter::writeLoc(const TextFile& File, const TextLoc& Loc) {
+    if (!PrintFilePosition) {
+      return;
+    }
     setForegroundColor(Color::Yellow);
     write(File.getPath());
     write(":");
@@ -725,12 +732,27 @@ namespace bolt {
   }
 
   void ConsolePrinter::writeDiagnostic(const Diagnostic& D) {
+    renderDiagnostic(D);
+    flush();
+  }
+
+  void ConsolePrinter::writeDiagnostics(const std::vector<Diagnostic*>& Diagnostics) {
+    for (auto D: Diagnostics) {
+      renderDiagnostic(*D);
+      if (Buffer.size() >= MaxBufferSize) {
+        flush();
+      }
+    }
+    flush();
+  }
+
+  void ConsolePrinter::renderDiagnostic(const Diagnostic& D) {
 
     switch (D.getKind()) {
 
       case DiagnosticKind::BindingNotFound:
       {
-        auto E = static_cast<const BindingNotFoundDiagnostic&>(D);
+        const auto& E = static_cast<const BindingNotFoundDiagnostic&>(D);
         writePrefix(E);
         write("binding ");
         writeBinding(E.Name);
@@ -739,14 +761,14 @@ namespace bolt {
           auto Range = E.Initiator->getRange();
           //std::cerr << Range.Start.Line << ":" << Range.Start.Column << "-" << Range.End.Line << ":" << Range.End.Column << "\n";
           writeExcerpt(E.Initiator->getSourceFile()->getTextFile(), Range, Range, Color::Red);
-          Out << "\n";
+          write("\n");
         }
         break;
       }
 
       case DiagnosticKind::UnexpectedToken:
       {
-        auto E = static_cast<const UnexpectedTokenDiagnostic&>(D);
+        const auto& E = static_cast<const UnexpectedTokenDiagnostic&>(D);
         writePrefix(E);
         writeLoc(E.File, E.Actual->getStartLoc());
         write(" expected ");
@@ -759,7 +781,7 @@ namespace bolt {
             break;
           default:
             auto Iter = E.Expected.begin();
-            Out << describe(*Iter++);
+            write(describe(*Iter++));
             NodeKind Prev = *Iter++;
             while (Iter != E.Expected.end()) {
               write(", ");
@@ -780,7 +802,7 @@ namespace bolt {
 
       case DiagnosticKind::UnexpectedString:
       {
-        auto E = static_cast<const UnexpectedStringDiagnostic&>(D);
+        const auto& E = static_cast<const UnexpectedStringDiagnostic&>(D);
         writePrefix(E);
         writeLoc(E.File, E.Location);
         write(" unexpected '");
@@ -806,7 +828,7 @@ namespace bolt {
 
       case DiagnosticKind::UnificationError:
       {
-        auto E = static_cast<const UnificationErrorDiagnostic&>(D);
+        const auto& E = static_cast<const UnificationErrorDiagnostic&>(D);
         auto Left = E.OrigLeft->resolve(E.LeftPath);
         auto Right = E.OrigRight->resolve(E.RightPath);
         writePrefix(E);
@@ -857,7 +879,7 @@ namespace bolt {
 
       case DiagnosticKind::TypeclassMissing:
       {
-        auto E = static_cast<const TypeclassMissingDiagnostic&>(D);
+        const auto& E = static_cast<const TypeclassMissingDiagnostic&>(D);
         writePrefix(E);
         write("the type class ");
         writeTypeclassSignature(E.Sig);
@@ -869,7 +891,7 @@ namespace bolt {
 
       case DiagnosticKind::InstanceNotFound:
       {
-        auto E = static_cast<const InstanceNotFoundDiagnostic&>(D);
+        const auto& E = static_cast<const InstanceNotFoundDiagnostic&>(D);
         writePrefix(E);
         write("a type class instance ");
         writeTypeclassName(E.TypeclassName);
@@ -883,7 +905,7 @@ namespace bolt {
 
       case DiagnosticKind::TupleIndexOutOfRange:
       {
-        auto E = static_cast<const TupleIndexOutOfRangeDiagnostic&>(D);
+        const auto& E = static_cast<const TupleIndexOutOfRangeDiagnostic&>(D);
         writePrefix(E);
         write("the index ");
         writeType(E.I);
@@ -894,7 +916,7 @@ namespace bolt {
 
       case DiagnosticKind::InvalidTypeToTypeclass:
       {
-        auto E = static_cast<const InvalidTypeToTypeclassDiagnostic&>(D);
+        const auto& E = static_cast<const InvalidTypeToTypeclassDiagnostic&>(D);
         writePrefix(E);
         write("the type ");
         writeType(E.Actual);
@@ -911,7 +933,7 @@ namespace bolt {
 
       case DiagnosticKind::FieldNotFound:
       {
-        auto E = static_cast<const FieldNotFoundDiagnostic&>(D);
+        const auto& E = static_cast<const FieldNotFoundDiagnostic&>(D);
         writePrefix(E);
         write("the field '");
         write(E.Name);
@@ -921,6 +943,18 @@ namespace bolt {
         break;
       }
 
+      case DiagnosticKind::NotSupported:
+      {
+        const auto& E = static_cast<const NotSupportedDiagnostic&>(D);
+        writePrefix(E);
+        write("compiling ");
+        write(E.Feature);
+        write(" is not supported yet\n\n");
+        writeNode(E.Source);
+        write("\n");
+        break;
+      }
+
     }
 
   }
@@ -0,0 +1,333 @@
+
+#include <algorithm>
+
+#include "zen/config.hpp"
+
+#include "bolt/CST.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/ConstantFolder.hpp"
+
+namespace bolt {
+
+  /**
+   * The maximum amount of nodes the body of a function can have for calls to
+   * it to be computed at compile time.
+   */
+  static constexpr std::size_t MaxInlineSize = 16;
+
+  static bool isLiteral(Expression* X) {
+    return X->getKind() == NodeKind::LiteralExpression;
+  }
+
+  static bool isNonZeroInteger(Expression* X) {
+    if (!isLiteral(X)) {
+      return false;
+    }
+    auto Token = static_cast<LiteralExpression*>(X)->Token;
+    return Token->getKind() == NodeKind::IntegerLiteral
+        && static_cast<IntegerLiteral*>(Token)->getInteger() != 0;
+  }
+
+  static void collectBindings(Pattern* P, std::vector<ByteString>& Out) {
+    switch (P->getKind()) {
+      case NodeKind::BindPattern:
+        Out.push_back(static_cast<BindPattern*>(P)->Name->getCanonicalText());
+        break;
+      case NodeKind::NamedPattern:
+        for (auto Nested: static_cast<NamedPattern*>(P)->Patterns) {
+          collectBindings(Nested, Out);
+        }
+        break;
+      case NodeKind::NestedPattern:
+        collectBindings(static_cast<NestedPattern*>(P)->P, Out);
+        break;
+      case NodeKind::TuplePattern:
+        for (auto [Element, Comma]: static_cast<TuplePattern*>(P)->Elements) {
+          collectBindings(Element, Out);
+        }
+        break;
+      case NodeKind::ListPattern:
+        for (auto [Element, Comma]: static_cast<ListPattern*>(P)->Elements) {
+          collectBindings(Element, Out);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  ConstantFolder::ConstantFolder(Checker& C):
+    E(&C) {}
+
+  LetDeclaration* ConstantFolder::resolveLet(ReferenceExpression* Ref) {
+    if (!Ref->ModulePath.empty()) {
+      return nullptr;
+    }
+    auto Name = Ref->Name->getCanonicalText();
+    if (std::find(CaseBindings.begin(), CaseBindings.end(), Name) != CaseBindings.end()) {
+      return nullptr;
+    }
+    auto Target = Ref->getDeclaration();
+    if (Target == nullptr || Target->getKind() != NodeKind::LetDeclaration) {
+      return nullptr;
+    }
+    return static_cast<LetDeclaration*>(Target);
+  }
+
+  bool ConstantFolder::isBuiltinOperator(InfixExpression* Infix) {
+    return E.getIntegerOp(Infix) != IntegerOp::None;
+  }
+
+  bool ConstantFolder::isInlineableExpression(Expression* X, LetDeclaration* Let, std::size_t& Size) {
+    Size++;
+    switch (X->getKind()) {
+      case NodeKind::LiteralExpression:
+        return true;
+      case NodeKind::ReferenceExpression:
+      {
+        // The function is applied in an environment that only contains its
+        // parameters.
+        auto Ref = static_cast<ReferenceExpression*>(X);
+        auto Target = Ref->getDeclaration();
+        return Target != nullptr
+            && Target->getKind() == NodeKind::Parameter
+            && Target->Parent == Let;
+      }
+      case NodeKind::NestedExpression:
+        return isInlineableExpression(static_cast<NestedExpression*>(X)->Inner, Let, Size);
+      case NodeKind::InfixExpression:
+      {
+        auto Infix = static_cast<InfixExpression*>(X);
+        return isBuiltinOperator(Infix)
+            && (Infix->Operator->getText() != "/" || isNonZeroInteger(Infix->Right))
+            && isInlineableExpression(Infix->Left, Let, Size)
+            && isInlineableExpression(Infix->Right, Let, Size);
+      }
+      default:
+        return false;
+    }
+  }
+
+  bool ConstantFolder::isInlineable(LetDeclaration* Let) {
+    auto Match = InlineableFunctions.find(Let);
+    if (Match != InlineableFunctions.end()) {
+      return Match->second;
+    }
+    InlineableFunctions.emplace(Let, false);
+    if (Let->Params.empty() || Let->Body == nullptr || Let->Body->getKind() != NodeKind::LetExprBody) {
+      return false;
+    }
+    for (auto Param: Let->Params) {
+      if (Param->Pattern->getKind() != NodeKind::BindPattern) {
+        return false;
+      }
+    }
+    foldLet(Let);
+    std::size_t Size = 0;
+    auto Result = isInlineableExpression(static_cast<LetExprBody*>(Let->Body)->Expression, Let, Size) && Size <= MaxInlineSize;
+    InlineableFunctions[Let] = Result;
+    return Result;
+  }
+
+  Expression* ConstantFolder::createLiteral(Expression* Original, const Value& V) {
+    auto Loc = Original->getFirstToken()->getStartLoc();
+    Literal* Token;
+    switch (V.getKind()) {
+      case ValueKind::Integer:
+        Token = new IntegerLiteral(V.asInteger(), Loc);
+        break;
+      case ValueKind::String:
+        Token = new StringLiteral(V.asString(), Loc);
+        break;
+      default:
+        return Original;
+    }
+    auto Lit = new LiteralExpression(Token);
+    Token->Parent = Lit;
+    Lit->Parent = Original->Parent;
+    Lit->setType(Original->getType());
+    Original->unref();
+    FoldedCount++;
+    return Lit;
+  }
+
+  Expression* ConstantFolder::foldExpression(Expression* X) {
+    switch (X->getKind()) {
+      case NodeKind::LiteralExpression:
+        return X;
+      case NodeKind::ReferenceExpression:
+      {
+        auto Ref = static_cast<ReferenceExpression*>(X);
+        auto Let = resolveLet(Ref);
+        if (Let == nullptr
+            || !Let->Params.empty()
+            || Let->Pattern->getKind() != NodeKind::BindPattern
+            || Let->Body == nullptr
+            || Let->Body->getKind() != NodeKind::LetExprBody) {
+          return X;
+        }
+        foldLet(Let);
+        auto Body = static_cast<LetExprBody*>(Let->Body)->Expression;
+        if (!isLiteral(Body)) {
+          return X;
+        }
+        Env Empty;
+        return createLiteral(X, E.evaluateExpression(Body, Empty));
+      }
+      case NodeKind::NestedExpression:
+      {
+        auto Nested = static_cast<NestedExpression*>(X);
+        Nested->Inner = foldExpression(Nested->Inner);
+        if (isLiteral(Nested->Inner)) {
+          auto Inner = Nested->Inner;
+          Inner->Parent = Nested->Parent;
+          Inner->ref();
+          Nested->unref();
+          return Inner;
+        }
+        return X;
+      }
+      case NodeKind::InfixExpression:
+      {
+        auto Infix = static_cast<InfixExpression*>(X);
+        Infix->Left = foldExpression(Infix->Left);
+        Infix->Right = foldExpression(Infix->Right);
+        if (!isLiteral(Infix->Left)
+            || !isLiteral(Infix->Right)
+            || !isBuiltinOperator(Infix)
+            || (Infix->Operator->getText() == "/" && !isNonZeroInteger(Infix->Right))) {
+          return X;
+        }
+        Env Empty;
+        return createLiteral(X, E.evaluateExpression(Infix, Empty));
+      }
+      case NodeKind::CallExpression:
+      {
+        auto Call = static_cast<CallExpression*>(X);
+        if (Call->Function->getKind() != NodeKind::ReferenceExpression) {
+          Call->Function = foldExpression(Call->Function);
+        }
+        bool AllConstant = true;
+        for (auto& Arg: Call->Args) {
+          Arg = foldExpression(Arg);
+          if (!isLiteral(Arg)) {
+            AllConstant = false;
+          }
+        }
+        if (!AllConstant || Call->Function->getKind() != NodeKind::ReferenceExpression) {
+          return X;
+        }
+        auto Let = resolveLet(static_cast<ReferenceExpression*>(Call->Function));
+        if (Let == nullptr || Let->Params.size() != Call->Args.size() || !isInlineable(Let)) {
+          return X;
+        }
+        Env Empty;
+        std::vector<Value> Args;
+        for (auto Arg: Call->Args) {
+          Args.push_back(E.evaluateExpression(Arg, Empty));
+        }
+        return createLiteral(X, E.apply(Value(Let, &Empty), Args));
+      }
+      case NodeKind::TupleExpression:
+      {
+        auto Tuple = static_cast<TupleExpression*>(X);
+        for (auto& [Element, Comma]: Tuple->Elements) {
+          Element = foldExpression(Element);
+        }
+        return X;
+      }
+      case NodeKind::MatchExpression:
+      {
+        auto Match = static_cast<MatchExpression*>(X);
+        if (Match->Value != nullptr) {
+          Match->Value = foldExpression(Match->Value);
+        }
+        for (auto Case: Match->Cases) {
+          auto Count = CaseBindings.size();
+          collectBindings(Case->Pattern, CaseBindings);
+          Case->Expression = foldExpression(Case->Expression);
+          CaseBindings.resize(Count);
+        }
+        return X;
+      }
+      default:
+        return X;
+    }
+  }
+
+  void ConstantFolder::foldLet(LetDeclaration* Let) {
+    if (!Visited.emplace(Let).second || Let->Body == nullptr) {
+      return;
+    }
+    switch (Let->Body->getKind()) {
+      case NodeKind::LetExprBody:
+      {
+        auto Body = static_cast<LetExprBody*>(Let->Body);
+        Body->Expression = foldExpression(Body->Expression);
+        break;
+      }
+      case NodeKind::LetBlockBody:
+      {
+        auto Body = static_cast<LetBlockBody*>(Let->Body);
+        for (auto Element: Body->Elements) {
+          foldNode(Element);
+        }
+        break;
+      }
+      default:
+        ZEN_UNREACHABLE
+    }
+  }
+
+  void ConstantFolder::foldNode(Node* N) {
+    switch (N->getKind()) {
+      case NodeKind::SourceFile:
+      {
+        auto SF = static_cast<SourceFile*>(N);
+        for (auto Element: SF->Elements) {
+          foldNode(Element);
+        }
+        break;
+      }
+      case NodeKind::ExpressionStatement:
+      {
+        auto Stmt = static_cast<ExpressionStatement*>(N);
+        Stmt->Expression = foldExpression(Stmt->Expression);
+        break;
+      }
+      case NodeKind::ReturnStatement:
+      {
+        auto Stmt = static_cast<ReturnStatement*>(N);
+        if (Stmt->Expression != nullptr) {
+          Stmt->Expression = foldExpression(Stmt->Expression);
+        }
+        break;
+      }
+      case NodeKind::IfStatement:
+      {
+        auto Stmt = static_cast<IfStatement*>(N);
+        for (auto Part: Stmt->Parts) {
+          if (Part->Test != nullptr) {
+            Part->Test = foldExpression(Part->Test);
+          }
+          for (auto Element: Part->Elements) {
+            foldNode(Element);
+          }
+        }
+        break;
+      }
+      case NodeKind::LetDeclaration:
+        foldLet(static_cast<LetDeclaration*>(N));
+        break;
+      default:
+        // Type declarations, classes and instances contain nothing to fold
+        break;
+    }
+  }
+
+  void ConstantFolder::fold(SourceFile* SF) {
+    foldNode(SF);
+  }
+
+}
+
@@ -3,6 +3,8 @@
 
 #include <sstream>
 #include <cmath>
+#include <algorithm>
+#include <tuple>
 
 #include "zen/config.hpp"
 
@@ -11,6 +13,7 @@
 #include "bolt/DiagnosticEngine.hpp"
 #include "bolt/Diagnostics.hpp"
 #include "bolt/ConsolePrinter.hpp"
+#include "bolt/Checker.hpp"
 
 #define ANSI_RESET "\u001b[0m"
 #define ANSI_BOLD "\u001b[1m"
@@ -41,23 +44,65 @@ namespace bolt {
   Diagnostic::Diagnostic(DiagnosticKind Kind):
     std::runtime_error("a compiler error occurred without being caught"), Kind(Kind) {}
 
-  bool sourceLocLessThan(const Diagnostic* L, const Diagnostic* R) {
-    auto N1 = L->getNode();
-    auto N2 = R->getNode();
-    if (N1 == nullptr && N2 == nullptr) {
-      return false;
+  DiagnosticLocation getLocation(const Diagnostic& D) {
+    switch (D.getKind()) {
+      case DiagnosticKind::UnexpectedString:
+      {
+        const auto& E = static_cast<const UnexpectedStringDiagnostic&>(D);
+        return { &E.File, { E.Location, E.Location + E.Actual } };
+      }
+      case DiagnosticKind::UnexpectedToken:
+      {
+        const auto& E = static_cast<const UnexpectedTokenDiagnostic&>(D);
+        return { &E.File, E.Actual->getRange() };
+      }
+      case DiagnosticKind::FieldNotFound:
+      {
+        const auto& E = static_cast<const FieldNotFoundDiagnostic&>(D);
+        return { &E.Source->getSourceFile()->getTextFile(), E.Source->getRange() };
+      }
+      default:
+      {
+        auto N = D.getNode();
+        if (N == nullptr) {
+          return { nullptr, {} };
+        }
+        return { &N->getSourceFile()->getTextFile(), N->getRange() };
+      }
     }
-    if (N1 == nullptr) {
-      return true;
-    }
-    if (N2 == nullptr) {
-      return false;
+  }
+
+  static DiagnosticSortKey getSortKey(const Diagnostic& D) {
+    auto Loc = getLocation(D);
+    if (Loc.File == nullptr) {
+      return { 0, 0, D.getCode() };
     }
-    return N1->getStartLine() < N2->getStartLine() || N1->getStartColumn() < N2->getStartColumn();
-  };
+    auto Offset = Loc.Range.Start.isEmpty() ? 0 : Loc.File->getOffset(Loc.Range.Start);
+    return { Loc.File->getId(), Offset, D.getCode() };
+  }
+
+  bool DiagnosticSortKey::operator<(const DiagnosticSortKey& Other) const {
+    return std::tie(File, Offset, Code) < std::tie(Other.File, Other.Offset, Other.Code);
+  }
+
+  static bool sortKeyLessThan(const Diagnostic* L, const Diagnostic* R) {
+    return L->SortKey < R->SortKey;
+  }
+
+  void DiagnosticStore::addDiagnostic(Diagnostic* D) {
+    D->SortKey = getSortKey(*D);
+    Diagnostics.push_back(D);
+  }
 
   void DiagnosticStore::sort() {
-    std::sort(Diagnostics.begin(), Diagnostics.end(), sourceLocLessThan);
+    std::stable_sort(Diagnostics.begin(), Diagnostics.end(), sortKeyLessThan);
+  }
+
+  void DiagnosticStore::merge(DiagnosticStore& Other) {
+    auto Middle = Diagnostics.size();
+    Diagnostics.insert(Diagnostics.end(), Other.Diagnostics.begin(), Other.Diagnostics.end());
+    std::inplace_merge(Diagnostics.begin(), Diagnostics.begin() + Middle, Diagnostics.end(), sortKeyLessThan);
+    Other.Diagnostics.clear();
   }
 
   DiagnosticStore::~DiagnosticStore() {
@@ -78,4 +123,272 @@ namespace bolt {
     delete D;
   }
 
+  void writeJSONString(ByteString& Out, ByteStringView Text) {
+    static const char* Hex = "0123456789abcdef";
+    Out.push_back('"');
+    for (auto Chr: Text) {
+      switch (Chr) {
+        case '"':
+          Out.append("\\\"");
+          break;
+        case '\\':
+          Out.append("\\\\");
+          break;
+        case '\n':
+          Out.append("\\n");
+          break;
+        case '\t':
+          Out.append("\\t");
+          break;
+        default:
+          if (static_cast<unsigned char>(Chr) < 0x20) {
+            Out.append("\\u00");
+            Out.push_back(Hex[Chr >> 4]);
+            Out.push_back(Hex[Chr & 0xf]);
+          } else {
+            Out.push_back(Chr);
+          }
+          break;
+      }
+    }
+    Out.push_back('"');
+  }
+
+  static void writeJSONKey(ByteString& Out, ByteStringView Key) {
+    Out.push_back(',');
+    writeJSONString(Out, Key);
+    Out.push_back(':');
+  }
+
+  static void writeJSONTypes(ByteString& Out, ByteStringView Key, const std::vector<ByteString>& Elements) {
+    writeJSONKey(Out, Key);
+    Out.push_back('[');
+    for (std::size_t I = 0; I < Elements.size(); I++) {
+      if (I > 0) {
+        Out.push_back(',');
+      }
+      writeJSONString(Out, Elements[I]);
+    }
+    Out.push_back(']');
+  }
+
+  /**
+   * Writes the fields that are specific to the kind of the diagnostic, each
+   * preceded by a comma.
+   */
+  static void writeDetails(ByteString& Out, const Diagnostic& D) {
+    switch (D.getKind()) {
+      case DiagnosticKind::UnexpectedString:
+      {
+        const auto& E = static_cast<const UnexpectedStringDiagnostic&>(D);
+        writeJSONKey(Out, "actual");
+        writeJSONString(Out, E.Actual);
+        break;
+      }
+      case DiagnosticKind::UnexpectedToken:
+      {
+        const auto& E = static_cast<const UnexpectedTokenDiagnostic&>(D);
+        std::vector<ByteString> Expected;
+        for (auto Kind: E.Expected) {
+          Expected.push_back(describe(Kind));
+        }
+        writeJSONTypes(Out, "expected", Expected);
+        writeJSONKey(Out, "actual");
+        writeJSONString(Out, describe(E.Actual->getKind()));
+        break;
+      }
+      case DiagnosticKind::BindingNotFound:
+      {
+        const auto& E = static_cast<const BindingNotFoundDiagnostic&>(D);
+        writeJSONKey(Out, "name");
+        writeJSONString(Out, E.Name);
+        break;
+      }
+      case DiagnosticKind::UnificationError:
+      {
+        const auto& E = static_cast<const UnificationErrorDiagnostic&>(D);
+        writeJSONKey(Out, "left");
+        writeJSONString(Out, describe(E.getLeft()));
+        writeJSONKey(Out, "right");
+        writeJSONString(Out, describe(E.getRight()));
+        writeJSONKey(Out, "fullLeft");
+        writeJSONString(Out, describe(E.OrigLeft));
+        writeJSONKey(Out, "fullRight");
+        writeJSONString(Out, describe(E.OrigRight));
+        break;
+      }
+      case DiagnosticKind::TypeclassMissing:
+      {
+        const auto& E = static_cast<const TypeclassMissingDiagnostic&>(D);
+        std::vector<ByteString> Params;
+        for (auto TV: E.Sig.Params) {
+          Params.push_back(describe(TV));
+        }
+        writeJSONKey(Out, "typeclass");
+        writeJSONString(Out, E.Sig.Id);
+        writeJSONTypes(Out, "params", Params);
+        break;
+      }
+      case DiagnosticKind::InstanceNotFound:
+      {
+        const auto& E = static_cast<const InstanceNotFoundDiagnostic&>(D);
+        writeJSONKey(Out, "typeclass");
+        writeJSONString(Out, E.TypeclassName);
+        writeJSONKey(Out, "type");
+        writeJSONString(Out, describe(E.Ty));
+        break;
+      }
+      case DiagnosticKind::TupleIndexOutOfRange:
+      {
+        const auto& E = static_cast<const TupleIndexOutOfRangeDiagnostic&>(D);
+        writeJSONKey(Out, "type");
+        writeJSONString(Out, describe(E.Tuple));
+        writeJSONKey(Out, "index");
+        Out.append(std::to_string(E.I));
+        break;
+      }
+      case DiagnosticKind::InvalidTypeToTypeclass:
+      {
+        const auto& E = static_cast<const InvalidTypeToTypeclassDiagnostic&>(D);
+        writeJSONKey(Out, "type");
+        writeJSONString(Out, describe(E.Actual));
+        writeJSONTypes(Out, "typeclasses", E.Classes);
+        break;
+      }
+      case DiagnosticKind::FieldNotFound:
+      {
+        const auto& E = static_cast<const FieldNotFoundDiagnostic&>(D);
+        writeJSONKey(Out, "field");
+        writeJSONString(Out, E.Name);
+        writeJSONKey(Out, "type");
+        writeJSONString(Out, describe(E.Ty));
+        break;
+      }
+      case DiagnosticKind::NotSupported:
+      {
+        const auto& E = static_cast<const NotSupportedDiagnostic&>(D);
+        writeJSONKey(Out, "feature");
+        writeJSONString(Out, E.Feature);
+        break;
+      }
+    }
+  }
+
+  DiagnosticMessageRenderer::DiagnosticMessageRenderer():
+    Printer(Stream) {
+      Printer.EnableColors = false;
+      Printer.PrintExcerpts = false;
+      Printer.PrintFilePosition = false;
+    }
+
+  ByteString DiagnosticMessageRenderer::getMessage(const Diagnostic& D) {
+    Stream.str("");
+    Printer.writeDiagnostic(D);
+    auto Text = Stream.str();
+    // Only keep the first line, without the "error:" prefix
+    ByteStringView Message = Text;
+    Message = Message.substr(0, Message.find('\n'));
+    if (Message.starts_with("error:")) {
+      Message.remove_prefix(6);
+    }
+    while (!Message.empty() && Message.front() == ' ') {
+      Message.remove_prefix(1);
+    }
+    return ByteString(Message);
+  }
+
+  JSONDiagnostics::JSONDiagnostics(std::ostream& Out, JSONDiagnosticsFormat Format):
+    Out(Out), Format(Format) {}
+
+  void JSONDiagnostics::writeRecord(const Diagnostic& D) {
+    auto Loc = getLocation(D);
+    Record.append("{\"code\":");
+    Record.append(std::to_string(D.getCode()));
+    writeJSONKey(Record, "severity");
+    writeJSONString(Record, "error");
+    writeJSONKey(Record, "message");
+    writeJSONString(Record, Messages.getMessage(D));
+    if (Loc.File != nullptr) {
+      writeJSONKey(Record, "file");
+      writeJSONString(Record, Loc.File->getPath());
+      writeJSONKey(Record, "range");
+      Record.append("{\"start\":{\"line\":" + std::to_string(Loc.Range.Start.Line) + ",\"column\":" + std::to_string(Loc.Range.Start.Column) + "}");
+      Record.append(",\"end\":{\"line\":" + std::to_string(Loc.Range.End.Line) + ",\"column\":" + std::to_string(Loc.Range.End.Column) + "}}");
+    }
+    writeDetails(Record, D);
+    Record.push_back('}');
+  }
+
+  void JSONDiagnostics::writeResult(const Diagnostic& D) {
+    auto Loc = getLocation(D);
+    Record.append("{\"ruleId\":");
+    writeJSONString(Record, std::to_string(D.getCode()));
+    writeJSONKey(Record, "level");
+    writeJSONString(Record, "error");
+    Record.append(",\"message\":{\"text\":");
+    writeJSONString(Record, Messages.getMessage(D));
+    Record.push_back('}');
+    if (Loc.File != nullptr) {
+      Record.append(",\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{\"uri\":");
+      writeJSONString(Record, Loc.File->getPath());
+      Record.append("},\"region\":{\"startLine\":" + std::to_string(Loc.Range.Start.Line)
+        + ",\"startColumn\":" + std::to_string(Loc.Range.Start.Column)
+        + ",\"endLine\":" + std::to_string(Loc.Range.End.Line)
+        + ",\"endColumn\":" + std::to_string(Loc.Range.End.Column) + "}}}]");
+    }
+    Record.append(",\"properties\":{\"code\":");
+    Record.append(std::to_string(D.getCode()));
+    writeDetails(Record, D);
+    Record.append("}}");
+  }
+
+  void JSONDiagnostics::start() {
+    if (HasStarted) {
+      return;
+    }
+    HasStarted = true;
+    if (Format == JSONDiagnosticsFormat::SARIF) {
+      Out << "{\"version\":\"2.1.0\",\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","
+          << "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"bolt\"}},\"results\":[";
+    }
+  }
+
+  void JSONDiagnostics::addDiagnostic(Diagnostic* D) {
+    writeDiagnostic(*D);
+    delete D;
+  }
+
+  void JSONDiagnostics::writeDiagnostic(const Diagnostic& D) {
+    Record.clear();
+    switch (Format) {
+      case JSONDiagnosticsFormat::Lines:
+        writeRecord(D);
+        Record.push_back('\n');
+        break;
+      case JSONDiagnosticsFormat::SARIF:
+        if (HasStarted) {
+          Record.push_back(',');
+        }
+        start();
+        writeResult(D);
+        break;
+    }
+    Out.write(Record.data(), Record.size());
+    Out.flush();
+  }
+
+  void JSONDiagnostics::finish() {
+    if (HasFinished || Format != JSONDiagnosticsFormat::SARIF) {
+      return;
+    }
+    HasFinished = true;
+    start();
+    Out << "]}]}\n";
+    Out.flush();
+  }
+
+  JSONDiagnostics::~JSONDiagnostics() {
+    finish();
+  }
+
 }
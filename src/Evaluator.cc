@@ -1,11 +1,135 @@
 
+#include <array>
+
 #include "zen/range.hpp"
 
 #include "bolt/CST.hpp"
+#include "bolt/Checker.hpp"
 #include "bolt/Evaluator.hpp"
 
 namespace bolt {
 
+  using UnsignedInteger = std::make_unsigned_t<Integer>;
+
+  /**
+   * The maximum amount of arguments a call can have before they are stored on
+   * the heap.
+   */
+  static constexpr std::size_t MaxInlineArgs = 8;
+
+  static Integer evaluateIntegerOp(IntegerOp Op, Integer Left, Integer Right) {
+    // Going through unsigned integers makes overflow wrap around instead of
+    // being undefined behaviour.
+    switch (Op) {
+      case IntegerOp::Add:
+        return static_cast<Integer>(static_cast<UnsignedInteger>(Left) + static_cast<UnsignedInteger>(Right));
+      case IntegerOp::Sub:
+        return static_cast<Integer>(static_cast<UnsignedInteger>(Left) - static_cast<UnsignedInteger>(Right));
+      case IntegerOp::Mul:
+        return static_cast<Integer>(static_cast<UnsignedInteger>(Left) * static_cast<UnsignedInteger>(Right));
+      case IntegerOp::Div:
+        if (Right == 0) {
+          throw RuntimeError("division by zero");
+        }
+        if (Right == -1) {
+          return static_cast<Integer>(UnsignedInteger(0) - static_cast<UnsignedInteger>(Left));
+        }
+        return Left / Right;
+      default:
+        ZEN_UNREACHABLE
+    }
+  }
+
+  IntegerOp Evaluator::getIntegerOp(InfixExpression* Infix) {
+    auto Match = IntegerOps.find(Infix);
+    if (Match != IntegerOps.end()) {
+      return Match->second;
+    }
+    auto Op = IntegerOp::None;
+    auto Text = Infix->Operator->getText();
+    // The operator might have been redefined by the user
+    if (C != nullptr
+        && Infix->getScope()->lookup({ {}, Text }) == nullptr
+        && *C->getType(Infix->Left) == *C->getIntType()
+        && *C->getType(Infix->Right) == *C->getIntType()) {
+      if (Text == "+") {
+        Op = IntegerOp::Add;
+      } else if (Text == "-") {
+        Op = IntegerOp::Sub;
+      } else if (Text == "*") {
+        Op = IntegerOp::Mul;
+      } else if (Text == "/") {
+        Op = IntegerOp::Div;
+      }
+    }
+    IntegerOps.emplace(Infix, Op);
+    return Op;
+  }
+
+  Decision* Evaluator::getDecisionTree(MatchExpression* M) {
+    auto Match = DecisionTrees.find(M);
+    if (Match != DecisionTrees.end()) {
+      return Match->second;
+    }
+    auto Tree = Compiler.compile(M);
+    if (Tree == nullptr) {
+      throw RuntimeError("the declaration of constructor '" + Compiler.getUnknownConstructor()->Name->getCanonicalText() + "' is not part of the program");
+    }
+    DecisionTrees.emplace(M, Tree);
+    return Tree;
+  }
+
+  static Value& project(Value& V, const MatchPath& Path) {
+    auto Curr = &V;
+    for (auto Index: Path) {
+      Curr = &Curr->at(Index);
+    }
+    return *Curr;
+  }
+
+  Value Evaluator::evaluateMatch(MatchExpression* M, Value& V, Env& E) {
+    auto D = getDecisionTree(M);
+    for (;;) {
+      switch (D->getKind()) {
+        case DecisionKind::Fail:
+          // The checker does not verify that a match is exhaustive
+          throw RuntimeError("no match case applies to the given value");
+        case DecisionKind::Leaf:
+        {
+          auto Leaf = static_cast<DecisionLeaf*>(D);
+          Env CaseEnv { &E };
+          for (auto& [Pattern, Path]: Leaf->Bindings) {
+            CaseEnv.add(Pattern->Name->getCanonicalText(), project(V, Path));
+          }
+          return evaluateExpression(Leaf->Case->Expression, CaseEnv);
+        }
+        case DecisionKind::Switch:
+        {
+          auto Switch = static_cast<DecisionSwitch*>(D);
+          auto& Tested = project(V, Switch->Path);
+          switch (Switch->Test) {
+            case SwitchKind::Constructor:
+              D = Switch->getCase(Tested.getTag());
+              break;
+            case SwitchKind::Literal:
+              D = Switch->getCase(
+                Tested.getKind() == ValueKind::String
+                  ? LiteralValue(Tested.asString())
+                  : LiteralValue(Tested.asInteger())
+              );
+              break;
+            case SwitchKind::Length:
+              // The evaluator has no list values, so only the cases that do
+              // not test for a list can apply.
+              D = Switch->Default;
+              break;
+          }
+          break;
+        }
+      }
+    }
+  }
+
   Value Evaluator::evaluateExpression(Expression* X, Env& E) {
     switch (X->getKind()) {
       case NodeKind::ReferenceExpression:
@@ -32,18 +156,62 @@ namespace bolt {
       {
         auto CE = static_cast<CallExpression*>(X);
         auto Op = evaluateExpression(CE->Function, E);
+        // Most calls have only a few arguments, which we keep on the stack
+        if (CE->Args.size() <= MaxInlineArgs) {
+          std::array<Value, MaxInlineArgs> Args;
+          for (std::size_t I = 0; I < CE->Args.size(); I++) {
+            Args[I] = evaluateExpression(CE->Args[I], E);
+          }
+          return apply(Op, std::span(Args.data(), CE->Args.size()));
+        }
         std::vector<Value> Args;
         for (auto Arg: CE->Args) {
           Args.push_back(evaluateExpression(Arg, E));
         }
         return apply(Op, Args);
       }
+      case NodeKind::InfixExpression:
+      {
+        auto Infix = static_cast<InfixExpression*>(X);
+        auto Op = getIntegerOp(Infix);
+        if (Op != IntegerOp::None) {
+          auto Left = evaluateExpression(Infix->Left, E).asInteger();
+          auto Right = evaluateExpression(Infix->Right, E).asInteger();
+          return evaluateIntegerOp(Op, Left, Right);
+        }
+        auto Fn = E.lookup(Infix->Operator->getText());
+        Value Args[2] { evaluateExpression(Infix->Left, E), evaluateExpression(Infix->Right, E) };
+        return apply(Fn, Args);
+      }
+      case NodeKind::NestedExpression:
+      {
+        auto NE = static_cast<NestedExpression*>(X);
+        return evaluateExpression(NE->Inner, E);
+      }
+      case NodeKind::TupleExpression:
+      {
+        auto TE = static_cast<TupleExpression*>(X);
+        std::vector<Value> Elements;
+        for (auto [Element, Comma]: TE->Elements) {
+          Elements.push_back(evaluateExpression(Element, E));
+        }
+        return Elements;
+      }
+      case NodeKind::MatchExpression:
+      {
+        auto M = static_cast<MatchExpression*>(X);
+        if (M->Value == nullptr) {
+          return Value(M, E.capture());
+        }
+        auto V = evaluateExpression(M->Value, E);
+        return evaluateMatch(M, V, E);
+      }
       default:
         ZEN_UNREACHABLE
     }
   }
 
-  void Evaluator::assignPattern(Pattern* P, Value& V, Env& E) {
+  void Evaluator::assignPattern(Pattern* P, const Value& V, Env& E) {
     switch (P->getKind()) {
       case NodeKind::BindPattern:
       {
@@ -56,14 +224,17 @@ namespace bolt {
     }
   }
 
-  Value Evaluator::apply(Value Op, std::vector<Value> Args) {
+  Value Evaluator::apply(const Value& Op, std::span<const Value> Args) {
     switch (Op.getKind()) {
       case ValueKind::SourceFunction:
       {
         auto Fn = Op.getDeclaration();
-        Env NewEnv;
-        for (auto [Param, Arg]: zen::zip(Fn->Params, Args)) {
-          assignPattern(Param->Pattern, Arg, NewEnv);
+        // The body can refer to everything that is visible where the function
+        // was declared, including the function itself
+        Env NewEnv { Op.getDeclarationEnv() };
+        ZEN_ASSERT(Fn->Params.size() == Args.size());
+        for (std::size_t I = 0; I < Args.size(); I++) {
+          assignPattern(Fn->Params[I]->Pattern, Args[I], NewEnv);
         }
         switch (Fn->Body->getKind()) {
           case NodeKind::LetExprBody:
@@ -75,8 +246,17 @@ namespace bolt {
       case ValueKind::NativeFunction:
       {
         auto Fn = Op.getBinding();
-        return Fn(Args);
+        return Fn(Ctx, Args);
+      }
+      case ValueKind::MatchFunction:
+      {
+        Env NewEnv { Op.getMatchEnv() };
+        ZEN_ASSERT(Args.size() == 1);
+        Value V = Args[0];
+        return evaluateMatch(Op.getMatchExpression(), V, NewEnv);
       }
+      case ValueKind::Constructor:
+        return Value::variant(Op.getTag(), std::vector<Value>(Args.begin(), Args.end()));
       default:
         ZEN_UNREACHABLE
     }
@@ -101,20 +281,48 @@ namespace bolt {
       case NodeKind::LetDeclaration:
       {
         auto Decl = static_cast<LetDeclaration*>(N);
-        if (Decl->isFunction()) {
-          E.add(Decl->getNameAsString(), Decl);
-        } else {
+        // Declarations such as `let x = 1` are functions according to the
+        // CST, but they are evaluated once like any other variable.
+        if (Decl->isFunction() && !Decl->Params.empty()) {
+          E.add(Decl->getNameAsString(), Value(Decl, &E));
+        } else if (Decl->Body) {
           Value V;
-          if (Decl->Body) {
-            switch (Decl->Body->getKind()) {
-              case NodeKind::LetExprBody:
-              {
-                auto Body = static_cast<LetExprBody*>(Decl->Body);
-                V = evaluateExpression(Body->Expression, E);
+          switch (Decl->Body->getKind()) {
+            case NodeKind::LetExprBody:
+            {
+              auto Body = static_cast<LetExprBody*>(Decl->Body);
+              V = evaluateExpression(Body->Expression, E);
+              break;
+            }
+            default:
+              ZEN_UNREACHABLE
+          }
+          assignPattern(Decl->Pattern, V, E);
+        }
+        break;
+      }
+      case NodeKind::VariantDeclaration:
+      {
+        auto Decl = static_cast<VariantDeclaration*>(N);
+        for (std::size_t Tag = 0; Tag < Decl->Members.size(); Tag++) {
+          auto Member = Decl->Members[Tag];
+          switch (Member->getKind()) {
+            case NodeKind::TupleVariantDeclarationMember:
+            {
+              auto TVDM = static_cast<TupleVariantDeclarationMember*>(Member);
+              if (TVDM->Elements.empty()) {
+                E.add(TVDM->Name->getCanonicalText(), Value::variant(Tag, {}));
+              } else {
+                E.add(TVDM->Name->getCanonicalText(), Value::constructor(Tag));
               }
-              default:
-                ZEN_UNREACHABLE
+              break;
             }
+            case NodeKind::RecordVariantDeclarationMember:
+              // The checker does not bind record-like members, so a checked
+              // program cannot refer to them.
+              break;
+            default:
+              ZEN_UNREACHABLE
           }
         }
         break;
@@ -124,4 +332,30 @@ namespace bolt {
     }
   }
 
+  template<IntegerOp Op>
+  static Integer builtinIntegerOp(Context& Ctx, Integer Left, Integer Right) {
+    return evaluateIntegerOp(Op, Left, Right);
+  }
+
+  static void builtinPrint(Context& Ctx, ByteStringView Text) {
+    Ctx.Out << Text << "\n";
+  }
+
+  const std::vector<Builtin>& getBuiltins() {
+    static const std::vector<Builtin> Builtins {
+      builtin<builtinPrint>("print"),
+      builtin<builtinIntegerOp<IntegerOp::Add>>("+"),
+      builtin<builtinIntegerOp<IntegerOp::Sub>>("-"),
+      builtin<builtinIntegerOp<IntegerOp::Mul>>("*"),
+      builtin<builtinIntegerOp<IntegerOp::Div>>("/"),
+    };
+    return Builtins;
+  }
+
+  void addBuiltins(Env& E) {
+    for (const auto& B: getBuiltins()) {
+      E.add(B.Name, B.Fn);
+    }
+  }
+
 }
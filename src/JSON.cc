@@ -0,0 +1,268 @@
+
+#include <cstdlib>
+
+#include "bolt/JSON.hpp"
+
+namespace bolt {
+
+  const JSONValue* JSONValue::get(ByteStringView Name) const {
+    for (auto& [Key, Value]: Members) {
+      if (Key == Name) {
+        return &Value;
+      }
+    }
+    return nullptr;
+  }
+
+  const JSONValue* JSONValue::get(std::initializer_list<ByteStringView> Path) const {
+    auto Curr = this;
+    for (auto Name: Path) {
+      Curr = Curr->get(Name);
+      if (Curr == nullptr) {
+        return nullptr;
+      }
+    }
+    return Curr;
+  }
+
+  /**
+   * The maximum depth of nested arrays and objects, so that malicious input
+   * cannot exhaust the stack.
+   */
+  static constexpr std::size_t MaxDepth = 256;
+
+  class JSONParser {
+
+    ByteStringView Text;
+    std::size_t Offset = 0;
+
+    void skipWhitespace() {
+      while (Offset < Text.size()) {
+        auto Chr = Text[Offset];
+        if (Chr != ' ' && Chr != '\t' && Chr != '\n' && Chr != '\r') {
+          break;
+        }
+        Offset++;
+      }
+    }
+
+    bool expect(ByteStringView Expected) {
+      if (Text.substr(Offset, Expected.size()) != Expected) {
+        return false;
+      }
+      Offset += Expected.size();
+      return true;
+    }
+
+    static void appendUTF8(ByteString& Out, unsigned long Code) {
+      if (Code < 0x80) {
+        Out.push_back(Code);
+      } else if (Code < 0x800) {
+        Out.push_back(0xC0 | (Code >> 6));
+        Out.push_back(0x80 | (Code & 0x3F));
+      } else if (Code < 0x10000) {
+        Out.push_back(0xE0 | (Code >> 12));
+        Out.push_back(0x80 | ((Code >> 6) & 0x3F));
+        Out.push_back(0x80 | (Code & 0x3F));
+      } else {
+        Out.push_back(0xF0 | (Code >> 18));
+        Out.push_back(0x80 | ((Code >> 12) & 0x3F));
+        Out.push_back(0x80 | ((Code >> 6) & 0x3F));
+        Out.push_back(0x80 | (Code & 0x3F));
+      }
+    }
+
+    bool parseHex4(unsigned long& Code) {
+      if (Offset + 4 > Text.size()) {
+        return false;
+      }
+      Code = 0;
+      for (std::size_t I = 0; I < 4; I++) {
+        auto Chr = Text[Offset++];
+        Code <<= 4;
+        if (Chr >= '0' && Chr <= '9') {
+          Code |= Chr - '0';
+        } else if (Chr >= 'a' && Chr <= 'f') {
+          Code |= Chr - 'a' + 10;
+        } else if (Chr >= 'A' && Chr <= 'F') {
+          Code |= Chr - 'A' + 10;
+        } else {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    bool parseString(ByteString& Out) {
+      if (!expect("\"")) {
+        return false;
+      }
+      for (;;) {
+        if (Offset >= Text.size()) {
+          return false;
+        }
+        auto Chr = Text[Offset++];
+        if (Chr == '"') {
+          return true;
+        }
+        if (Chr != '\\') {
+          Out.push_back(Chr);
+          continue;
+        }
+        if (Offset >= Text.size()) {
+          return false;
+        }
+        switch (Text[Offset++]) {
+          case '"': Out.push_back('"'); break;
+          case '\\': Out.push_back('\\'); break;
+          case '/': Out.push_back('/'); break;
+          case 'b': Out.push_back('\b'); break;
+          case 'f': Out.push_back('\f'); break;
+          case 'n': Out.push_back('\n'); break;
+          case 'r': Out.push_back('\r'); break;
+          case 't': Out.push_back('\t'); break;
+          case 'u':
+          {
+            unsigned long Code;
+            if (!parseHex4(Code)) {
+              return false;
+            }
+            // Combine UTF-16 surrogate pairs into a single code point
+            if (Code >= 0xD800 && Code < 0xDC00 && expect("\\u")) {
+              unsigned long Low;
+              if (!parseHex4(Low)) {
+                return false;
+              }
+              Code = 0x10000 + ((Code - 0xD800) << 10) + (Low - 0xDC00);
+            }
+            appendUTF8(Out, Code);
+            break;
+          }
+          default:
+            return false;
+        }
+      }
+    }
+
+    bool parseNumber(double& Out) {
+      auto Start = Offset;
+      while (Offset < Text.size()) {
+        auto Chr = Text[Offset];
+        if ((Chr < '0' || Chr > '9') && Chr != '-' && Chr != '+' && Chr != '.' && Chr != 'e' && Chr != 'E') {
+          break;
+        }
+        Offset++;
+      }
+      if (Start == Offset) {
+        return false;
+      }
+      ByteString Digits { Text.substr(Start, Offset - Start) };
+      char* End;
+      Out = std::strtod(Digits.c_str(), &End);
+      return End == Digits.c_str() + Digits.size();
+    }
+
+  public:
+
+    JSONParser(ByteStringView Text):
+      Text(Text) {}
+
+    bool parseValue(JSONValue& Out, std::size_t Depth = 0) {
+      if (Depth > MaxDepth) {
+        return false;
+      }
+      skipWhitespace();
+      if (Offset >= Text.size()) {
+        return false;
+      }
+      switch (Text[Offset]) {
+        case 'n':
+          Out.Kind = JSONKind::Null;
+          return expect("null");
+        case 't':
+          Out.Kind = JSONKind::Boolean;
+          Out.Boolean = true;
+          return expect("true");
+        case 'f':
+          Out.Kind = JSONKind::Boolean;
+          Out.Boolean = false;
+          return expect("false");
+        case '"':
+          Out.Kind = JSONKind::String;
+          return parseString(Out.String);
+        case '[':
+        {
+          Out.Kind = JSONKind::Array;
+          Offset++;
+          skipWhitespace();
+          if (expect("]")) {
+            return true;
+          }
+          for (;;) {
+            Out.Elements.emplace_back();
+            if (!parseValue(Out.Elements.back(), Depth + 1)) {
+              return false;
+            }
+            skipWhitespace();
+            if (expect("]")) {
+              return true;
+            }
+            if (!expect(",")) {
+              return false;
+            }
+          }
+        }
+        case '{':
+        {
+          Out.Kind = JSONKind::Object;
+          Offset++;
+          skipWhitespace();
+          if (expect("}")) {
+            return true;
+          }
+          for (;;) {
+            skipWhitespace();
+            ByteString Key;
+            if (!parseString(Key)) {
+              return false;
+            }
+            skipWhitespace();
+            if (!expect(":")) {
+              return false;
+            }
+            Out.Members.emplace_back(std::move(Key), JSONValue());
+            if (!parseValue(std::get<1>(Out.Members.back()), Depth + 1)) {
+              return false;
+            }
+            skipWhitespace();
+            if (expect("}")) {
+              return true;
+            }
+            if (!expect(",")) {
+              return false;
+            }
+          }
+        }
+        default:
+          Out.Kind = JSONKind::Number;
+          return parseNumber(Out.Number);
+      }
+    }
+
+    bool atEnd() {
+      skipWhitespace();
+      return Offset == Text.size();
+    }
+
+  };
+
+  std::optional<JSONValue> JSONValue::parse(ByteStringView Text) {
+    JSONParser P { Text };
+    JSONValue Out;
+    if (!P.parseValue(Out) || !P.atEnd()) {
+      return std::nullopt;
+    }
+    return Out;
+  }
+
+}
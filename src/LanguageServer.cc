@@ -0,0 +1,423 @@
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "bolt/CST.hpp"
+#include "bolt/CSTVisitor.hpp"
+#include "bolt/Scanner.hpp"
+#include "bolt/Parser.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/Diagnostics.hpp"
+#include "bolt/LanguageServer.hpp"
+
+namespace bolt {
+
+  /**
+   * JSON-RPC error codes that are used by this server.
+   */
+  static constexpr int MethodNotFound = -32601;
+  static constexpr int InvalidRequest = -32600;
+
+  LanguageServer::Document::~Document() {
+    delete C;
+    if (SF != nullptr) {
+      SF->unref();
+    }
+  }
+
+  LanguageServer::LanguageServer(const LanguageConfig& Config, std::ostream& Out):
+    Config(Config), Out(Out) {}
+
+  static ByteString getPathFromURI(ByteStringView URI) {
+    if (URI.starts_with("file://")) {
+      URI.remove_prefix(7);
+    }
+    return ByteString(URI);
+  }
+
+  static std::size_t getInteger(const JSONValue* Value) {
+    if (Value == nullptr || !Value->isNumber() || Value->asNumber() < 0) {
+      return 0;
+    }
+    return static_cast<std::size_t>(Value->asNumber());
+  }
+
+  /**
+   * Get the number of bytes of the UTF-8 sequence that starts with \p Lead.
+   *
+   * Invalid bytes are treated as a sequence of their own.
+   */
+  static std::size_t getSequenceLength(unsigned char Lead) {
+    if ((Lead & 0xE0) == 0xC0) {
+      return 2;
+    }
+    if ((Lead & 0xF0) == 0xE0) {
+      return 3;
+    }
+    if ((Lead & 0xF8) == 0xF0) {
+      return 4;
+    }
+    return 1;
+  }
+
+  /**
+   * Positions past the end of a line or the end of the file are moved back
+   * to the end of that line or file, like the protocol requires.
+   */
+  std::size_t LanguageServer::getOffset(const TextFile& File, const JSONValue& Position) const {
+    auto Line = getInteger(Position.get("line")) + 1;
+    auto Character = getInteger(Position.get("character"));
+    if (Line > File.getLineCount()) {
+      return File.getText().size();
+    }
+    auto Text = File.getText();
+    auto Start = File.getStartOffsetOfLine(Line);
+    auto End = File.getEndOffsetOfLine(Line);
+    // Do not include the line terminator
+    if (End > Start && Text[End-1] == '\n') {
+      End--;
+    }
+    if (Encoding == PositionEncoding::UTF8) {
+      return std::min(Start + Character, End);
+    }
+    auto Offset = Start;
+    for (std::size_t Units = 0; Offset < End && Units < Character;) {
+      auto Length = getSequenceLength(Text[Offset]);
+      // Characters outside of the BMP take up a surrogate pair
+      Units += Length == 4 ? 2 : 1;
+      Offset += Length;
+    }
+    return std::min(Offset, End);
+  }
+
+  void LanguageServer::writePosition(ByteString& Out, const TextFile& File, const TextLoc& Loc) const {
+    auto Character = Loc.Column - 1;
+    if (Encoding == PositionEncoding::UTF16 && Loc.Line <= File.getLineCount()) {
+      auto Text = File.getText();
+      auto Start = File.getStartOffsetOfLine(Loc.Line);
+      auto End = std::min(Start + Character, Text.size());
+      Character = 0;
+      for (auto Offset = Start; Offset < End; Offset += getSequenceLength(Text[Offset])) {
+        Character += getSequenceLength(Text[Offset]) == 4 ? 2 : 1;
+      }
+    }
+    Out.append("{\"line\":" + std::to_string(Loc.Line - 1) + ",\"character\":" + std::to_string(Character) + "}");
+  }
+
+  void LanguageServer::writeRange(ByteString& Out, const TextFile& File, const TextRange& Range) const {
+    Out.append("{\"start\":");
+    writePosition(Out, File, Range.Start);
+    Out.append(",\"end\":");
+    writePosition(Out, File, Range.End);
+    Out.push_back('}');
+  }
+
+  static void writeId(ByteString& Out, const JSONValue& Id) {
+    switch (Id.getKind()) {
+      case JSONKind::Number:
+        Out.append(std::to_string(static_cast<long long>(Id.asNumber())));
+        break;
+      case JSONKind::String:
+        writeJSONString(Out, Id.asString());
+        break;
+      default:
+        Out.append("null");
+        break;
+    }
+  }
+
+  LanguageServer::Document* LanguageServer::open(const ByteString& URI, ByteStringView Text) {
+    auto Doc = std::make_unique<Document>();
+    TextFile Empty { getPathFromURI(URI), {} };
+    Doc->SF = new SourceFile(Empty, {});
+    reparseSourceFile(Doc->SF, 0, 0, Text, Doc->ParseDiagnostics);
+    rebuild(Doc.get());
+    auto& Slot = Documents[URI];
+    Slot = std::move(Doc);
+    return Slot.get();
+  }
+
+  void LanguageServer::rebuild(Document* Doc) {
+    delete Doc->C;
+    Doc->CheckDiagnostics = std::make_unique<DiagnosticStore>();
+    Doc->C = new Checker { Config, *Doc->CheckDiagnostics };
+    Doc->C->check(Doc->SF);
+    Doc->CheckDiagnostics->sort();
+    RebuildCount++;
+  }
+
+  void LanguageServer::publishDiagnostics(const ByteString& URI, Document* Doc) {
+    ByteString Message = "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":";
+    writeJSONString(Message, URI);
+    Message.append(",\"diagnostics\":[");
+    std::vector<Diagnostic*> Diagnostics = Doc->ParseDiagnostics.Diagnostics;
+    Diagnostics.insert(Diagnostics.end(), Doc->CheckDiagnostics->Diagnostics.begin(), Doc->CheckDiagnostics->Diagnostics.end());
+    std::stable_sort(Diagnostics.begin(), Diagnostics.end(), [](auto A, auto B) {
+      return A->SortKey < B->SortKey;
+    });
+    bool First = true;
+    for (auto D: Diagnostics) {
+      auto Loc = getLocation(*D);
+      if (!First) {
+        Message.push_back(',');
+      }
+      First = false;
+      Message.append("{\"range\":");
+      if (Loc.File != nullptr) {
+        writeRange(Message, *Loc.File, Loc.Range);
+      } else {
+        Message.append("{\"start\":{\"line\":0,\"character\":0},\"end\":{\"line\":0,\"character\":0}}");
+      }
+      Message.append(",\"severity\":1,\"code\":" + std::to_string(D->getCode()) + ",\"source\":\"bolt\",\"message\":");
+      writeJSONString(Message, Messages.getMessage(*D));
+      Message.push_back('}');
+    }
+    Message.append("]}}");
+    send(Message);
+  }
+
+  static bool isBefore(const TextLoc& A, const TextLoc& B) {
+    return A.Line < B.Line || (A.Line == B.Line && A.Column < B.Column);
+  }
+
+  ByteString LanguageServer::hover(Document* Doc, const JSONValue& Position) {
+
+    if (Doc->SF == nullptr || Doc->C == nullptr) {
+      return "null";
+    }
+
+    auto& File = Doc->SF->getTextFile();
+    auto Line = getInteger(Position.get("line")) + 1;
+    if (Line > File.getLineCount()) {
+      return "null";
+    }
+    TextLoc Loc { Line, getOffset(File, Position) - File.getStartOffsetOfLine(Line) + 1 };
+
+    struct ExpressionFinder : public CSTVisitor<ExpressionFinder> {
+
+      TextLoc Loc;
+      Expression* Found = nullptr;
+
+      void visitExpression(Expression* N) {
+        auto Range = N->getRange();
+        if (isBefore(Loc, Range.Start) || !isBefore(Loc, Range.End)) {
+          return;
+        }
+        // Expressions that are nested deeper are visited later
+        Found = N;
+        visitEachChild(N);
+      }
+
+    };
+
+    ExpressionFinder F;
+    F.Loc = Loc;
+    F.visit(Doc->SF);
+    if (F.Found == nullptr) {
+      return "null";
+    }
+
+    ByteString Result = "{\"contents\":{\"kind\":\"plaintext\",\"value\":";
+    writeJSONString(Result, describe(Doc->C->getType(F.Found)));
+    Result.append("},\"range\":");
+    writeRange(Result, File, F.Found->getRange());
+    Result.push_back('}');
+    return Result;
+  }
+
+  void LanguageServer::send(const ByteString& Message) {
+    Out << "Content-Length: " << Message.size() << "\r\n\r\n" << Message;
+    Out.flush();
+  }
+
+  void LanguageServer::sendResult(const JSONValue& Id, ByteStringView Result) {
+    ByteString Message = "{\"jsonrpc\":\"2.0\",\"id\":";
+    writeId(Message, Id);
+    Message.append(",\"result\":");
+    Message.append(Result);
+    Message.push_back('}');
+    send(Message);
+  }
+
+  void LanguageServer::sendError(const JSONValue& Id, int Code, ByteStringView Text) {
+    ByteString Message = "{\"jsonrpc\":\"2.0\",\"id\":";
+    writeId(Message, Id);
+    Message.append(",\"error\":{\"code\":" + std::to_string(Code) + ",\"message\":");
+    writeJSONString(Message, Text);
+    Message.append("}}");
+    send(Message);
+  }
+
+  bool LanguageServer::handle(const JSONValue& Message) {
+
+    static const JSONValue Null;
+
+    auto MethodValue = Message.get("method");
+    auto Id = Message.get("id");
+    if (MethodValue == nullptr || !MethodValue->isString()) {
+      // Responses to requests we never send are ignored
+      if (Id != nullptr && Message.get("result") == nullptr && Message.get("error") == nullptr) {
+        sendError(*Id, InvalidRequest, "message has no method");
+      }
+      return true;
+    }
+
+    const auto& Method = MethodValue->asString();
+    auto URIValue = Message.get({ "params", "textDocument", "uri" });
+    ByteString URI = URIValue != nullptr && URIValue->isString() ? URIValue->asString() : ByteString();
+
+    if (Method == "initialize") {
+      // Counting bytes is cheaper, but UTF-16 is the only encoding that
+      // every client supports.
+      Encoding = PositionEncoding::UTF16;
+      auto Encodings = Message.get({ "params", "capabilities", "general", "positionEncodings" });
+      if (Encodings != nullptr && Encodings->isArray()) {
+        for (const auto& Element: Encodings->getElements()) {
+          if (Element.isString() && Element.asString() == "utf-8") {
+            Encoding = PositionEncoding::UTF8;
+          }
+        }
+      }
+      ByteString Result = "{\"capabilities\":{\"positionEncoding\":";
+      Result.append(Encoding == PositionEncoding::UTF8 ? "\"utf-8\"" : "\"utf-16\"");
+      Result.append(",\"textDocumentSync\":{\"openClose\":true,\"change\":2},\"hoverProvider\":true},"
+        "\"serverInfo\":{\"name\":\"bolt\"}}");
+      sendResult(Id ? *Id : Null, Result);
+      return true;
+    }
+
+    if (Method == "initialized") {
+      return true;
+    }
+
+    if (Method == "shutdown") {
+      ShutdownRequested = true;
+      sendResult(Id ? *Id : Null, "null");
+      return true;
+    }
+
+    if (Method == "exit") {
+      return false;
+    }
+
+    if (Method == "textDocument/didOpen") {
+      auto Text = Message.get({ "params", "textDocument", "text" });
+      if (Text != nullptr && Text->isString()) {
+        publishDiagnostics(URI, open(URI, Text->asString()));
+      }
+      return true;
+    }
+
+    if (Method == "textDocument/didChange") {
+      auto Match = Documents.find(URI);
+      auto Changes = Message.get({ "params", "contentChanges" });
+      if (Match == Documents.end() || Changes == nullptr || !Changes->isArray()) {
+        return true;
+      }
+      // Apply every change to the tree before checking it again, so that a
+      // batch of edits costs a single rebuild.
+      auto Doc = Match->second.get();
+      auto& File = Doc->SF->getTextFile();
+      for (const auto& Change: Changes->getElements()) {
+        auto NewText = Change.get("text");
+        if (NewText == nullptr || !NewText->isString()) {
+          continue;
+        }
+        auto Range = Change.get("range");
+        if (Range == nullptr) {
+          reparseSourceFile(Doc->SF, 0, File.getText().size(), NewText->asString(), Doc->ParseDiagnostics);
+          continue;
+        }
+        auto Start = Range->get("start");
+        auto End = Range->get("end");
+        if (Start == nullptr || End == nullptr) {
+          continue;
+        }
+        // Later changes refer to the text after the earlier ones were applied
+        auto StartOffset = getOffset(File, *Start);
+        auto EndOffset = std::max(StartOffset, getOffset(File, *End));
+        reparseSourceFile(Doc->SF, StartOffset, EndOffset, NewText->asString(), Doc->ParseDiagnostics);
+      }
+      rebuild(Doc);
+      publishDiagnostics(URI, Doc);
+      return true;
+    }
+
+    if (Method == "textDocument/didClose") {
+      Documents.erase(URI);
+      ByteString Clear = "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":";
+      writeJSONString(Clear, URI);
+      Clear.append(",\"diagnostics\":[]}}");
+      send(Clear);
+      return true;
+    }
+
+    if (Method == "textDocument/hover") {
+      auto Match = Documents.find(URI);
+      auto Position = Message.get({ "params", "position" });
+      if (Match == Documents.end() || Position == nullptr) {
+        sendResult(Id ? *Id : Null, "null");
+        return true;
+      }
+      sendResult(Id ? *Id : Null, hover(Match->second.get(), *Position));
+      return true;
+    }
+
+    // Notifications we do not know about must be ignored
+    if (Id != nullptr) {
+      sendError(*Id, MethodNotFound, "method '" + Method + "' is not supported");
+    }
+    return true;
+  }
+
+  /**
+   * Read a single message using the base protocol.
+   *
+   * \returns false if the stream ended.
+   */
+  static bool readMessage(std::istream& In, ByteString& Out) {
+    std::size_t Length = 0;
+    bool HasLength = false;
+    ByteString Header;
+    for (;;) {
+      if (!std::getline(In, Header)) {
+        return false;
+      }
+      if (!Header.empty() && Header.back() == '\r') {
+        Header.pop_back();
+      }
+      if (Header.empty()) {
+        if (HasLength) {
+          break;
+        }
+        continue;
+      }
+      static constexpr ByteStringView Prefix = "Content-Length:";
+      if (Header.starts_with(Prefix)) {
+        Length = std::strtoul(Header.c_str() + Prefix.size(), nullptr, 10);
+        HasLength = true;
+      }
+    }
+    Out.resize(Length);
+    In.read(Out.data(), Length);
+    return In.gcount() == static_cast<std::streamsize>(Length);
+  }
+
+  int LanguageServer::serve(std::istream& In) {
+    ByteString Text;
+    while (readMessage(In, Text)) {
+      auto Message = JSONValue::parse(Text);
+      if (!Message) {
+        std::cerr << "error: received a message that is not valid JSON\n";
+        continue;
+      }
+      if (!handle(*Message)) {
+        // The protocol says to exit with an error if shutdown was not requested first
+        return ShutdownRequested ? 0 : 1;
+      }
+    }
+    return ShutdownRequested ? 0 : 1;
+  }
+
+}
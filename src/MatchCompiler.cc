@@ -0,0 +1,303 @@
+
+#include "zen/config.hpp"
+
+#include "bolt/CST.hpp"
+#include "bolt/MatchCompiler.hpp"
+
+namespace bolt {
+
+  static std::size_t getArity(VariantDeclarationMember* Member) {
+    switch (Member->getKind()) {
+      case NodeKind::TupleVariantDeclarationMember:
+        return static_cast<TupleVariantDeclarationMember*>(Member)->Elements.size();
+      case NodeKind::RecordVariantDeclarationMember:
+        return static_cast<RecordVariantDeclarationMember*>(Member)->Fields.size();
+      default:
+        ZEN_UNREACHABLE
+    }
+  }
+
+  static ByteString getName(VariantDeclarationMember* Member) {
+    switch (Member->getKind()) {
+      case NodeKind::TupleVariantDeclarationMember:
+        return static_cast<TupleVariantDeclarationMember*>(Member)->Name->getCanonicalText();
+      case NodeKind::RecordVariantDeclarationMember:
+        return static_cast<RecordVariantDeclarationMember*>(Member)->Name->getCanonicalText();
+      default:
+        ZEN_UNREACHABLE
+    }
+  }
+
+  std::optional<ConstructorInfo> MatchCompiler::getConstructorInfo(NamedPattern* P) {
+    return getConstructorInfo(P, P->Name->getCanonicalText());
+  }
+
+  std::optional<ConstructorInfo> MatchCompiler::getConstructorInfo(Node* Source, const ByteString& Name) {
+    auto Decl = Source->getScope()->lookup({ {}, Name }, SymbolKind::Constructor);
+    if (Decl == nullptr) {
+      // True and False are built into the checker and have no declaration
+      if (Name == "True" || Name == "False") {
+        return ConstructorInfo { Name == "True" ? 1u : 0u, 0, 2 };
+      }
+      return {};
+    }
+    ZEN_ASSERT(Decl->getKind() == NodeKind::VariantDeclaration);
+    auto Variant = static_cast<VariantDeclaration*>(Decl);
+    for (std::size_t I = 0; I < Variant->Members.size(); I++) {
+      auto Member = Variant->Members[I];
+      if (getName(Member) == Name) {
+        return ConstructorInfo { I, getArity(Member), Variant->Members.size() };
+      }
+    }
+    ZEN_UNREACHABLE
+  }
+
+  static bool isWildcard(Pattern* P) {
+    return P == nullptr;
+  }
+
+  void MatchCompiler::normalize(Row& R, const std::vector<MatchPath>& Paths) {
+    for (std::size_t I = 0; I < R.Patterns.size(); I++) {
+      auto& P = R.Patterns[I];
+      while (P != nullptr && P->getKind() == NodeKind::NestedPattern) {
+        P = static_cast<NestedPattern*>(P)->P;
+      }
+      if (P != nullptr && P->getKind() == NodeKind::BindPattern) {
+        R.Bindings.push_back(std::make_tuple(static_cast<BindPattern*>(P), Paths[I]));
+        P = nullptr;
+      }
+    }
+  }
+
+  std::vector<MatchPath> MatchCompiler::expandPaths(const std::vector<MatchPath>& Paths, std::size_t Column, std::size_t Arity) {
+    std::vector<MatchPath> NewPaths;
+    for (std::size_t I = 0; I < Paths.size(); I++) {
+      if (I == Column) {
+        for (std::size_t J = 0; J < Arity; J++) {
+          auto Path = Paths[Column];
+          Path.push_back(J);
+          NewPaths.push_back(Path);
+        }
+      } else {
+        NewPaths.push_back(Paths[I]);
+      }
+    }
+    return NewPaths;
+  }
+
+  /**
+   * Replaces the pattern in column \p Column with the given nested patterns,
+   * padding with wildcards when fewer than \p Arity patterns were given.
+   */
+  static std::vector<Pattern*> expandRow(const std::vector<Pattern*>& Patterns, std::size_t Column, std::vector<Pattern*> Nested, std::size_t Arity) {
+    Nested.resize(Arity, nullptr);
+    std::vector<Pattern*> Out;
+    Out.insert(Out.end(), Patterns.begin(), Patterns.begin() + Column);
+    Out.insert(Out.end(), Nested.begin(), Nested.end());
+    Out.insert(Out.end(), Patterns.begin() + Column + 1, Patterns.end());
+    return Out;
+  }
+
+  static std::vector<Pattern*> getElements(const std::vector<std::tuple<Pattern*, Comma*>>& Elements) {
+    std::vector<Pattern*> Out;
+    for (auto [Element, Comma]: Elements) {
+      Out.push_back(Element);
+    }
+    return Out;
+  }
+
+  MatchCompiler::Matrix MatchCompiler::getDefaultRows(const Matrix& Rows, std::size_t Column) {
+    Matrix Out;
+    for (auto& R: Rows) {
+      if (isWildcard(R.Patterns[Column])) {
+        Out.push_back(Row { expandRow(R.Patterns, Column, {}, 0), R.Case, R.Bindings });
+      }
+    }
+    return Out;
+  }
+
+  Decision* MatchCompiler::compileConstructors(std::vector<MatchPath>& Paths, Matrix& Rows, std::size_t Column) {
+
+    // Group the rows by the constructor they test for in the given column,
+    // preserving the order in which the constructors first appear.
+    std::vector<ConstructorInfo> Seen;
+    std::unordered_map<std::size_t, Matrix> Groups;
+    for (auto& R: Rows) {
+      auto P = R.Patterns[Column];
+      if (isWildcard(P)) {
+        continue;
+      }
+      auto Info = getConstructorInfo(static_cast<NamedPattern*>(P));
+      if (!Info) {
+        if (UnknownConstructor == nullptr) {
+          UnknownConstructor = static_cast<NamedPattern*>(P);
+        }
+        return &TheFail;
+      }
+      if (!Groups.count(Info->Tag)) {
+        Seen.push_back(*Info);
+        Groups.emplace(Info->Tag, Matrix {});
+      }
+    }
+    auto Span = Seen.front().Span;
+
+    // Rows that do not test this column remain valid for every constructor, so
+    // they are copied into each group in the order they were written.
+    for (auto& R: Rows) {
+      auto P = R.Patterns[Column];
+      if (isWildcard(P)) {
+        for (auto& Info: Seen) {
+          Groups[Info.Tag].push_back(Row { expandRow(R.Patterns, Column, {}, Info.Arity), R.Case, R.Bindings });
+        }
+        continue;
+      }
+      auto NP = static_cast<NamedPattern*>(P);
+      auto Info = *getConstructorInfo(NP);
+      Groups[Info.Tag].push_back(Row { expandRow(R.Patterns, Column, NP->Patterns, Info.Arity), R.Case, R.Bindings });
+    }
+
+    Decision* Default = &TheFail;
+    if (Seen.size() < Span) {
+      Default = compile(expandPaths(Paths, Column, 0), getDefaultRows(Rows, Column));
+    }
+
+    auto Switch = create<DecisionSwitch>(SwitchKind::Constructor, Paths[Column], Default);
+    Switch->Table.resize(Span, Default);
+    for (auto& Info: Seen) {
+      Switch->Table[Info.Tag] = compile(expandPaths(Paths, Column, Info.Arity), Groups[Info.Tag]);
+    }
+    return Switch;
+  }
+
+  Decision* MatchCompiler::compileLiterals(std::vector<MatchPath>& Paths, Matrix& Rows, std::size_t Column) {
+    std::vector<LiteralValue> Seen;
+    std::unordered_map<LiteralValue, Matrix> Groups;
+    for (auto& R: Rows) {
+      auto P = R.Patterns[Column];
+      if (isWildcard(P)) {
+        continue;
+      }
+      auto Value = static_cast<LiteralPattern*>(P)->Literal->getValue();
+      if (!Groups.count(Value)) {
+        Seen.push_back(Value);
+        Groups.emplace(Value, Matrix {});
+      }
+    }
+    for (auto& R: Rows) {
+      auto P = R.Patterns[Column];
+      if (isWildcard(P)) {
+        for (auto& Value: Seen) {
+          Groups[Value].push_back(Row { expandRow(R.Patterns, Column, {}, 0), R.Case, R.Bindings });
+        }
+        continue;
+      }
+      auto Value = static_cast<LiteralPattern*>(P)->Literal->getValue();
+      Groups[Value].push_back(Row { expandRow(R.Patterns, Column, {}, 0), R.Case, R.Bindings });
+    }
+    auto NewPaths = expandPaths(Paths, Column, 0);
+    auto Switch = create<DecisionSwitch>(SwitchKind::Literal, Paths[Column], compile(NewPaths, getDefaultRows(Rows, Column)));
+    for (auto& Value: Seen) {
+      Switch->Cases.emplace(Value, compile(NewPaths, Groups[Value]));
+    }
+    return Switch;
+  }
+
+  Decision* MatchCompiler::compileLists(std::vector<MatchPath>& Paths, Matrix& Rows, std::size_t Column) {
+    std::vector<std::size_t> Seen;
+    std::unordered_map<std::size_t, Matrix> Groups;
+    for (auto& R: Rows) {
+      auto P = R.Patterns[Column];
+      if (isWildcard(P)) {
+        continue;
+      }
+      auto Length = static_cast<ListPattern*>(P)->Elements.size();
+      if (!Groups.count(Length)) {
+        Seen.push_back(Length);
+        Groups.emplace(Length, Matrix {});
+      }
+    }
+    for (auto& R: Rows) {
+      auto P = R.Patterns[Column];
+      if (isWildcard(P)) {
+        for (auto Length: Seen) {
+          Groups[Length].push_back(Row { expandRow(R.Patterns, Column, {}, Length), R.Case, R.Bindings });
+        }
+        continue;
+      }
+      auto LP = static_cast<ListPattern*>(P);
+      auto Length = LP->Elements.size();
+      Groups[Length].push_back(Row { expandRow(R.Patterns, Column, getElements(LP->Elements), Length), R.Case, R.Bindings });
+    }
+    auto Switch = create<DecisionSwitch>(SwitchKind::Length, Paths[Column], compile(expandPaths(Paths, Column, 0), getDefaultRows(Rows, Column)));
+    for (auto Length: Seen) {
+      Switch->Cases.emplace(Integer(Length), compile(expandPaths(Paths, Column, Length), Groups[Length]));
+    }
+    return Switch;
+  }
+
+  Decision* MatchCompiler::compile(std::vector<MatchPath> Paths, Matrix Rows) {
+
+    if (Rows.empty()) {
+      return &TheFail;
+    }
+
+    for (auto& R: Rows) {
+      normalize(R, Paths);
+    }
+
+    // Pick the first column the first row still has to test. If there is none,
+    // the first row matches no matter what the remaining rows say.
+    auto& First = Rows.front();
+    std::size_t Column = 0;
+    while (Column < First.Patterns.size() && isWildcard(First.Patterns[Column])) {
+      Column++;
+    }
+    if (Column == First.Patterns.size()) {
+      return create<DecisionLeaf>(First.Case, First.Bindings);
+    }
+
+    auto P = First.Patterns[Column];
+    switch (P->getKind()) {
+      case NodeKind::TuplePattern:
+      {
+        // A tuple can only have one shape, so we don't need to test anything
+        // and can directly continue with its elements.
+        auto Arity = static_cast<TuplePattern*>(P)->Elements.size();
+        Matrix NewRows;
+        for (auto& R: Rows) {
+          auto Q = R.Patterns[Column];
+          std::vector<Pattern*> Nested;
+          if (!isWildcard(Q)) {
+            ZEN_ASSERT(Q->getKind() == NodeKind::TuplePattern);
+            Nested = getElements(static_cast<TuplePattern*>(Q)->Elements);
+          }
+          NewRows.push_back(Row { expandRow(R.Patterns, Column, Nested, Arity), R.Case, R.Bindings });
+        }
+        return compile(expandPaths(Paths, Column, Arity), NewRows);
+      }
+      case NodeKind::NamedPattern:
+        return compileConstructors(Paths, Rows, Column);
+      case NodeKind::LiteralPattern:
+        return compileLiterals(Paths, Rows, Column);
+      case NodeKind::ListPattern:
+        return compileLists(Paths, Rows, Column);
+      default:
+        ZEN_UNREACHABLE
+    }
+  }
+
+  Decision* MatchCompiler::compile(MatchExpression* M) {
+    Matrix Rows;
+    for (auto Case: M->Cases) {
+      Rows.push_back(Row { { Case->Pattern }, Case, {} });
+    }
+    UnknownConstructor = nullptr;
+    auto Tree = compile({ MatchPath {} }, Rows);
+    if (UnknownConstructor != nullptr) {
+      return nullptr;
+    }
+    return Tree;
+  }
+
+}
+
@@ -0,0 +1,683 @@
+
+// A module interface is a compact binary file. All integers are written as
+// unsigned LEB128 and all strings as their length followed by their bytes.
+//
+//   interface := magic version name binding* instance*
+//   binding   := name scheme
+//   instance  := class-name scheme
+//   scheme    := var-count var* type
+//   var       := rigid-flag [name] context-count class-name*
+//   type      := kind payload
+//
+// Both lists of bindings and instances are prefixed with their length. Type
+// variables are numbered in the order they first appear in a scheme, so the
+// same declarations always produce the same bytes. Types declared by a module
+// are written together with the name of that module, which makes them refer
+// to the same type no matter through which interface they were loaded.
+
+#include <algorithm>
+
+#include "zen/config.hpp"
+
+#include "bolt/CST.hpp"
+#include "bolt/CSTVisitor.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/ModuleInterface.hpp"
+
+namespace bolt {
+
+  static constexpr ByteStringView InterfaceMagic = "BOLTI";
+  static constexpr unsigned char InterfaceVersion = 1;
+
+  /**
+   * Interfaces are read from disk and may be corrupt, so the nesting of types
+   * is limited to avoid exhausting the stack.
+   */
+  static constexpr std::size_t MaxTypeDepth = 512;
+
+  ByteString getModuleNameForPath(const std::filesystem::path& Path) {
+    return Path.stem().string();
+  }
+
+  std::vector<ByteString> getImportedModules(SourceFile* SF) {
+
+    struct Visitor : public CSTVisitor<Visitor> {
+
+      std::vector<ByteString> Modules;
+
+      void addModule(std::vector<ByteString> Names) {
+        ByteString Name;
+        for (const auto& Part: Names) {
+          if (!Name.empty()) {
+            Name.push_back('.');
+          }
+          Name.append(Part);
+        }
+        Modules.push_back(Name);
+      }
+
+      void visitReferenceExpression(ReferenceExpression* N) {
+        if (!N->ModulePath.empty()) {
+          addModule(N->getSymbolPath().Modules);
+        }
+        visitEachChild(N);
+      }
+
+      void visitReferenceTypeExpression(ReferenceTypeExpression* N) {
+        if (!N->ModulePath.empty()) {
+          addModule(N->getSymbolPath().Modules);
+        }
+        visitEachChild(N);
+      }
+
+    };
+
+    Visitor V;
+    V.visit(SF);
+    std::sort(V.Modules.begin(), V.Modules.end());
+    V.Modules.erase(std::unique(V.Modules.begin(), V.Modules.end()), V.Modules.end());
+    return V.Modules;
+  }
+
+  static void collectBindings(Pattern* P, std::vector<ByteString>& Out) {
+    switch (P->getKind()) {
+      case NodeKind::BindPattern:
+        Out.push_back(static_cast<BindPattern*>(P)->Name->getCanonicalText());
+        break;
+      case NodeKind::NamedPattern:
+        for (auto Nested: static_cast<NamedPattern*>(P)->Patterns) {
+          collectBindings(Nested, Out);
+        }
+        break;
+      case NodeKind::NestedPattern:
+        collectBindings(static_cast<NestedPattern*>(P)->P, Out);
+        break;
+      case NodeKind::TuplePattern:
+        for (auto [Element, Comma]: static_cast<TuplePattern*>(P)->Elements) {
+          collectBindings(Element, Out);
+        }
+        break;
+      case NodeKind::ListPattern:
+        for (auto [Element, Comma]: static_cast<ListPattern*>(P)->Elements) {
+          collectBindings(Element, Out);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  /**
+   * Get the names of everything \p SF makes available to other modules.
+   */
+  static std::vector<ByteString> getExportedNames(SourceFile* SF) {
+    std::vector<ByteString> Names;
+    for (auto Element: SF->Elements) {
+      switch (Element->getKind()) {
+        case NodeKind::LetDeclaration:
+        {
+          auto Let = static_cast<LetDeclaration*>(Element);
+          if (Let->PubKeyword != nullptr) {
+            collectBindings(Let->Pattern, Names);
+          }
+          break;
+        }
+        case NodeKind::RecordDeclaration:
+        {
+          auto Decl = static_cast<RecordDeclaration*>(Element);
+          if (Decl->PubKeyword != nullptr) {
+            Names.push_back(Decl->Name->getCanonicalText());
+          }
+          break;
+        }
+        case NodeKind::VariantDeclaration:
+        {
+          auto Decl = static_cast<VariantDeclaration*>(Element);
+          if (Decl->PubKeyword == nullptr) {
+            break;
+          }
+          Names.push_back(Decl->Name->getCanonicalText());
+          for (auto Member: Decl->Members) {
+            switch (Member->getKind()) {
+              case NodeKind::TupleVariantDeclarationMember:
+                Names.push_back(static_cast<TupleVariantDeclarationMember*>(Member)->Name->getCanonicalText());
+                break;
+              case NodeKind::RecordVariantDeclarationMember:
+                Names.push_back(static_cast<RecordVariantDeclarationMember*>(Member)->Name->getCanonicalText());
+                break;
+              default:
+                ZEN_UNREACHABLE
+            }
+          }
+          break;
+        }
+        case NodeKind::ClassDeclaration:
+        {
+          auto Decl = static_cast<ClassDeclaration*>(Element);
+          if (Decl->PubKeyword == nullptr) {
+            break;
+          }
+          for (auto Member: Decl->Elements) {
+            if (Member->getKind() == NodeKind::LetDeclaration) {
+              collectBindings(static_cast<LetDeclaration*>(Member)->Pattern, Names);
+            }
+          }
+          break;
+        }
+        default:
+          break;
+      }
+    }
+    return Names;
+  }
+
+  class InterfaceWriter {
+
+    Checker& C;
+    ByteStringView ModuleName;
+    ByteString& Out;
+
+    std::vector<TVar*> Vars;
+
+    void collectVars(Type* Ty) {
+      switch (Ty->getKind()) {
+        case TypeKind::Var:
+        {
+          auto TV = static_cast<TVar*>(Ty);
+          auto Found = TV->find();
+          if (Found != TV) {
+            collectVars(Found);
+          } else if (std::find(Vars.begin(), Vars.end(), TV) == Vars.end()) {
+            Vars.push_back(TV);
+          }
+          break;
+        }
+        case TypeKind::Con:
+        case TypeKind::Nil:
+        case TypeKind::Absent:
+          break;
+        case TypeKind::App:
+          collectVars(static_cast<TApp*>(Ty)->Op);
+          collectVars(static_cast<TApp*>(Ty)->Arg);
+          break;
+        case TypeKind::Arrow:
+          collectVars(static_cast<TArrow*>(Ty)->ParamType);
+          collectVars(static_cast<TArrow*>(Ty)->ReturnType);
+          break;
+        case TypeKind::Tuple:
+          for (auto Element: static_cast<TTuple*>(Ty)->ElementTypes) {
+            collectVars(Element);
+          }
+          break;
+        case TypeKind::TupleIndex:
+          collectVars(static_cast<TTupleIndex*>(Ty)->Ty);
+          break;
+        case TypeKind::Field:
+          collectVars(static_cast<TField*>(Ty)->Ty);
+          collectVars(static_cast<TField*>(Ty)->RestTy);
+          break;
+        case TypeKind::Present:
+          collectVars(static_cast<TPresent*>(Ty)->Ty);
+          break;
+      }
+    }
+
+    void writeClasses(const TypeclassContext& Classes) {
+      std::vector<ByteString> Sorted(Classes.begin(), Classes.end());
+      std::sort(Sorted.begin(), Sorted.end());
+      writeInteger(Sorted.size());
+      for (const auto& Class: Sorted) {
+        writeString(Class);
+      }
+    }
+
+    void writeType(Type* Ty) {
+      Out.push_back(static_cast<unsigned char>(Ty->getKind()));
+      switch (Ty->getKind()) {
+        case TypeKind::Var:
+        {
+          auto TV = static_cast<TVar*>(Ty);
+          auto Found = TV->find();
+          if (Found != TV) {
+            Out.pop_back();
+            writeType(Found);
+            break;
+          }
+          writeInteger(std::find(Vars.begin(), Vars.end(), TV) - Vars.begin());
+          break;
+        }
+        case TypeKind::Con:
+        {
+          auto Con = static_cast<TCon*>(Ty);
+          if (!Con->Module.empty()) {
+            writeString(Con->Module);
+          } else if (Con == C.getBoolType() || Con == C.getIntType() || Con == C.getStringType() || Con == C.getListType()) {
+            writeString("");
+          } else {
+            writeString(ModuleName);
+          }
+          writeString(Con->DisplayName);
+          break;
+        }
+        case TypeKind::App:
+          writeType(static_cast<TApp*>(Ty)->Op);
+          writeType(static_cast<TApp*>(Ty)->Arg);
+          break;
+        case TypeKind::Arrow:
+          writeType(static_cast<TArrow*>(Ty)->ParamType);
+          writeType(static_cast<TArrow*>(Ty)->ReturnType);
+          break;
+        case TypeKind::Tuple:
+        {
+          auto Tuple = static_cast<TTuple*>(Ty);
+          writeInteger(Tuple->ElementTypes.size());
+          for (auto Element: Tuple->ElementTypes) {
+            writeType(Element);
+          }
+          break;
+        }
+        case TypeKind::TupleIndex:
+          writeType(static_cast<TTupleIndex*>(Ty)->Ty);
+          writeInteger(static_cast<TTupleIndex*>(Ty)->I);
+          break;
+        case TypeKind::Field:
+        {
+          auto Field = static_cast<TField*>(Ty);
+          writeString(Field->Name);
+          writeType(Field->Ty);
+          writeType(Field->RestTy);
+          break;
+        }
+        case TypeKind::Nil:
+        case TypeKind::Absent:
+          break;
+        case TypeKind::Present:
+          writeType(static_cast<TPresent*>(Ty)->Ty);
+          break;
+      }
+    }
+
+  public:
+
+    InterfaceWriter(Checker& C, ByteStringView ModuleName, ByteString& Out):
+      C(C), ModuleName(ModuleName), Out(Out) {}
+
+    void writeInteger(std::size_t N) {
+      while (N >= 0x80) {
+        Out.push_back(static_cast<char>((N & 0x7F) | 0x80));
+        N >>= 7;
+      }
+      Out.push_back(static_cast<char>(N));
+    }
+
+    void writeString(ByteStringView Text) {
+      writeInteger(Text.size());
+      Out.append(Text);
+    }
+
+    /**
+     * Write a type, quantifying over all of the type variables in it.
+     *
+     * Top-level declarations are fully solved once a file has been checked,
+     * so any type variable that remains is polymorphic.
+     */
+    void writeScheme(Type* Ty) {
+      Ty = C.simplifyType(Ty);
+      Vars.clear();
+      collectVars(Ty);
+      writeInteger(Vars.size());
+      for (auto TV: Vars) {
+        Out.push_back(TV->isRigid() ? 1 : 0);
+        if (TV->isRigid()) {
+          writeString(static_cast<TVarRigid*>(TV)->Name);
+        }
+        writeClasses(TV->Contexts);
+      }
+      writeType(Ty);
+    }
+
+  };
+
+  void Checker::writeInterface(SourceFile* SF, ByteStringView ModuleName, ByteString& Out) {
+
+    InterfaceWriter W { *this, ModuleName, Out };
+
+    Out.append(InterfaceMagic);
+    Out.push_back(InterfaceVersion);
+    W.writeString(ModuleName);
+
+    std::vector<std::tuple<ByteString, Forall*>> Bindings;
+    for (const auto& Name: getExportedNames(SF)) {
+      auto Match = SF->Ctx->Env.find(Name);
+      if (Match != SF->Ctx->Env.end()) {
+        Bindings.push_back(std::make_tuple(Name, static_cast<Forall*>(Match->second)));
+      }
+    }
+    W.writeInteger(Bindings.size());
+    for (auto [Name, Scm]: Bindings) {
+      W.writeString(Name);
+      W.writeScheme(Scm->Type);
+    }
+
+    // Instances are always public
+    std::vector<InstanceDeclaration*> Instances;
+    for (auto Element: SF->Elements) {
+      if (Element->getKind() == NodeKind::InstanceDeclaration) {
+        auto Decl = static_cast<InstanceDeclaration*>(Element);
+        if (!Decl->TypeExps.empty()) {
+          Instances.push_back(Decl);
+        }
+      }
+    }
+    W.writeInteger(Instances.size());
+    for (auto Decl: Instances) {
+      W.writeString(Decl->Name->getCanonicalText());
+      W.writeScheme(Decl->TypeExps[0]->getType());
+    }
+  }
+
+  class InterfaceReader {
+
+    Checker& C;
+    ByteStringView Data;
+    std::size_t Offset = 0;
+
+    std::vector<TVar*> Vars;
+
+  public:
+
+    InterfaceReader(Checker& C, ByteStringView Data):
+      C(C), Data(Data) {}
+
+    bool readByte(unsigned char& Out) {
+      if (Offset >= Data.size()) {
+        return false;
+      }
+      Out = static_cast<unsigned char>(Data[Offset++]);
+      return true;
+    }
+
+    bool readInteger(std::size_t& Out) {
+      Out = 0;
+      for (unsigned Shift = 0; Shift < 64; Shift += 7) {
+        unsigned char Byte;
+        if (!readByte(Byte)) {
+          return false;
+        }
+        Out |= static_cast<std::size_t>(Byte & 0x7F) << Shift;
+        if ((Byte & 0x80) == 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool readString(ByteString& Out) {
+      std::size_t Size;
+      if (!readInteger(Size) || Size > Data.size() - Offset) {
+        return false;
+      }
+      Out = Data.substr(Offset, Size);
+      Offset += Size;
+      return true;
+    }
+
+    bool readClasses(TypeclassContext& Out) {
+      std::size_t Count;
+      if (!readInteger(Count)) {
+        return false;
+      }
+      for (std::size_t I = 0; I < Count; I++) {
+        ByteString Class;
+        if (!readString(Class)) {
+          return false;
+        }
+        Out.emplace(Class);
+      }
+      return true;
+    }
+
+    Type* getConType(const ByteString& Module, const ByteString& Name) {
+      if (Module.empty()) {
+        if (Name == "Bool") {
+          return C.BoolType;
+        }
+        if (Name == "Int") {
+          return C.IntType;
+        }
+        if (Name == "String") {
+          return C.StringType;
+        }
+        if (Name == "List") {
+          return C.ListType;
+        }
+        return nullptr;
+      }
+      auto& Ty = C.ImportedTypes[Module + "." + Name];
+      if (Ty == nullptr) {
+        Ty = new TCon(C.NextConTypeId++, Name, Module);
+      }
+      return Ty;
+    }
+
+    Type* readType(std::size_t Depth = 0) {
+      unsigned char Kind;
+      if (Depth > MaxTypeDepth || !readByte(Kind) || Kind > static_cast<unsigned char>(TypeKind::Present)) {
+        return nullptr;
+      }
+      switch (static_cast<TypeKind>(Kind)) {
+        case TypeKind::Var:
+        {
+          std::size_t I;
+          if (!readInteger(I) || I >= Vars.size()) {
+            return nullptr;
+          }
+          return Vars[I];
+        }
+        case TypeKind::Con:
+        {
+          ByteString Module;
+          ByteString Name;
+          if (!readString(Module) || !readString(Name)) {
+            return nullptr;
+          }
+          return getConType(Module, Name);
+        }
+        case TypeKind::App:
+        {
+          auto Op = readType(Depth + 1);
+          auto Arg = Op ? readType(Depth + 1) : nullptr;
+          return Arg ? new TApp(Op, Arg) : nullptr;
+        }
+        case TypeKind::Arrow:
+        {
+          auto ParamType = readType(Depth + 1);
+          auto ReturnType = ParamType ? readType(Depth + 1) : nullptr;
+          return ReturnType ? new TArrow(ParamType, ReturnType) : nullptr;
+        }
+        case TypeKind::Tuple:
+        {
+          std::size_t Count;
+          if (!readInteger(Count) || Count > Data.size() - Offset) {
+            return nullptr;
+          }
+          std::vector<Type*> Elements;
+          for (std::size_t I = 0; I < Count; I++) {
+            auto Element = readType(Depth + 1);
+            if (Element == nullptr) {
+              return nullptr;
+            }
+            Elements.push_back(Element);
+          }
+          return new TTuple(Elements);
+        }
+        case TypeKind::TupleIndex:
+        {
+          auto Ty = readType(Depth + 1);
+          std::size_t I;
+          if (Ty == nullptr || !readInteger(I)) {
+            return nullptr;
+          }
+          return new TTupleIndex(Ty, I);
+        }
+        case TypeKind::Field:
+        {
+          ByteString Name;
+          if (!readString(Name)) {
+            return nullptr;
+          }
+          auto Ty = readType(Depth + 1);
+          auto RestTy = Ty ? readType(Depth + 1) : nullptr;
+          return RestTy ? new TField(Name, Ty, RestTy) : nullptr;
+        }
+        case TypeKind::Nil:
+          return new TNil();
+        case TypeKind::Absent:
+          return new TAbsent();
+        case TypeKind::Present:
+        {
+          auto Ty = readType(Depth + 1);
+          return Ty ? new TPresent(Ty) : nullptr;
+        }
+      }
+      return nullptr;
+    }
+
+    Forall* readScheme() {
+      std::size_t Count;
+      if (!readInteger(Count) || Count > Data.size() - Offset) {
+        return nullptr;
+      }
+      Vars.clear();
+      auto TVs = new TVSet;
+      for (std::size_t I = 0; I < Count; I++) {
+        unsigned char IsRigid;
+        if (!readByte(IsRigid)) {
+          return nullptr;
+        }
+        TVar* TV;
+        if (IsRigid) {
+          ByteString Name;
+          if (!readString(Name)) {
+            return nullptr;
+          }
+          TV = new TVarRigid(C.NextTypeVarId++, Name);
+        } else {
+          TV = new TVar(C.NextTypeVarId++, VarKind::Unification);
+        }
+        if (!readClasses(TV->Contexts)) {
+          return nullptr;
+        }
+        Vars.push_back(TV);
+        TVs->emplace(TV);
+      }
+      auto Ty = readType();
+      if (Ty == nullptr) {
+        return nullptr;
+      }
+      return new Forall(TVs, new ConstraintSet, Ty);
+    }
+
+    bool read() {
+
+      if (!Data.starts_with(InterfaceMagic)) {
+        return false;
+      }
+      Offset = InterfaceMagic.size();
+      unsigned char Version;
+      ByteString ModuleName;
+      if (!readByte(Version) || Version != InterfaceVersion || !readString(ModuleName)) {
+        return false;
+      }
+
+      TypeEnv Env;
+      std::size_t BindingCount;
+      if (!readInteger(BindingCount)) {
+        return false;
+      }
+      for (std::size_t I = 0; I < BindingCount; I++) {
+        ByteString Name;
+        if (!readString(Name)) {
+          return false;
+        }
+        auto Scm = readScheme();
+        if (Scm == nullptr) {
+          return false;
+        }
+        Env.emplace(Name, Scm);
+      }
+
+      std::vector<std::tuple<ByteString, Type*>> Instances;
+      std::size_t InstanceCount;
+      if (!readInteger(InstanceCount)) {
+        return false;
+      }
+      for (std::size_t I = 0; I < InstanceCount; I++) {
+        ByteString Class;
+        if (!readString(Class)) {
+          return false;
+        }
+        auto Scm = readScheme();
+        if (Scm == nullptr) {
+          return false;
+        }
+        Instances.push_back(std::make_tuple(Class, Scm->Type));
+      }
+
+      if (Offset != Data.size()) {
+        return false;
+      }
+
+      // Only make the module visible once the entire interface was read, so
+      // that a corrupt interface leaves the checker untouched.
+      if (!C.ImportedModules.emplace(ModuleName, std::move(Env)).second) {
+        return true;
+      }
+      for (auto [Class, Ty]: Instances) {
+        C.InstanceMap[Class].push_back(Ty);
+      }
+      return true;
+    }
+
+  };
+
+  bool Checker::loadInterface(ByteStringView Data) {
+    InterfaceReader R { *this, Data };
+    return R.read();
+  }
+
+  std::uint64_t getFingerprint(ByteStringView Data, std::uint64_t Hash) {
+    // 64-bit FNV-1a
+    for (auto Chr: Data) {
+      Hash ^= static_cast<unsigned char>(Chr);
+      Hash *= 1099511628211ull;
+    }
+    return Hash;
+  }
+
+  ByteString getModuleStamp(const LanguageConfig& Config, ByteStringView Text, const std::vector<std::tuple<ByteString, ByteString>>& Imports) {
+    std::uint64_t Hash = getFingerprint({});
+    // Every part is prefixed with its length so that parts cannot run into
+    // each other
+    auto addPart = [&](ByteStringView Part) {
+      Hash = getFingerprint(std::to_string(Part.size()), Hash);
+      Hash = getFingerprint(ByteStringView { "\0", 1 }, Hash);
+      Hash = getFingerprint(Part, Hash);
+    };
+    const char Header[] = { static_cast<char>(InterfaceVersion), Config.typeVarsRequireForall() ? '1' : '0' };
+    addPart({ Header, sizeof(Header) });
+    addPart(Text);
+    for (const auto& [Name, Interface]: Imports) {
+      addPart(Name);
+      addPart(Interface);
+    }
+    static constexpr char Digits[] = "0123456789abcdef";
+    ByteString Stamp;
+    for (int Shift = 60; Shift >= 0; Shift -= 4) {
+      Stamp.push_back(Digits[(Hash >> Shift) & 0xf]);
+    }
+    Stamp.push_back('\n');
+    return Stamp;
+  }
+
+}
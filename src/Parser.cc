@@ -1,12 +1,14 @@
 
 // TODO check for memory leaks everywhere a nullptr is returned
 
+#include <algorithm>
 #include <exception>
 #include <vector>
 
 #include "llvm/Support/Casting.h"
 
 #include "bolt/CST.hpp"
+#include "bolt/CSTVisitor.hpp"
 #include "bolt/Scanner.hpp"
 #include "bolt/Parser.hpp"
 #include "bolt/Diagnostics.hpp" 
@@ -30,6 +32,10 @@
 //    it will never be stored somewhere
 //
 // 6. Maintain the invariant that a wrong parse will never advance the input stream.
+//
+// 7. skipToLineFoldEnd() holds on to the tokens it skipped. They end up in an
+//    InvalidExpression via takeSkippedTokens() or are released by
+//    discardSkippedTokens().
 
 namespace bolt {
 
@@ -876,9 +882,13 @@ finish:
     } else {
       Expression = parseExpression();
       if (!Expression) {
-        ReturnKeyword->unref();
         skipToLineFoldEnd();
-        return nullptr;
+        Expression = takeSkippedTokens();
+        if (!Expression) {
+          ReturnKeyword->unref();
+          return nullptr;
+        }
+        return new ReturnStatement(Annotations, ReturnKeyword, Expression);
       }
       checkLineFoldEnd();
     }
@@ -909,7 +919,7 @@ finish:
         Tokens.get()->unref();
         break;
       }
-      auto Element = parseLetBodyElement();
+      auto Element = recoverElement(parseLetBodyElement());
       if (Element) {
         Then.push_back(Element);
       }
@@ -941,7 +951,7 @@ finish:
           Tokens.get()->unref();
           break;
         }
-        auto Element = parseLetBodyElement();
+        auto Element = recoverElement(parseLetBodyElement());
         if (Element) {
           Alt.push_back(Element);
         }
@@ -1052,7 +1062,7 @@ after_params:
           if (T3->getKind() == NodeKind::BlockEnd) {
             break;
           }
-          auto Element = parseLetBodyElement();
+          auto Element = recoverElement(parseLetBodyElement());
           if (Element) {
             Elements.push_back(Element);
           }
@@ -1067,6 +1077,12 @@ after_params:
         auto E = parseExpression();
         if (!E) {
           skipToLineFoldEnd();
+          // The declaration is kept so that references to it can still be
+          // checked
+          auto Invalid = takeSkippedTokens();
+          if (Invalid) {
+            Body = new LetExprBody(static_cast<Equals*>(T2), Invalid);
+          }
           goto finish;
         }
         Body = new LetExprBody(static_cast<Equals*>(T2), E);
@@ -1241,7 +1257,9 @@ after_vars:
         Tokens.get()->unref();
         break;
       }
+      // Only declarations can be part of a class or instance
       auto Element = parseClassElement();
+      discardSkippedTokens();
       if (Element) {
         Elements.push_back(Element);
       }
@@ -1319,7 +1337,9 @@ after_vars:
         Tokens.get()->unref();
         break;
       }
+      // Only declarations can be part of a class or instance
       auto Element = parseClassElement();
+      discardSkippedTokens();
       if (Element) {
         Elements.push_back(Element);
       }
@@ -1370,7 +1390,7 @@ after_vars:
   RecordDeclaration* Parser::parseRecordDeclaration() {
     auto T0 = Tokens.peek();
     PubKeyword* Pub = nullptr;
-    if (T0->getKind() == NodeKind::MutKeyword) {
+    if (T0->getKind() == NodeKind::PubKeyword) {
       Tokens.get();
       Pub = static_cast<PubKeyword*>(T0);
     }
@@ -1420,7 +1440,7 @@ after_vars:
   VariantDeclaration* Parser::parseVariantDeclaration() {
     auto T0 = Tokens.peek();
     PubKeyword* Pub = nullptr;
-    if (T0->getKind() == NodeKind::MutKeyword) {
+    if (T0->getKind() == NodeKind::PubKeyword) {
       Tokens.get();
       Pub = static_cast<PubKeyword*>(T0);
     }
@@ -1541,19 +1561,27 @@ next_member:
     }
   }
 
-  SourceFile* Parser::parseSourceFile() {
+  std::vector<Node*> Parser::parseSourceElements(std::vector<TextLoc>& Starts) {
     std::vector<Node*> Elements;
     for (;;) {
       auto T0 = Tokens.peek();
       if (T0->is<EndOfFile>()) {
         break;
       }
-      auto Element = parseSourceElement();
+      auto Start = T0->getStartLoc();
+      auto Element = recoverElement(parseSourceElement());
       if (Element) {
         Elements.push_back(Element);
+        Starts.push_back(Start);
       }
     }
-    return new SourceFile(File, Elements);
+    return Elements;
+  }
+
+  SourceFile* Parser::parseSourceFile() {
+    std::vector<TextLoc> Starts;
+    auto Elements = parseSourceElements(Starts);
+    return new SourceFile(File, Elements, Starts);
   }
 
   std::vector<Annotation*> Parser::parseAnnotations() {
@@ -1612,26 +1640,54 @@ next_annotation:;
         case NodeKind::EndOfFile:
           return;
         case  NodeKind::LineFoldEnd:
-          T0->unref();
           if (Level == 0) {
+            T0->unref();
             return;
           }
+          Skipped.push_back(T0);
           break;
         case NodeKind::BlockStart:
-          T0->unref();
+          Skipped.push_back(T0);
           Level++;
           break;
         case NodeKind::BlockEnd:
-          T0->unref();
+          Skipped.push_back(T0);
           Level--;
           break;
         default:
-          T0->unref();
+          Skipped.push_back(T0);
           break;
       }
     }
   }
 
+  InvalidExpression* Parser::takeSkippedTokens() {
+    if (Skipped.empty()) {
+      return nullptr;
+    }
+    auto Invalid = new InvalidExpression(Skipped);
+    Skipped.clear();
+    return Invalid;
+  }
+
+  void Parser::discardSkippedTokens() {
+    for (auto T: Skipped) {
+      T->unref();
+    }
+    Skipped.clear();
+  }
+
+  Node* Parser::recoverElement(Node* Element) {
+    if (Element == nullptr) {
+      auto Invalid = takeSkippedTokens();
+      if (Invalid) {
+        Element = new ExpressionStatement(Invalid);
+      }
+    }
+    discardSkippedTokens();
+    return Element;
+  }
+
   void Parser::checkLineFoldEnd() {
     auto T0 = Tokens.peek();
     if (T0->getKind() == NodeKind::LineFoldEnd) {
@@ -1642,5 +1698,153 @@ next_annotation:;
     }
   }
 
+  static bool isBefore(const TextLoc& A, const TextLoc& B) {
+    return A.Line < B.Line || (A.Line == B.Line && A.Column < B.Column);
+  }
+
+  /**
+   * Check whether a line fold that starts at \p Next ends the one that starts
+   * at \p Prev, like it would when the Punctuator saw both of them.
+   */
+  static bool endsLineFold(const TextLoc* Prev, const TextLoc* Next) {
+    return Prev == nullptr || Next == nullptr || Next->Column <= Prev->Column;
+  }
+
+  std::size_t reparseSourceFile(SourceFile* SF, std::size_t StartOffset, std::size_t EndOffset, ByteStringView NewText, DiagnosticStore& DS) {
+
+    auto& File = SF->getTextFile();
+    auto& Elements = SF->Elements;
+    auto& Starts = SF->ElementStarts;
+
+    // An element owns the text from the start of its line fold up to where
+    // the next element starts, so comments, blank lines and tokens that were
+    // dropped are parsed again together with the element before them.
+    auto getOffset = [&](const TextLoc& Loc) {
+      return File.getStartOffsetOfLine(Loc.Line);
+    };
+
+    // The edit affects the elements in [First, Last). When it starts right at
+    // an element, the new text might continue the element before it.
+    auto FirstMatch = std::partition_point(Starts.begin(), Starts.end(), [&](const auto& Loc) {
+      return getOffset(Loc) < StartOffset;
+    });
+    auto LastMatch = std::partition_point(FirstMatch, Starts.end(), [&](const auto& Loc) {
+      return getOffset(Loc) <= EndOffset;
+    });
+    std::size_t First = FirstMatch - Starts.begin();
+    std::size_t Last = LastMatch - Starts.begin();
+    if (First > 0) {
+      First--;
+    }
+
+    std::size_t RegionStart = First == 0 ? 0 : getOffset(Starts[First]);
+    std::size_t RegionEnd = Last == Starts.size() ? File.getText().size() : getOffset(Starts[Last]);
+    std::size_t StartLine = First == 0 ? 1 : Starts[First].Line;
+
+    auto OldLineCount = File.getLineCount();
+    File.replace(StartOffset, EndOffset, NewText);
+    std::ptrdiff_t LineDelta = File.getLineCount() - OldLineCount;
+    std::ptrdiff_t OffsetDelta = NewText.size() - (EndOffset - StartOffset);
+    RegionEnd = RegionEnd - EndOffset + StartOffset + NewText.size();
+
+    DiagnosticStore Fresh;
+    std::vector<Node*> NewElements;
+    std::vector<TextLoc> NewStarts;
+    for (;;) {
+      ByteString Text { File.getText().substr(RegionStart, RegionEnd - RegionStart) };
+      VectorStream<ByteString, Char> Chars { Text, EOF };
+      Scanner S { Fresh, File, Chars, TextLoc { StartLine, 1 } };
+      Punctuator PT { S };
+      Parser P { File, PT, Fresh };
+      NewElements = P.parseSourceElements(NewStarts);
+      if (First == 0 && Last == Elements.size()) {
+        break;
+      }
+      auto Prev = First == 0 ? nullptr : &Starts[First-1];
+      auto Next = Last == Starts.size() ? nullptr : &Starts[Last];
+      if (!S.hasUnterminatedString()
+          && !PT.hasUnclosedBrace()
+          && endsLineFold(Prev, NewStarts.empty() ? Next : &NewStarts.front())
+          && endsLineFold(NewStarts.empty() ? Prev : &NewStarts.back(), Next)) {
+        break;
+      }
+      // The new text changes how the text around it is parsed
+      for (auto D: Fresh.Diagnostics) {
+        delete D;
+      }
+      Fresh.clear();
+      for (auto Element: NewElements) {
+        Element->unref();
+      }
+      NewStarts.clear();
+      First = 0;
+      Last = Elements.size();
+      RegionStart = 0;
+      RegionEnd = File.getText().size();
+      StartLine = 1;
+    }
+
+    // The old diagnostics still use the lines from before the edit
+    auto OldStart = TextLoc { StartLine, 1 };
+    auto OldEnd = Last == Starts.size() ? TextLoc::empty() : Starts[Last];
+    std::vector<Diagnostic*> Kept;
+    for (auto D: DS.Diagnostics) {
+      auto Loc = getLocation(*D);
+      if (Loc.File == nullptr || isBefore(Loc.Range.Start, OldStart)) {
+        Kept.push_back(D);
+      } else if (!OldEnd.isEmpty() && !isBefore(Loc.Range.Start, OldEnd)) {
+        // Diagnostics that point at tokens move together with the tokens
+        if (D->getKind() == DiagnosticKind::UnexpectedString) {
+          static_cast<UnexpectedStringDiagnostic*>(D)->Location.Line += LineDelta;
+        }
+        D->SortKey.Offset += OffsetDelta;
+        Kept.push_back(D);
+      } else {
+        delete D;
+      }
+    }
+    DS.Diagnostics = Kept;
+
+    auto Count = NewElements.size();
+    SF->replaceElements(First, Last, NewElements, NewStarts);
+
+    struct KeptElementVisitor : public CSTVisitor<KeptElementVisitor> {
+
+      std::ptrdiff_t LineDelta = 0;
+
+      void visitToken(Token* T) {
+        if (LineDelta != 0) {
+          auto Loc = T->getStartLoc();
+          Loc.Line += LineDelta;
+          T->setStartLoc(Loc);
+        }
+      }
+
+      void visitReferenceExpression(ReferenceExpression* N) {
+        // The declaration might have been replaced
+        N->forgetDeclaration();
+        visitEachChild(N);
+      }
+
+    };
+
+    KeptElementVisitor V;
+    for (std::size_t I = 0; I < Elements.size(); I++) {
+      if (I >= First && I < First + Count) {
+        continue;
+      }
+      if (I >= First + Count) {
+        V.LineDelta = LineDelta;
+        Starts[I].Line += LineDelta;
+      }
+      V.visit(Elements[I]);
+    }
+
+    Fresh.sort();
+    DS.merge(Fresh);
+
+    return Count;
+  }
+
 }
 
@@ -84,8 +84,8 @@ namespace bolt {
     { "enum", NodeKind::EnumKeyword },
   };
 
-  Scanner::Scanner(DiagnosticEngine& DE, TextFile& File, Stream<Char>& Chars):
-    DE(DE), File(File), Chars(Chars) {}
+  Scanner::Scanner(DiagnosticEngine& DE, TextFile& File, Stream<Char>& Chars, TextLoc Start):
+    DE(DE), File(File), Chars(Chars), CurrLoc(Start) {}
 
   std::string Scanner::scanIdentifier() {
     auto Loc = getCurrentLoc();
@@ -328,6 +328,10 @@ digit_finish:
             switch (C1) {
               case '"':
                 goto after_string_contents;
+              case EOF:
+                UnterminatedString = true;
+                DE.add<UnexpectedStringDiagnostic>(File, StartLoc, String { '"' });
+                return nullptr;
               case '\\':
                 Escaping = true;
                 break;
@@ -417,6 +421,7 @@ after_string_contents:
     for (;;) {
       auto T0 = readNullable();
       if (T0) {
+        TokenCount++;
         // EndOFFile is guaranteed to be produced, so that ends the stream.
         return T0;
       }
@@ -446,6 +451,7 @@ after_string_contents:
         Frames.pop();
         switch (Frame) {
           case FrameType::Fallthrough:
+            UnclosedBrace = true;
             break;
           case FrameType::Block:
             return new BlockEnd(T0->getStartLoc());
@@ -0,0 +1,263 @@
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+#include "bolt/CST.hpp"
+#include "bolt/Scanner.hpp"
+#include "bolt/Parser.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/Server.hpp"
+
+namespace bolt {
+
+  CompileServer::CachedFile::~CachedFile() {
+    delete C;
+    if (SF != nullptr) {
+      SF->unref();
+    }
+  }
+
+  CompileServer::CompileServer(const LanguageConfig& Config):
+    Config(Config) {}
+
+  static bool readText(const ByteString& Path, ByteString& Out) {
+    std::ifstream File(Path, std::ios::binary);
+    if (!File) {
+      return false;
+    }
+    Out.assign(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+    return true;
+  }
+
+  CompileServer::CachedFile* CompileServer::update(const ByteString& Path) {
+
+    std::error_code EC;
+    auto ModifiedTime = std::filesystem::last_write_time(Path, EC);
+    if (EC) {
+      return nullptr;
+    }
+
+    auto& Slot = Files[Path];
+    if (Slot && !Slot->IsStale && Slot->ModifiedTime == ModifiedTime) {
+      return Slot.get();
+    }
+
+    ByteString Text;
+    if (!readText(Path, Text)) {
+      return nullptr;
+    }
+
+    // Editors often write a file without changing it
+    if (Slot && Slot->File->getText() == Text) {
+      Slot->ModifiedTime = ModifiedTime;
+      Slot->IsStale = false;
+      return Slot.get();
+    }
+
+    auto File = std::make_unique<CachedFile>();
+    File->File = std::make_unique<TextFile>(Path, Text);
+    File->ModifiedTime = ModifiedTime;
+
+    VectorStream<ByteString, Char> Chars { Text, EOF };
+    Scanner S { File->Diagnostics, *File->File, Chars };
+    Punctuator PT { S };
+    Parser P { *File->File, PT, File->Diagnostics };
+    File->SF = P.parseSourceFile();
+    if (File->SF != nullptr) {
+      File->SF->setParents();
+      File->C = new Checker { Config, File->Diagnostics };
+      File->C->check(File->SF);
+    }
+    File->Diagnostics.sort();
+
+    RebuildCount++;
+    Slot = std::move(File);
+    return Slot.get();
+  }
+
+  void CompileServer::writeStatus(std::ostream& Out, ByteStringView Status, ByteStringView Extra) {
+    ByteString Record = "{\"status\":";
+    writeJSONString(Record, Status);
+    Record.append(Extra);
+    Record.append("}\n");
+    Out.write(Record.data(), Record.size());
+    Out.flush();
+  }
+
+  bool CompileServer::handle(ByteStringView Request, std::ostream& Out) {
+
+    std::istringstream In { ByteString(Request) };
+    ByteString Command;
+    In >> Command;
+    std::vector<ByteString> Paths;
+    for (ByteString Path; In >> Path;) {
+      Paths.push_back(Path);
+    }
+
+    if (Command == "check") {
+      auto Start = std::chrono::steady_clock::now();
+      auto OldRebuildCount = RebuildCount;
+      JSONDiagnostics Writer { Out };
+      ByteString Missing;
+      for (const auto& Path: Paths) {
+        auto File = update(Path);
+        if (File == nullptr) {
+          if (!Missing.empty()) {
+            Missing.push_back(',');
+          }
+          writeJSONString(Missing, Path);
+          continue;
+        }
+        for (auto D: File->Diagnostics.Diagnostics) {
+          Writer.writeDiagnostic(*D);
+        }
+      }
+      auto Elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+      ByteString Extra = ",\"files\":" + std::to_string(Paths.size())
+        + ",\"rebuilt\":" + std::to_string(RebuildCount - OldRebuildCount)
+        + ",\"milliseconds\":" + std::to_string(Elapsed);
+      if (!Missing.empty()) {
+        Extra.append(",\"missing\":[" + Missing + "]");
+      }
+      writeStatus(Out, Missing.empty() ? "ok" : "error", Extra);
+      return true;
+    }
+
+    if (Command == "changed") {
+      for (const auto& Path: Paths) {
+        auto Match = Files.find(Path);
+        if (Match != Files.end()) {
+          Match->second->IsStale = true;
+        }
+      }
+      writeStatus(Out, "ok");
+      return true;
+    }
+
+    if (Command == "forget") {
+      for (const auto& Path: Paths) {
+        Files.erase(Path);
+      }
+      writeStatus(Out, "ok");
+      return true;
+    }
+
+    if (Command == "shutdown") {
+      writeStatus(Out, "ok");
+      return false;
+    }
+
+    ByteString Extra = ",\"message\":";
+    writeJSONString(Extra, "unknown request '" + Command + "'");
+    writeStatus(Out, "error", Extra);
+    return true;
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+
+  static bool sendAll(int Socket, const ByteString& Data) {
+#if defined(MSG_NOSIGNAL)
+    const int Flags = MSG_NOSIGNAL;
+#else
+    const int Flags = 0;
+#endif
+    std::size_t Sent = 0;
+    while (Sent < Data.size()) {
+      auto Count = send(Socket, Data.data() + Sent, Data.size() - Sent, Flags);
+      if (Count <= 0) {
+        return false;
+      }
+      Sent += Count;
+    }
+    return true;
+  }
+
+  int CompileServer::serve(const std::string& SocketPath) {
+
+    sockaddr_un Address {};
+    if (SocketPath.size() >= sizeof(Address.sun_path)) {
+      std::cerr << "error: socket path '" << SocketPath << "' is too long\n";
+      return 1;
+    }
+    Address.sun_family = AF_UNIX;
+    std::memcpy(Address.sun_path, SocketPath.c_str(), SocketPath.size() + 1);
+
+    auto Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (Listener < 0) {
+      std::cerr << "error: could not create a socket: " << std::strerror(errno) << "\n";
+      return 1;
+    }
+
+    // A previous server that crashed may have left its socket behind
+    unlink(SocketPath.c_str());
+
+    if (bind(Listener, reinterpret_cast<sockaddr*>(&Address), sizeof(Address)) != 0
+        || listen(Listener, 8) != 0) {
+      std::cerr << "error: could not listen on '" << SocketPath << "': " << std::strerror(errno) << "\n";
+      close(Listener);
+      return 1;
+    }
+
+    std::cerr << "listening on " << SocketPath << std::endl;
+
+    bool Running = true;
+    while (Running) {
+      auto Client = accept(Listener, nullptr, nullptr);
+      if (Client < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        break;
+      }
+      ByteString Pending;
+      char Buffer[4096];
+      while (Running) {
+        auto Count = read(Client, Buffer, sizeof(Buffer));
+        if (Count <= 0) {
+          break;
+        }
+        Pending.append(Buffer, Count);
+        std::size_t LineStart = 0;
+        for (;;) {
+          auto LineEnd = Pending.find('\n', LineStart);
+          if (LineEnd == ByteString::npos) {
+            break;
+          }
+          std::ostringstream Response;
+          Running = handle(ByteStringView(Pending).substr(LineStart, LineEnd - LineStart), Response);
+          LineStart = LineEnd + 1;
+          if (!sendAll(Client, Response.str()) || !Running) {
+            break;
+          }
+        }
+        Pending.erase(0, LineStart);
+      }
+      close(Client);
+    }
+
+    close(Listener);
+    unlink(SocketPath.c_str());
+    return 0;
+  }
+
+#else
+
+  int CompileServer::serve(const std::string& SocketPath) {
+    std::cerr << "error: the compile server is not supported on this platform\n";
+    return 1;
+  }
+
+#endif
+
+}
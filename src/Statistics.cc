@@ -0,0 +1,121 @@
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <iomanip>
+
+#include "bolt/Statistics.hpp"
+
+namespace bolt {
+
+  void Statistics::addTime(ByteStringView Name, Clock::duration Duration) {
+    for (auto& [TimerName, Total]: Timers) {
+      if (TimerName == Name) {
+        Total += Duration;
+        return;
+      }
+    }
+    Timers.push_back(std::make_tuple(ByteString(Name), Duration));
+  }
+
+  void Statistics::addCount(ByteStringView Name, std::size_t Count) {
+    for (auto& [CounterName, Total]: Counters) {
+      if (CounterName == Name) {
+        Total += Count;
+        return;
+      }
+    }
+    Counters.push_back(std::make_tuple(ByteString(Name), Count));
+  }
+
+  std::size_t Statistics::getCount(ByteStringView Name) const {
+    for (auto& [CounterName, Total]: Counters) {
+      if (CounterName == Name) {
+        return Total;
+      }
+    }
+    return 0;
+  }
+
+  Statistics::Clock::duration Statistics::getTime(ByteStringView Name) const {
+    for (auto& [TimerName, Total]: Timers) {
+      if (TimerName == Name) {
+        return Total;
+      }
+    }
+    return Clock::duration::zero();
+  }
+
+  static double toSeconds(Statistics::Clock::duration Duration) {
+    return std::chrono::duration<double>(Duration).count();
+  }
+
+  void Statistics::writeTimers(std::ostream& Out) const {
+    Clock::duration Total = Clock::duration::zero();
+    Out << "===- Time per pass -===\n";
+    for (auto& [Name, Duration]: Timers) {
+      Out << std::fixed << std::setprecision(4) << std::setw(10) << toSeconds(Duration) << "s  " << Name << "\n";
+      Total += Duration;
+    }
+    Out << std::fixed << std::setprecision(4) << std::setw(10) << toSeconds(Total) << "s  total\n";
+    Out.flush();
+  }
+
+  void Statistics::writeCounters(std::ostream& Out) const {
+    Out << "===- Statistics -===\n";
+    for (auto& [Name, Count]: Counters) {
+      Out << std::setw(10) << Count << "  " << Name << "\n";
+    }
+    Out.flush();
+  }
+
+  void Statistics::writeJSON(std::ostream& Out, bool IncludeTimers, bool IncludeCounters) const {
+    // Names are chosen by the compiler itself and never need escaping
+    Out << "{";
+    if (IncludeTimers) {
+      Out << "\"timers\":{";
+      bool First = true;
+      for (auto& [Name, Duration]: Timers) {
+        if (First) First = false;
+        else Out << ",";
+        Out << "\"" << Name << "\":" << std::fixed << std::setprecision(6) << toSeconds(Duration);
+      }
+      Out << "}";
+    }
+    if (IncludeCounters) {
+      if (IncludeTimers) {
+        Out << ",";
+      }
+      Out << "\"counters\":{";
+      bool First = true;
+      for (auto& [Name, Count]: Counters) {
+        if (First) First = false;
+        else Out << ",";
+        Out << "\"" << Name << "\":" << Count;
+      }
+      Out << "}";
+    }
+    Out << "}\n";
+    Out.flush();
+  }
+
+  std::size_t getPeakMemoryUsage() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage Usage;
+    if (getrusage(RUSAGE_SELF, &Usage) != 0) {
+      return 0;
+    }
+#if defined(__APPLE__)
+    // macOS reports the size in bytes instead of kilobytes
+    return Usage.ru_maxrss / 1024;
+#else
+    return Usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+  }
+
+}
+
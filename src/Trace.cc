@@ -0,0 +1,94 @@
+
+#include "zen/config.hpp"
+
+#include "bolt/CST.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/Trace.hpp"
+
+namespace bolt {
+
+  TraceWriter::TraceWriter(std::ostream& Out):
+    Out(Out), Origin(Clock::now()) {
+      Out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    }
+
+  static void writeMicroseconds(ByteString& Out, TraceWriter::Clock::duration Duration) {
+    auto Micros = std::chrono::duration_cast<std::chrono::nanoseconds>(Duration).count();
+    Out.append(std::to_string(Micros / 1000));
+    Out.push_back('.');
+    auto Fraction = std::to_string(Micros % 1000);
+    Out.append(3 - Fraction.size(), '0');
+    Out.append(Fraction);
+  }
+
+  void TraceWriter::addEvent(
+    ByteStringView Name,
+    ByteStringView Category,
+    Clock::time_point Start,
+    Clock::time_point End,
+    const std::vector<std::tuple<ByteString, ByteString>>& Args
+  ) {
+    std::lock_guard Lock { Mutex };
+    ZEN_ASSERT(!HasFinished);
+    auto ThreadId = ThreadIds.emplace(std::this_thread::get_id(), ThreadIds.size() + 1).first->second;
+    Buffer.clear();
+    Buffer.append(HasEvents ? ",\n" : "\n");
+    Buffer.append("{\"name\":");
+    writeJSONString(Buffer, Name);
+    Buffer.append(",\"cat\":");
+    writeJSONString(Buffer, Category);
+    Buffer.append(",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(ThreadId) + ",\"ts\":");
+    writeMicroseconds(Buffer, Start - Origin);
+    Buffer.append(",\"dur\":");
+    writeMicroseconds(Buffer, End - Start);
+    if (!Args.empty()) {
+      Buffer.append(",\"args\":{");
+      bool First = true;
+      for (auto& [Key, Value]: Args) {
+        if (First) First = false;
+        else Buffer.push_back(',');
+        writeJSONString(Buffer, Key);
+        Buffer.push_back(':');
+        writeJSONString(Buffer, Value);
+      }
+      Buffer.push_back('}');
+    }
+    Buffer.push_back('}');
+    Out.write(Buffer.data(), Buffer.size());
+    HasEvents = true;
+  }
+
+  void TraceWriter::finish() {
+    std::lock_guard Lock { Mutex };
+    if (HasFinished) {
+      return;
+    }
+    Out << "\n]}\n";
+    Out.flush();
+    HasFinished = true;
+  }
+
+  TraceWriter::~TraceWriter() {
+    finish();
+  }
+
+  void TraceEvent::addArg(ByteStringView Key, ByteStringView Value) {
+    if (W != nullptr) {
+      Args.push_back(std::make_tuple(ByteString(Key), ByteString(Value)));
+    }
+  }
+
+  static ByteString describeRange(const TextRange& Range) {
+    return std::to_string(Range.Start.Line) + ":" + std::to_string(Range.Start.Column)
+      + "-" + std::to_string(Range.End.Line) + ":" + std::to_string(Range.End.Column);
+  }
+
+  void TraceEvent::addSourceRange(Node* N) {
+    if (W == nullptr) {
+      return;
+    }
+    addArg("file", N->getSourceFile()->getTextFile().getPath());
+    addArg("range", describeRange(N->getRange()));
+  }
+
+}
@@ -0,0 +1,161 @@
+
+#include <string>
+
+#include "bolt/Workload.hpp"
+
+namespace bolt {
+
+  class WorkloadWriter {
+
+    ByteString& Out;
+    ByteString Suffix;
+
+    void writeIndent(std::size_t Level) {
+      Out.append(Level * 2, ' ');
+    }
+
+  public:
+
+    WorkloadWriter(ByteString& Out, std::size_t Repetition):
+      Out(Out), Suffix(std::to_string(Repetition)) {}
+
+    void writeFunctions(std::size_t Count) {
+      for (std::size_t I = 0; I < Count; I++) {
+        auto Name = "f" + Suffix + "_" + std::to_string(I);
+        auto Var = "v" + Suffix + "_" + std::to_string(I);
+        Out.append("let " + Name + " x : Int -> Int = (x * 3) + (x - " + std::to_string(I) + ")\n");
+        if (I == 0) {
+          Out.append("let " + Var + " = " + Name + " 1\n");
+        } else {
+          Out.append("let " + Var + " = " + Name + " v" + Suffix + "_" + std::to_string(I - 1) + "\n");
+        }
+      }
+    }
+
+    void writeNestedLets(std::size_t Depth) {
+      if (Depth == 0) {
+        return;
+      }
+      for (std::size_t I = 0; I < Depth; I++) {
+        writeIndent(I);
+        Out.append("let n" + Suffix + "_" + std::to_string(I) + " x" + std::to_string(I) + ".\n");
+      }
+      writeIndent(Depth);
+      Out.append("return x" + std::to_string(Depth - 1) + " + x0\n");
+      for (std::size_t I = Depth - 1; I > 0; I--) {
+        writeIndent(I);
+        Out.append("return n" + Suffix + "_" + std::to_string(I) + " (x" + std::to_string(I - 1) + " + 1)\n");
+      }
+      Out.append("let nr" + Suffix + " = n" + Suffix + "_0 1\n");
+    }
+
+    void writeCycle(std::size_t Length) {
+      if (Length == 0) {
+        return;
+      }
+      for (std::size_t I = 0; I < Length; I++) {
+        Out.append("let c" + Suffix + "_" + std::to_string(I) + " n = match n.\n");
+        Out.append("  0 => " + std::to_string(I) + "\n");
+        Out.append("  _ => c" + Suffix + "_" + std::to_string((I + 1) % Length) + " (n - 1)\n");
+      }
+      Out.append("let cr" + Suffix + " = c" + Suffix + "_0 10\n");
+    }
+
+    void writeRecursions(std::size_t Count) {
+      for (std::size_t I = 0; I < Count; I++) {
+        auto Index = Suffix + "_" + std::to_string(I);
+        Out.append("let h" + Index + " x : Int -> Int = x + " + std::to_string(I) + "\n");
+        Out.append("let d" + Index + " n : Int -> Int = match n.\n");
+        Out.append("  0 => 1\n");
+        Out.append("  _ => h" + Index + " (d" + Index + " (n - 1)) * 2\n");
+        Out.append("let dr" + Index + " = d" + Index + " 10\n");
+      }
+    }
+
+    void writeRecord(std::size_t Width) {
+      if (Width == 0) {
+        return;
+      }
+      auto Var = "r" + Suffix;
+      Out.append("struct R" + Suffix + ".\n");
+      for (std::size_t I = 0; I < Width; I++) {
+        Out.append("  f" + std::to_string(I) + " : Int\n");
+      }
+      Out.append("let " + Var + " = {");
+      for (std::size_t I = 0; I < Width; I++) {
+        Out.append(I == 0 ? " " : ", ");
+        Out.append("f" + std::to_string(I) + " = " + std::to_string(I));
+      }
+      Out.append(" }\n");
+      for (std::size_t I = 0; I < Width; I++) {
+        Out.append("let g" + Suffix + "_" + std::to_string(I) + " = " + Var + ".f" + std::to_string(I) + " + 1\n");
+      }
+    }
+
+    void writeMatch(std::size_t Cases) {
+      if (Cases == 0) {
+        return;
+      }
+      Out.append("let m" + Suffix + " n = match n.\n");
+      for (std::size_t I = 0; I < Cases; I++) {
+        Out.append("  " + std::to_string(I) + " => n * " + std::to_string(I) + "\n");
+      }
+      Out.append("  _ => 0\n");
+      Out.append("let mr" + Suffix + " = m" + Suffix + " 3\n");
+    }
+
+    void writeClassUses(std::size_t Count) {
+      if (Count == 0) {
+        return;
+      }
+      auto Class = "Show" + Suffix;
+      auto Method = "show" + Suffix;
+      Out.append("class " + Class + " a.\n");
+      Out.append("  let " + Method + " : a -> String\n");
+      Out.append("instance " + Class + " Int.\n");
+      Out.append("  let " + Method + " x = \"an integer\"\n");
+      Out.append("instance " + Class + " Bool.\n");
+      Out.append("  let " + Method + " x = \"a boolean\"\n");
+      Out.append("instance " + Class + " String.\n");
+      Out.append("  let " + Method + " x = x\n");
+      Out.append("let describe" + Suffix + " x : (" + Class + " a) => a -> String = " + Method + " x\n");
+      static const char* Args[] = { "1", "True", "\"a string\"" };
+      for (std::size_t I = 0; I < Count; I++) {
+        Out.append("let s" + Suffix + "_" + std::to_string(I) + " = describe" + Suffix + " " + Args[I % 3] + "\n");
+      }
+    }
+
+    void writeTuples(std::size_t Count) {
+      for (std::size_t I = 0; I < Count; I++) {
+        auto Index = Suffix + "_" + std::to_string(I);
+        Out.append("let t" + Index + " x y = (x, y, (x, (y, x)))\n");
+        Out.append("let u" + Index + " = t" + Index + " 1 \"a\"\n");
+        Out.append("let e" + Index + " = u" + Index + " == t" + Index + " 2 \"b\"\n");
+      }
+    }
+
+  };
+
+  ByteString generateWorkload(const WorkloadOptions& Options) {
+    ByteString Out;
+    Out.reserve(Options.MinSize + 128);
+    for (std::size_t I = 0; I < Options.Repeat || Out.size() < Options.MinSize; I++) {
+      auto Size = Out.size();
+      WorkloadWriter W { Out, I };
+      W.writeFunctions(Options.Functions);
+      W.writeNestedLets(Options.LetDepth);
+      W.writeCycle(Options.CycleLength);
+      W.writeRecursions(Options.Recursions);
+      W.writeRecord(Options.RecordWidth);
+      W.writeMatch(Options.MatchCases);
+      W.writeClassUses(Options.ClassUses);
+      W.writeTuples(Options.Tuples);
+      if (Out.size() == Size) {
+        // Nothing was requested, so the program would never grow
+        break;
+      }
+    }
+    return Out;
+  }
+
+}
@@ -0,0 +1,68 @@
+
+#include <iostream>
+#include <string>
+
+#include "zen/po.hpp"
+
+#include "bolt/Workload.hpp"
+
+using namespace bolt;
+
+namespace po = zen::po;
+
+int main(int Argc, const char* Argv[]) {
+
+  auto Match = po::program("boltgen", "Generate Bolt programs for measuring how the compiler scales")
+    .flag(po::flag<std::string>("functions", "How many small integer functions to generate"))
+    .flag(po::flag<std::string>("let-depth", "How deep to nest function declarations"))
+    .flag(po::flag<std::string>("cycle-length", "How many functions call each other in a cycle"))
+    .flag(po::flag<std::string>("recursions", "How many recursive functions that call a helper to generate"))
+    .flag(po::flag<std::string>("record-width", "How many fields the generated record has"))
+    .flag(po::flag<std::string>("match-cases", "How many cases the generated match-expression has"))
+    .flag(po::flag<std::string>("class-uses", "How many times a function that is constrained by a type class is applied"))
+    .flag(po::flag<std::string>("tuples", "How many polymorphic functions that build tuples to generate"))
+    .flag(po::flag<std::string>("repeat", "How many times to generate all of the above (default 1)"))
+    .flag(po::flag<std::string>("size", "Keep repeating until the program is at least this many bytes long"))
+    .parse_args(Argc, Argv)
+    .unwrap();
+
+  WorkloadOptions Options;
+
+  struct {
+    const char* Name;
+    std::size_t& Value;
+  } Flags[] = {
+    { "functions", Options.Functions },
+    { "let-depth", Options.LetDepth },
+    { "cycle-length", Options.CycleLength },
+    { "recursions", Options.Recursions },
+    { "record-width", Options.RecordWidth },
+    { "match-cases", Options.MatchCases },
+    { "class-uses", Options.ClassUses },
+    { "tuples", Options.Tuples },
+    { "repeat", Options.Repeat },
+    { "size", Options.MinSize },
+  };
+
+  for (auto& [Name, Value]: Flags) {
+    if (!Match.has_flag(Name)) {
+      continue;
+    }
+    auto Text = Match.get_flag<std::string>(Name);
+    std::size_t End = 0;
+    try {
+      Value = std::stoull(Text, &End);
+    } catch (const std::exception&) {
+      End = 0;
+    }
+    if (End == 0 || End != Text.size()) {
+      std::cerr << "error: --" << Name << " expects a number but got '" << Text << "'\n";
+      return 1;
+    }
+  }
+
+  auto Program = generateWorkload(Options);
+  std::cout.write(Program.data(), Program.size());
+
+  return 0;
+}
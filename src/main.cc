@@ -1,10 +1,19 @@
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <iostream>
 #include <fstream>
+#include <filesystem>
+#include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 
 #include "zen/config.hpp"
 #include "zen/po.hpp"
@@ -18,6 +27,15 @@
 #include "bolt/Parser.hpp"
 #include "bolt/Checker.hpp"
 #include "bolt/Evaluator.hpp"
+#include "bolt/CEmitter.hpp"
+#include "bolt/ConstantFolder.hpp"
+#include "bolt/Statistics.hpp"
+#include "bolt/Trace.hpp"
+#include "bolt/Server.hpp"
+#include "bolt/LanguageServer.hpp"
+#include "bolt/ModuleInterface.hpp"
+#include "bolt/Support/Graph.hpp"
+#include "bolt/Support/Scheduler.hpp"
 
 using namespace bolt;
 
@@ -44,17 +62,457 @@ ByteString readFile(std::string Path) {
 
 namespace po = zen::po;
 
+struct AssertVisitor : public CSTVisitor<AssertVisitor> {
+
+  Checker& C;
+  DiagnosticEngine& DE;
+  std::ostream& Log;
+
+  AssertVisitor(Checker& C, DiagnosticEngine& DE, std::ostream& Log):
+    C(C), DE(DE), Log(Log) {}
+
+  // Only used to find out whether the node is an expression; walk() takes
+  // care of the children.
+  bool enterNode(Node* N) {
+    visit(N);
+    return true;
+  }
+
+  void visitNode(Node* N) {
+  }
+
+  void visitExpression(Expression* N) {
+    for (auto A: N->Annotations) {
+      if (A->getKind() == NodeKind::TypeAssertAnnotation) {
+        auto Left = C.getType(N);
+        auto Right = static_cast<TypeAssertAnnotation*>(A)->getTypeExpression()->getType();
+        Log << "verify " << describe(Left) << " == " << describe(Right) << std::endl;
+        if (*Left != *Right) {
+          DE.add<UnificationErrorDiagnostic>(Left, Right, TypePath(), TypePath(), A);
+        }
+      }
+    }
+  }
+
+};
+
+struct ExpectDiagnosticVisitor : public CSTVisitor<ExpectDiagnosticVisitor> {
+
+  std::multimap<std::size_t, unsigned> Expected;
+
+  bool enterNode(Node* N) {
+    visit(N);
+    return N->getKind() != NodeKind::ExpressionAnnotation;
+  }
+
+  void visitNode(Node* N) {
+  }
+
+  void visitExpressionAnnotation(ExpressionAnnotation* N) {
+    if (N->getExpression()->is<CallExpression>()) {
+      auto CE = static_cast<CallExpression*>(N->getExpression());
+      if (CE->Function->is<ReferenceExpression>()) {
+        auto RE = static_cast<ReferenceExpression*>(CE->Function);
+        if (RE->getNameAsString() == "expect_diagnostic") {
+          ZEN_ASSERT(CE->Args.size() == 1 && CE->Args[0]->is<LiteralExpression>());
+          Expected.emplace(N->Parent->getStartLine(), static_cast<LiteralExpression*>(CE->Args[0])->getAsInt());
+        }
+      }
+    }
+  }
+
+};
+
+/**
+ * Check a single file in isolation and compare the diagnostics with the
+ * `@expect_diagnostic` and `@:` annotations inside of it.
+ *
+ * Everything that is reported about the file is written to \p Log.
+ *
+ * \returns true if the file passed verification.
+ */
+static bool verifyFile(const std::string& Path, const LanguageConfig& Config, std::ostream& Log) {
+
+  ConsolePrinter Printer { Log };
+  DiagnosticStore DS;
+
+  auto Text = readFile(Path);
+  TextFile File { Path, Text };
+  VectorStream<ByteString, Char> Chars(Text, EOF);
+  Scanner S(DS, File, Chars);
+  Punctuator PT(S);
+  Parser P(File, PT, DS);
+
+  auto SF = P.parseSourceFile();
+  if (SF == nullptr) {
+    Printer.writeDiagnostics(DS.Diagnostics);
+    return false;
+  }
+  SF->setParents();
+
+  Checker TheChecker { Config, DS };
+  TheChecker.check(SF);
+
+  // Failed type assertions are never expected, so they are kept apart from
+  // the diagnostics of the checker.
+  DiagnosticStore Failed;
+  AssertVisitor V { TheChecker, Failed, Log };
+  V.walk(SF);
+
+  ExpectDiagnosticVisitor V1;
+  V1.walk(SF);
+
+  bool Passed = true;
+
+  for (auto D: DS.Diagnostics) {
+    auto N = D->getNode();
+    if (N) {
+      auto Line = N->getStartLine();
+      auto Match = V1.Expected.find(Line);
+      if (Match != V1.Expected.end() && Match->second == D->getCode()) {
+        Log << "skipped 1 diagnostic" << std::endl;
+        continue;
+      }
+    }
+    // Whenever D did not succeed to match we have to print the diagnostic error
+    Printer.writeDiagnostic(*D);
+    Passed = false;
+  }
+
+  if (!Failed.Diagnostics.empty()) {
+    Printer.writeDiagnostics(Failed.Diagnostics);
+    Passed = false;
+  }
+
+  return Passed;
+}
+
+/**
+ * Add the given files to \p Paths, replacing each directory with all the
+ * `.bolt` files that it contains.
+ */
+static bool collectVerifyPaths(const std::vector<std::string>& Args, std::vector<std::string>& Paths) {
+  namespace fs = std::filesystem;
+  for (const auto& Arg: Args) {
+    std::error_code EC;
+    if (!fs::exists(Arg, EC)) {
+      std::cerr << "error: '" << Arg << "' does not exist\n";
+      return false;
+    }
+    if (!fs::is_directory(Arg, EC)) {
+      Paths.push_back(Arg);
+      continue;
+    }
+    std::vector<std::string> Found;
+    for (fs::recursive_directory_iterator Iter { Arg, EC }, End; !EC && Iter != End; Iter.increment(EC)) {
+      if (Iter->is_regular_file() && Iter->path().extension() == ".bolt") {
+        Found.push_back(Iter->path().string());
+      }
+    }
+    if (EC) {
+      std::cerr << "error: could not read directory '" << Arg << "': " << EC.message() << "\n";
+      return false;
+    }
+    std::sort(Found.begin(), Found.end());
+    Paths.insert(Paths.end(), Found.begin(), Found.end());
+  }
+  return true;
+}
+
+/**
+ * Add every non-empty line of the file at \p ListPath to \p Paths.
+ */
+static bool readPathList(const std::string& ListPath, std::vector<std::string>& Paths) {
+  std::ifstream List(ListPath);
+  if (!List) {
+    std::cerr << "error: could not open '" << ListPath << "'\n";
+    return false;
+  }
+  std::string Line;
+  while (std::getline(List, Line)) {
+    if (!Line.empty()) {
+      Paths.push_back(Line);
+    }
+  }
+  return true;
+}
+
+/**
+ * Verify every file with its own checker, using up to \p Jobs threads.
+ *
+ * The results are reported in the order the files were given, followed by
+ * a summary. The log of a file is only printed when it failed.
+ *
+ * \returns true if all files passed verification.
+ */
+static bool verifyFiles(const std::vector<std::string>& Paths, const LanguageConfig& Config, std::size_t Jobs, std::ostream& Out) {
+
+  struct VerifyResult {
+    bool Passed = false;
+    std::ostringstream Log;
+  };
+
+  std::vector<VerifyResult> Results(Paths.size());
+  std::atomic<std::size_t> Next = 0;
+
+  auto Work = [&]() {
+    for (;;) {
+      auto I = Next++;
+      if (I >= Paths.size()) {
+        break;
+      }
+      Results[I].Passed = verifyFile(Paths[I], Config, Results[I].Log);
+    }
+  };
+
+  std::vector<std::thread> Workers;
+  for (std::size_t I = 1; I < std::min(Jobs, Paths.size()); I++) {
+    Workers.emplace_back(Work);
+  }
+  Work();
+  for (auto& Worker: Workers) {
+    Worker.join();
+  }
+
+  std::size_t FailedCount = 0;
+  for (std::size_t I = 0; I < Paths.size(); I++) {
+    auto& Result = Results[I];
+    if (Result.Passed) {
+      Out << "PASS " << Paths[I] << "\n";
+    } else {
+      Out << "FAIL " << Paths[I] << "\n" << Result.Log.str();
+      FailedCount++;
+    }
+  }
+  Out << (Paths.size() - FailedCount) << " passed, " << FailedCount << " failed\n";
+  Out.flush();
+
+  return FailedCount == 0;
+}
+
+/**
+ * Read the value of a `--jobs` flag into \p Jobs.
+ *
+ * \returns false if the value is not a positive number.
+ */
+static bool parseJobs(const std::string& Text, std::size_t& Jobs) {
+  auto Count = std::atoi(Text.c_str());
+  if (Count <= 0) {
+    std::cerr << "error: --jobs expects a positive number but got '" << Text << "'\n";
+    return false;
+  }
+  Jobs = Count;
+  return true;
+}
+
+/**
+ * Check every file as a module of its own, using up to \p Jobs threads.
+ *
+ * A module is checked after the modules it imports, so that it can use the
+ * interfaces that were produced for them. Imported modules that are not part
+ * of \p SourceFiles are loaded from \p InterfaceDir if it is not empty, and
+ * the interface of every module that checked without diagnostics is written
+ * back to it. Nothing is written for the files in \p InvalidFiles, which had
+ * parse errors, because their interface would describe whatever the parser
+ * recovered from the broken declarations.
+ *
+ * \p Report is called with the sorted diagnostics of a module as soon as it
+ * was checked. It is never called by two threads at the same time.
+ *
+ * \returns false if the modules could not be checked.
+ */
+static bool checkModules(
+  const std::vector<SourceFile*>& SourceFiles,
+  const std::unordered_set<SourceFile*>& InvalidFiles,
+  const LanguageConfig& Config,
+  const std::filesystem::path& InterfaceDir,
+  std::size_t Jobs,
+  TraceWriter* Trace,
+  Statistics& Stats,
+  std::function<void(DiagnosticStore&)> Report
+) {
+
+  struct Module {
+    SourceFile* SF = nullptr;
+    DiagnosticStore DS;
+    std::unique_ptr<Checker> C;
+    ByteString Interface;
+    bool IsReused = false;
+  };
+
+  std::unordered_map<ByteString, Module> Modules;
+  Graph<ByteString> Imports;
+
+  for (auto SF: SourceFiles) {
+    auto Name = getModuleNameForPath(SF->getTextFile().getPath());
+    auto [Match, Inserted] = Modules.try_emplace(Name);
+    if (!Inserted) {
+      std::cerr << "error: " << Match->second.SF->getTextFile().getPath() << " and " << SF->getTextFile().getPath() << " both define module " << Name << "\n";
+      return false;
+    }
+    Match->second.SF = SF;
+    Imports.addVertex(Name);
+  }
+
+  for (auto& [Name, M]: Modules) {
+    for (const auto& Import: getImportedModules(M.SF)) {
+      if (Import != Name && Modules.count(Import)) {
+        Imports.addEdge(Name, Import);
+      }
+    }
+  }
+
+  if (!InterfaceDir.empty()) {
+    std::error_code EC;
+    std::filesystem::create_directories(InterfaceDir, EC);
+  }
+
+  std::mutex Mutex;
+  bool Failed = false;
+
+  auto Result = runInDependencyOrder(Imports, Jobs, [&](const std::vector<ByteString>& Names) {
+
+    if (Names.size() > 1) {
+      auto Sorted = Names;
+      std::sort(Sorted.begin(), Sorted.end());
+      std::lock_guard Lock { Mutex };
+      std::cerr << "error: modules";
+      for (const auto& Name: Sorted) {
+        std::cerr << " " << Name;
+      }
+      std::cerr << " import each other\n";
+      Failed = true;
+      return;
+    }
+
+    auto& M = Modules.at(Names.front());
+
+    // The interfaces of the imported modules are collected first, because
+    // the module does not have to be checked when they did not change.
+    std::vector<std::tuple<ByteString, ByteString>> Interfaces;
+    for (const auto& Import: getImportedModules(M.SF)) {
+      auto Dep = Modules.find(Import);
+      if (Dep != Modules.end()) {
+        // Modules that could not be checked have no interface. The checker
+        // reports every name that is used from them.
+        Interfaces.emplace_back(Import, Dep->second.Interface);
+        continue;
+      }
+      ByteString Data;
+      if (!InterfaceDir.empty()) {
+        auto Path = InterfaceDir / (Import + ModuleInterfaceExtension);
+        if (std::filesystem::exists(Path)) {
+          Data = readFile(Path.string());
+        }
+      }
+      Interfaces.emplace_back(Import, Data);
+    }
+
+    ByteString Stamp;
+    if (!InterfaceDir.empty()) {
+      Stamp = getModuleStamp(Config, M.SF->getTextFile().getText(), Interfaces);
+      auto StampPath = InterfaceDir / (Names.front() + ModuleStampExtension);
+      auto InterfacePath = InterfaceDir / (Names.front() + ModuleInterfaceExtension);
+      if (std::filesystem::exists(StampPath)
+          && std::filesystem::exists(InterfacePath)
+          && readFile(StampPath.string()) == Stamp) {
+        // Stamps are only written for modules without diagnostics
+        M.Interface = readFile(InterfacePath.string());
+        M.IsReused = true;
+        return;
+      }
+    }
+
+    M.C = std::make_unique<Checker>(Config, M.DS);
+    M.C->setTrace(Trace);
+
+    for (const auto& [Import, Data]: Interfaces) {
+      if (Data.empty() || M.C->hasModule(Import)) {
+        continue;
+      }
+      if (!M.C->loadInterface(Data)) {
+        std::lock_guard Lock { Mutex };
+        std::cerr << "error: " << (InterfaceDir / (Import + ModuleInterfaceExtension)).string() << " is not a valid module interface\n";
+        Failed = true;
+        return;
+      }
+    }
+
+    M.C->check(M.SF);
+    M.C->writeInterface(M.SF, Names.front(), M.Interface);
+
+    if (!InterfaceDir.empty() && M.DS.Diagnostics.empty() && !InvalidFiles.count(M.SF)) {
+      auto writeOutput = [&](const char* Extension, const ByteString& Data) {
+        auto Path = InterfaceDir / (Names.front() + Extension);
+        std::ofstream File(Path, std::ios::binary);
+        if (File.write(Data.data(), Data.size())) {
+          return true;
+        }
+        std::lock_guard Lock { Mutex };
+        std::cerr << "error: could not write " << Path.string() << "\n";
+        Failed = true;
+        return false;
+      };
+      // The stamp is written last, so that it never describes an interface
+      // that was only partly written
+      if (writeOutput(ModuleInterfaceExtension, M.Interface)) {
+        writeOutput(ModuleStampExtension, Stamp);
+      }
+    }
+
+    M.DS.sort();
+    std::lock_guard Lock { Mutex };
+    Report(M.DS);
+  });
+
+  for (auto& [Name, M]: Modules) {
+    if (M.C) {
+      Stats.addCount("type-variables", M.C->getTypeVarCount());
+      Stats.addCount("constraints-solved", M.C->getSolvedConstraintCount());
+      Stats.addCount("unifications", M.C->getUnificationCount());
+    }
+  }
+  Stats.addCount("modules", Modules.size());
+  Stats.addCount("modules-reused", std::count_if(Modules.begin(), Modules.end(), [](const auto& Pair) {
+    return Pair.second.IsReused;
+  }));
+  Stats.addCount("critical-path-modules", Result.CriticalPathLength);
+  Stats.addTime("check-critical-path", Result.CriticalPathTime);
+
+  return !Failed;
+}
+
 int main(int Argc, const char* Argv[]) {
 
   auto Match = po::program("bolt", "The offical compiler for the Bolt programming language")
     .flag(po::flag<bool>("additional-syntax", "Enable additional Bolt syntax for asserting compiler state"))
     .flag(po::flag<bool>("direct-diagnostics", "Immediately print diagnostics without sorting them first")) // TODO support default values in zen::po
+    .flag(po::flag<std::string>("diagnostics-format", "How to print diagnostics: console (the default), jsonl or sarif"))
+    .flag(po::flag<bool>("time-passes", "Report how long each phase of the compiler took"))
+    .flag(po::flag<bool>("stats", "Report how much work the compiler did, such as the amount of tokens and unifications"))
+    .flag(po::flag<std::string>("stats-format", "How to print --time-passes and --stats: text (the default) or json"))
+    .flag(po::flag<std::string>("trace-out", "Write a trace of the type checker that can be opened in chrome://tracing or Perfetto"))
+    .flag(po::flag<bool>("fold-stats", "Report how many expressions were replaced by a constant before running or building"))
     .subcommand(
       po::command("check", "Check sources for programming mistakes")
+        .flag(po::flag<std::string>("interface-dir", "Load the interfaces of other modules from this directory and write the interfaces of the checked modules to it"))
+        .flag(po::flag<std::string>("jobs", "How many modules to check at the same time (defaults to the amount of CPU cores)"))
         .pos_arg("file", po::some))
     .subcommand(
-      po::command("verify", "Verify integrity of the compiler on selected file(s)")
+      po::command("verify", "Verify integrity of the compiler on selected file(s) or directories")
+        .flag(po::flag<std::string>("files-from", "Also verify the files listed in the given file, one per line"))
+        .flag(po::flag<std::string>("jobs", "How many files to verify at the same time (defaults to the amount of CPU cores)"))
+        .pos_arg("file", po::any))
+    .subcommand(
+      po::command("build", "Compile sources to a native executable using the system C compiler")
+        .flag(po::flag<std::string>("output", "Where to write the executable to"))
+        .flag(po::flag<bool>("emit-c", "Write the generated C code to the output instead of compiling it"))
         .pos_arg("file", po::some))
+    .subcommand(
+      po::command("serve", "Keep checked sources in memory and answer requests on a Unix socket")
+        .flag(po::flag<std::string>("socket", "Where to create the socket (defaults to .bolt.sock)")))
+    .subcommand(
+      po::command("lsp", "Talk to an editor using the Language Server Protocol on standard input and output"))
     .subcommand(
       po::command("eval", "Run sources")
         .pos_arg("file", po::some)
@@ -67,134 +525,302 @@ int main(int Argc, const char* Argv[]) {
   auto [Name, Submatch] = Match.subcommand();
 
   auto IsVerify = Name == "verify";
-  auto DirectDiagnostics = Match.has_flag("direct-diagnostics") && Match.get_flag<bool>("direct-diagnostics") && !IsVerify;
+  auto DirectDiagnostics = Match.has_flag("direct-diagnostics") && Match.get_flag<bool>("direct-diagnostics");
   auto AdditionalSyntax = Match.has_flag("additional-syntax") && Match.get_flag<bool>("additional-syntax");
+  auto FoldStats = Match.has_flag("fold-stats") && Match.get_flag<bool>("fold-stats");
+  auto TimePasses = Match.has_flag("time-passes") && Match.get_flag<bool>("time-passes");
+  auto ShowStats = Match.has_flag("stats") && Match.get_flag<bool>("stats");
+  std::string StatsFormat = Match.has_flag("stats-format") ? Match.get_flag<std::string>("stats-format") : "text";
+
+  Statistics Stats { TimePasses || ShowStats };
+
+  // Report when the driver exits, no matter how it exits
+  struct StatisticsReporter {
+    Statistics& Stats;
+    bool TimePasses;
+    bool ShowStats;
+    bool AsJSON;
+    ~StatisticsReporter() {
+      if (!Stats.isEnabled()) {
+        return;
+      }
+      auto ParseTime = std::chrono::duration<double>(Stats.getTime("parse")).count();
+      if (ParseTime > 0) {
+        Stats.addCount("tokens-per-second", static_cast<std::size_t>(Stats.getCount("tokens") / ParseTime));
+      }
+      Stats.addCount("peak-rss-kib", getPeakMemoryUsage());
+      if (AsJSON) {
+        Stats.writeJSON(std::cerr, TimePasses, ShowStats);
+        return;
+      }
+      if (TimePasses) {
+        Stats.writeTimers(std::cerr);
+      }
+      if (ShowStats) {
+        Stats.writeCounters(std::cerr);
+      }
+    }
+  };
+
+  StatisticsReporter Reporter { Stats, TimePasses, ShowStats, StatsFormat == "json" };
 
   ConsolePrinter ThePrinter;
-  ConsoleDiagnostics DE(ThePrinter);
+  ConsoleDiagnostics CD(ThePrinter);
+
+  // Machine-readable diagnostics are written to stdout as soon as they are
+  // reported. The verify command always needs to see them first.
+  std::unique_ptr<JSONDiagnostics> JD;
+  std::string DiagnosticsFormat = Match.has_flag("diagnostics-format") ? Match.get_flag<std::string>("diagnostics-format") : "console";
+  if (DiagnosticsFormat == "jsonl") {
+    JD = std::make_unique<JSONDiagnostics>(std::cout, JSONDiagnosticsFormat::Lines);
+  } else if (DiagnosticsFormat == "sarif") {
+    JD = std::make_unique<JSONDiagnostics>(std::cout, JSONDiagnosticsFormat::SARIF);
+  } else if (DiagnosticsFormat != "console") {
+    std::cerr << "error: unknown diagnostics format '" << DiagnosticsFormat << "'\n";
+    return 1;
+  }
+  if (IsVerify) {
+    JD = nullptr;
+  }
+  DiagnosticEngine& DE = JD ? static_cast<DiagnosticEngine&>(*JD) : static_cast<DiagnosticEngine&>(CD);
+
+  std::ofstream TraceFile;
+  std::unique_ptr<TraceWriter> Trace;
+  if (Match.has_flag("trace-out")) {
+    auto TracePath = Match.get_flag<std::string>("trace-out");
+    TraceFile.open(TracePath);
+    if (!TraceFile) {
+      std::cerr << "error: could not open '" << TracePath << "' for writing\n";
+      return 1;
+    }
+    Trace = std::make_unique<TraceWriter>(TraceFile);
+  }
+
   LanguageConfig Config;
 
+  if (Name == "serve") {
+    CompileServer Server { Config };
+    return Server.serve(Submatch->has_flag("socket") ? Submatch->get_flag<std::string>("socket") : ".bolt.sock");
+  }
+
+  if (Name == "lsp") {
+    LanguageServer Server { Config, std::cout };
+    return Server.serve(std::cin);
+  }
+
+  if (IsVerify) {
+    std::vector<std::string> Paths;
+    if (!collectVerifyPaths(Submatch->get_pos_args(), Paths)) {
+      return 1;
+    }
+    if (Submatch->has_flag("files-from") && !readPathList(Submatch->get_flag<std::string>("files-from"), Paths)) {
+      return 1;
+    }
+    std::size_t Jobs = std::max(1u, std::thread::hardware_concurrency());
+    if (Submatch->has_flag("jobs") && !parseJobs(Submatch->get_flag<std::string>("jobs"), Jobs)) {
+      return 1;
+    }
+    ScopedTimer T { Stats, "verify" };
+    return verifyFiles(Paths, Config, Jobs, std::cerr) ? 0 : XARGS_STOP_LOOP;
+  }
+
   std::vector<SourceFile*> SourceFiles;
 
+  // The files that were parsed with errors
+  std::unordered_set<SourceFile*> InvalidFiles;
+
+  struct CountVisitor : public CSTVisitor<CountVisitor> {
+    std::size_t Count = 0;
+    bool enterNode(Node* N) {
+      Count++;
+      return true;
+    }
+  };
+
   for (auto Filename: Submatch->get_pos_args()) {
 
-    auto Text = readFile(Filename);
+    ByteString Text;
+    {
+      ScopedTimer T { Stats, "read" };
+      Text = readFile(Filename);
+    }
     TextFile File { Filename, Text };
     VectorStream<ByteString, Char> Chars(Text, EOF);
     Scanner S(DE, File, Chars);
     Punctuator PT(S);
     Parser P(File, PT, DE);
 
-    auto SF = P.parseSourceFile();
+    auto ErrorCount = DE.getErrorCount();
+    SourceFile* SF;
+    {
+      // Scanning is done on demand by the parser, so it is included here
+      ScopedTimer T { Stats, "parse" };
+      SF = P.parseSourceFile();
+    }
+    Stats.addCount("tokens", S.getTokenCount());
     if (SF == nullptr) {
       continue;
     }
+    if (DE.getErrorCount() > ErrorCount) {
+      InvalidFiles.insert(SF);
+    }
 
-    SF->setParents();
+    {
+      ScopedTimer T { Stats, "set-parents" };
+      SF->setParents();
+    }
+
+    if (Stats.isEnabled()) {
+      CountVisitor V;
+      V.walk(SF);
+      Stats.addCount("nodes", V.Count);
+    }
 
     SourceFiles.push_back(SF);
   }
 
   DiagnosticStore DS;
-  Checker TheChecker { Config, DirectDiagnostics ? static_cast<DiagnosticEngine&>(DE) : static_cast<DiagnosticEngine&>(DS) };
 
-  for (auto SF: SourceFiles) {
-    TheChecker.check(SF);
-  }
+  if (Name == "check") {
 
-  if (IsVerify) {
+    std::size_t Jobs = std::max(1u, std::thread::hardware_concurrency());
+    if (Submatch->has_flag("jobs") && !parseJobs(Submatch->get_flag<std::string>("jobs"), Jobs)) {
+      return 1;
+    }
+    std::filesystem::path InterfaceDir = Submatch->has_flag("interface-dir") ? Submatch->get_flag<std::string>("interface-dir") : "";
 
-    // TODO make this work with mulitple source files at once
-
-    bool HasError = 0;
-
-    struct AssertVisitor : public CSTVisitor<AssertVisitor> {
-      Checker& C;
-      DiagnosticEngine& DE;
-      void visitExpression(Expression* N) {
-        for (auto A: N->Annotations) {
-          if (A->getKind() == NodeKind::TypeAssertAnnotation) {
-            auto Left = C.getType(N);
-            auto Right = static_cast<TypeAssertAnnotation*>(A)->getTypeExpression()->getType();
-            std::cerr << "verify " << describe(Left) << " == " << describe(Right) << std::endl;
-            if (*Left != *Right) {
-              DE.add<UnificationErrorDiagnostic>(Left, Right, TypePath(), TypePath(), A);
-            }
-          }
-        }
-        visitEachChild(N);
+    bool HasError = false;
+    auto Report = [&](DiagnosticStore& Store) {
+      if (Store.Diagnostics.empty()) {
+        return;
       }
-    };
-
-    AssertVisitor V { {}, TheChecker, DE };
-    for (auto SF: SourceFiles) {
-      V.visit(SF);
-    }
-
-    struct ExpectDiagnosticVisitor : public CSTVisitor<ExpectDiagnosticVisitor> {
-      std::multimap<std::size_t, unsigned> Expected;
-      void visitExpressionAnnotation(ExpressionAnnotation* N) {
-        if (N->getExpression()->is<CallExpression>()) {
-          auto CE = static_cast<CallExpression*>(N->getExpression());
-          if (CE->Function->is<ReferenceExpression>()) {
-            auto RE = static_cast<ReferenceExpression*>(CE->Function);
-            if (RE->getNameAsString() == "expect_diagnostic") {
-              ZEN_ASSERT(CE->Args.size() == 1 && CE->Args[0]->is<LiteralExpression>());
-              Expected.emplace(N->Parent->getStartLine(), static_cast<LiteralExpression*>(CE->Args[0])->getAsInt());
-            }
-          }
+      HasError = true;
+      if (JD) {
+        for (auto D: Store.Diagnostics) {
+          JD->writeDiagnostic(*D);
         }
+      } else if (DirectDiagnostics) {
+        ThePrinter.writeDiagnostics(Store.Diagnostics);
+      } else {
+        DS.merge(Store);
       }
     };
 
-    ExpectDiagnosticVisitor V1;
-    for (auto SF: SourceFiles) {
-      V1.visit(SF);
+    bool Checked;
+    {
+      ScopedTimer T { Stats, "check" };
+      Checked = checkModules(SourceFiles, InvalidFiles, Config, InterfaceDir, Jobs, Trace.get(), Stats, Report);
     }
 
-    for (auto D: DS.Diagnostics) {
-      auto N = D->getNode();
-      if (N) {
-        auto Line = N->getStartLine();
-        auto Match = V1.Expected.find(Line);
-        if (Match != V1.Expected.end() && Match->second == D->getCode()) {
-          std::cerr << "skipped 1 diagnostic" << std::endl;
-          continue;
-        }
-      }
-      // Whenever D did not succeed to match we have to print the diagnostic error
-      ThePrinter.writeDiagnostic(*D);
-      HasError = true;
+    {
+      ScopedTimer T { Stats, "diagnostics" };
+      ThePrinter.writeDiagnostics(DS.Diagnostics);
     }
 
-    if (HasError) {
-      return XARGS_STOP_LOOP;
+    if (!Checked) {
+      return 1;
     }
+    // Diagnostics that were sorted before printing them never changed the
+    // exit code, so this stays the same when modules are checked in parallel.
+    return DE.hasError() || (HasError && (JD || DirectDiagnostics)) ? 255 : 0;
+  }
 
-  } else {
+  Checker TheChecker { Config, DirectDiagnostics || JD ? DE : static_cast<DiagnosticEngine&>(DS) };
+  TheChecker.setTrace(Trace.get());
 
-    DS.sort();
-    for (auto D: DS.Diagnostics) {
-      ThePrinter.writeDiagnostic(*D);
+  {
+    ScopedTimer T { Stats, "check" };
+    for (auto SF: SourceFiles) {
+      TheChecker.check(SF);
     }
+  }
+
+  Stats.addCount("type-variables", TheChecker.getTypeVarCount());
+  Stats.addCount("constraints-solved", TheChecker.getSolvedConstraintCount());
+  Stats.addCount("unifications", TheChecker.getUnificationCount());
 
+  {
+    ScopedTimer T { Stats, "diagnostics" };
+    DS.sort();
+    ThePrinter.writeDiagnostics(DS.Diagnostics);
   }
 
   if (DE.hasError()) {
     return 255;
   }
 
+  // Folding relies on the inferred types, so it is skipped when the program
+  // did not type-check.
+  if ((Name == "build" || Name == "eval") && DS.Diagnostics.empty()) {
+    ScopedTimer T { Stats, "fold" };
+    ConstantFolder Folder { TheChecker };
+    for (auto SF: SourceFiles) {
+      Folder.fold(SF);
+    }
+    Stats.addCount("folded-expressions", Folder.getFoldedCount());
+    if (FoldStats) {
+      std::cerr << "folded " << Folder.getFoldedCount() << " expressions" << std::endl;
+    }
+  }
+
+  if (Name == "build") {
+
+    // Unlike the evaluator, the C backend relies on the program being
+    // well-typed.
+    if (!DS.Diagnostics.empty()) {
+      return 255;
+    }
+
+    CEmitter Emitter { TheChecker, DE };
+    std::string Output = Submatch->has_flag("output") ? Submatch->get_flag<std::string>("output") : "a.out";
+    auto EmitC = Submatch->has_flag("emit-c") && Submatch->get_flag<bool>("emit-c");
+    auto CPath = EmitC ? Output : Output + ".c";
+    {
+      ScopedTimer T { Stats, "emit" };
+      for (auto SF: SourceFiles) {
+        Emitter.emit(SF);
+      }
+      if (DE.hasError()) {
+        return 255;
+      }
+      std::ofstream File(CPath);
+      Emitter.write(File);
+    }
+    if (EmitC) {
+      return 0;
+    }
+
+    int Status;
+    {
+      ScopedTimer T { Stats, "cc" };
+      Status = compileC(CPath, Output);
+    }
+    std::remove(CPath.c_str());
+    if (Status == -1) {
+      std::cerr << "error: could not run the C compiler\n";
+      return 1;
+    }
+    if (Status != 0) {
+      std::cerr << "error: failed to compile the generated C code\n";
+      return 1;
+    }
+
+    return 0;
+  }
+
   if (Name == "eval") {
-    Evaluator E;
+    ScopedTimer T { Stats, "eval" };
+    Evaluator E { &TheChecker, std::cerr };
     Env GlobalEnv;
-    GlobalEnv.add("print", Value::binding([](auto Args) {
-      ZEN_ASSERT(Args.size() == 1)
-      std::cerr << Args[0].asString() << "\n";
-      return Value::unit();
-    }));
+    addBuiltins(GlobalEnv);
     for (auto SF: SourceFiles) {
       // TODO add a SourceFile-local env that inherits from GlobalEnv
-      E.evaluate(SF, GlobalEnv);
+      try {
+        E.evaluate(SF, GlobalEnv);
+      } catch (const RuntimeError& Error) {
+        std::cerr << "error: " << Error.what() << "\n";
+        return 1;
+      }
     }
   }
 
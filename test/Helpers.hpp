@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+
+#include "bolt/CST.hpp"
+#include "bolt/Common.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/Scanner.hpp"
+#include "bolt/Parser.hpp"
+#include "bolt/Checker.hpp"
+
+namespace bolt {
+
+  /**
+   * Parse \p Input as if it was the contents of a file.
+   *
+   * The caller owns the resulting source file and has to unref it.
+   */
+  inline SourceFile* parseSourceFile(std::string Input, DiagnosticEngine& DE) {
+    TextFile T { "#<anonymous>", Input };
+    VectorStream<std::string, Char> Chars { Input, EOF };
+    Scanner S(DE, T, Chars);
+    Punctuator PT(S);
+    Parser P(T, PT, DE);
+    auto SF = P.parseSourceFile();
+    SF->setParents();
+    return SF;
+  }
+
+  /**
+   * A source file that was parsed and checked, together with the checker
+   * that checked it.
+   *
+   * Everything is freed when this object goes out of scope, so it should
+   * outlive any node, type or diagnostic that a test inspects.
+   */
+  class CheckedSourceFile {
+  public:
+
+    DiagnosticStore DS;
+    LanguageConfig Config;
+    SourceFile* SF;
+    Checker C;
+
+    CheckedSourceFile(std::string Input, DiagnosticEngine& DE):
+      SF(parseSourceFile(Input, DE)), C(Config, DE) {
+        C.check(SF);
+      }
+
+    CheckedSourceFile(std::string Input):
+      CheckedSourceFile(Input, DS) {}
+
+    CheckedSourceFile(const CheckedSourceFile&) = delete;
+    CheckedSourceFile& operator=(const CheckedSourceFile&) = delete;
+
+    ~CheckedSourceFile() {
+      SF->unref();
+    }
+
+  };
+
+  /**
+   * Parse and check \p Input, adding diagnostics to the store of the result.
+   */
+  inline CheckedSourceFile checkSourceFile(std::string Input) {
+    return CheckedSourceFile(Input);
+  }
+
+  /**
+   * Parse and check \p Input, sending diagnostics to \p DE.
+   */
+  inline CheckedSourceFile checkSourceFile(std::string Input, DiagnosticEngine& DE) {
+    return CheckedSourceFile(Input, DE);
+  }
+
+}
@@ -0,0 +1,146 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/Diagnostics.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/CEmitter.hpp"
+
+#include "Helpers.hpp"
+
+using namespace bolt;
+
+static std::string emitChecked(CheckedSourceFile& F) {
+  EXPECT_EQ(F.DS.countDiagnostics(), 0);
+  CEmitter Emitter { F.C, F.DS };
+  Emitter.emit(F.SF);
+  std::ostringstream Out;
+  Emitter.write(Out);
+  return Out.str();
+}
+
+/**
+ * Compile the C code emitted for \p Input with the system C compiler, run it
+ * and return whatever it printed.
+ *
+ * \returns nothing if no C compiler could be started.
+ */
+static std::optional<std::string> compileAndRun(std::string Input) {
+  auto F = checkSourceFile(Input);
+  auto Code = emitChecked(F);
+  if (F.DS.countDiagnostics() > 0) {
+    ADD_FAILURE() << "could not emit C code";
+    return "";
+  }
+  std::string Template = (std::filesystem::temp_directory_path() / "bolt-XXXXXX").string();
+  if (mkdtemp(Template.data()) == nullptr) {
+    ADD_FAILURE() << "could not create a temporary directory";
+    return "";
+  }
+  std::filesystem::path Dir { Template };
+  auto CPath = (Dir / "main.c").string();
+  auto Exe = (Dir / "main").string();
+  {
+    std::ofstream File(CPath);
+    File << Code;
+  }
+  std::string Printed;
+  auto Status = compileC(CPath, Exe);
+  if (Status == 0) {
+    auto Pipe = popen(Exe.c_str(), "r");
+    char Buffer[256];
+    std::size_t N;
+    while ((N = std::fread(Buffer, 1, sizeof(Buffer), Pipe)) > 0) {
+      Printed.append(Buffer, N);
+    }
+    EXPECT_EQ(pclose(Pipe), 0);
+  }
+  std::filesystem::remove_all(Dir);
+  if (Status == -1) {
+    return {};
+  }
+  EXPECT_EQ(Status, 0);
+  return Printed;
+}
+
+TEST(CEmitterTest, EmitsUnboxedIntegerFunction) {
+  auto F = checkSourceFile(
+    "let square x : Int -> Int = x * x\n"
+    "print \"ok\"\n"
+  );
+  auto Out = emitChecked(F);
+  ASSERT_EQ(F.DS.countDiagnostics(), 0);
+  ASSERT_NE(Out.find("int64_t b_square(int64_t"), std::string::npos);
+}
+
+TEST(CEmitterTest, KeepsNamesThatLookLikeEscapesApart) {
+  auto F = checkSourceFile(
+    "let a_x60 x : Int -> Int = x + 1\n"
+    "let a` x : Int -> Int = x + 2\n"
+    "print \"ok\"\n"
+  );
+  auto Out = emitChecked(F);
+  ASSERT_EQ(F.DS.countDiagnostics(), 0);
+  ASSERT_NE(Out.find("int64_t b_a__x60(int64_t"), std::string::npos);
+  ASSERT_NE(Out.find("int64_t b_a_x60(int64_t"), std::string::npos);
+}
+
+TEST(CEmitterTest, ReportsPolymorphicFunctions) {
+  auto F = checkSourceFile("let id x = x\n");
+  emitChecked(F);
+  ASSERT_EQ(F.DS.countDiagnostics(), 1);
+  ASSERT_EQ(F.DS.Diagnostics[0]->getKind(), DiagnosticKind::NotSupported);
+}
+
+TEST(CEmitterTest, RunsMatchOnEnumsAndTuples) {
+  auto Printed = compileAndRun(
+    "enum Shape.\n"
+    "  Square Int\n"
+    "  Rect Int Int\n"
+    "let area s : Shape -> Int = match s.\n"
+    "  Square w => w * w\n"
+    "  Rect w h => w * h\n"
+    "let describe n b : Int -> Bool -> String = match (n, b).\n"
+    "  (12, True) => \"twelve\"\n"
+    "  (_, False) => \"false\"\n"
+    "  _ => \"other\"\n"
+    "print (describe (area (Rect 3 4)) True)\n"
+    "print (describe (area (Square 3)) True)\n"
+    "print (describe 1 False)\n"
+  );
+  if (!Printed) {
+    GTEST_SKIP() << "no C compiler available";
+  }
+  ASSERT_EQ(*Printed, "twelve\nother\nfalse\n");
+}
+
+TEST(CEmitterTest, KeepsLiveObjectsDuringCollection) {
+  // The list is large enough to trigger several collections while it is
+  // being built, when it is only referred to from the stack.
+  auto Printed = compileAndRun(
+    "enum List.\n"
+    "  Nil\n"
+    "  Cons Int List\n"
+    "let build n acc : Int -> List -> List = match n.\n"
+    "  0 => acc\n"
+    "  _ => build (n - 1) (Cons n acc)\n"
+    "let sum l acc : List -> Int -> Int = match l.\n"
+    "  Nil => acc\n"
+    "  Cons x rest => sum rest (acc + x)\n"
+    "let check n : Int -> String = match n.\n"
+    "  1250025000 => \"ok\"\n"
+    "  _ => \"wrong\"\n"
+    "print (check (sum (build 50000 Nil) 0))\n"
+  );
+  if (!Printed) {
+    GTEST_SKIP() << "no C compiler available";
+  }
+  ASSERT_EQ(*Printed, "ok\n");
+}
@@ -0,0 +1,74 @@
+
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+
+using namespace bolt;
+
+TEST(CSTTest, TokensKeepTheirLocation) {
+  auto Name = new Identifier("foo", TextLoc { 70000, 12 });
+  ASSERT_EQ(Name->getStartLine(), 70000);
+  ASSERT_EQ(Name->getStartColumn(), 12);
+  ASSERT_EQ(Name->getEndLoc().Column, 15);
+  Name->setStartLoc(TextLoc { 3, 4 });
+  ASSERT_EQ(Name->getStartLoc().Line, 3);
+  ASSERT_EQ(Name->getStartLoc().Column, 4);
+  Name->unref();
+}
+
+TEST(CSTTest, ReusesTheMemoryOfFreedNodes) {
+  auto A = new Identifier("a");
+  auto B = new Identifier("b");
+  A->unref();
+  auto C = new Identifier("c");
+  ASSERT_EQ(static_cast<void*>(C), static_cast<void*>(A));
+  ASSERT_EQ(C->getCanonicalText(), "c");
+  ASSERT_EQ(B->getCanonicalText(), "b");
+  B->unref();
+  C->unref();
+}
+
+TEST(CSTTest, AllocatesNodesOnManyThreads) {
+  constexpr std::size_t ThreadCount = 4;
+  constexpr std::size_t NodeCount = 20000;
+  std::vector<std::vector<Identifier*>> Nodes(ThreadCount);
+  std::vector<std::thread> Threads;
+  for (std::size_t I = 0; I < ThreadCount; I++) {
+    Threads.emplace_back([&, I] {
+      for (std::size_t J = 0; J < NodeCount; J++) {
+        Nodes[I].push_back(new Identifier("x", TextLoc { I + 1, J + 1 }));
+      }
+    });
+  }
+  for (auto& T: Threads) {
+    T.join();
+  }
+  Threads.clear();
+  std::set<Identifier*> Seen;
+  for (std::size_t I = 0; I < ThreadCount; I++) {
+    for (std::size_t J = 0; J < NodeCount; J++) {
+      auto N = Nodes[I][J];
+      ASSERT_TRUE(Seen.insert(N).second);
+      ASSERT_EQ(N->getStartLine(), I + 1);
+      ASSERT_EQ(N->getStartColumn(), J + 1);
+    }
+  }
+  // Every thread frees the nodes that another thread created
+  for (std::size_t I = 0; I < ThreadCount; I++) {
+    Threads.emplace_back([&, I] {
+      for (auto N: Nodes[(I + 1) % ThreadCount]) {
+        N->unref();
+      }
+    });
+  }
+  for (auto& T: Threads) {
+    T.join();
+  }
+  auto Name = new Identifier("y", TextLoc { 1, 2 });
+  ASSERT_EQ(Name->getStartColumn(), 2);
+  Name->unref();
+}
@@ -0,0 +1,102 @@
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/CSTVisitor.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+
+#include "Helpers.hpp"
+
+using namespace bolt;
+
+struct OrderVisitor : public CSTVisitor<OrderVisitor> {
+
+  std::vector<Node*> Entered;
+  std::vector<Node*> Left;
+
+  bool enterNode(Node* N) {
+    Entered.push_back(N);
+    return true;
+  }
+
+  void leaveNode(Node* N) {
+    Left.push_back(N);
+  }
+
+};
+
+struct RecursiveOrderVisitor : public CSTVisitor<RecursiveOrderVisitor> {
+
+  std::vector<Node*> Entered;
+  std::vector<Node*> Left;
+
+  void visit(Node* N) {
+    Entered.push_back(N);
+    visitEachChild(N);
+    Left.push_back(N);
+  }
+
+};
+
+static Expression* createNestedExpression(std::size_t Depth) {
+  Expression* X = new LiteralExpression(new IntegerLiteral(1, TextLoc {}));
+  for (std::size_t I = 0; I < Depth; I++) {
+    X = new InfixExpression(X, new CustomOperator("+", TextLoc {}), new LiteralExpression(new IntegerLiteral(1, TextLoc {})));
+  }
+  X->setParents();
+  return X;
+}
+
+TEST(CSTVisitorTest, WalksInTheSameOrderAsVisit) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile("let f x = x + 1\nlet y = match f 1 {\n  1 => (1, 2)\n  _ => (3, 4)\n}\n", DS);
+  OrderVisitor V1;
+  V1.walk(SF);
+  RecursiveOrderVisitor V2;
+  V2.visit(SF);
+  ASSERT_EQ(V1.Entered, V2.Entered);
+  ASSERT_EQ(V1.Left, V2.Left);
+  SF->unref();
+}
+
+TEST(CSTVisitorTest, WalksDeepTreesInTheSameOrderAsVisit) {
+  auto X = createNestedExpression(1000);
+  OrderVisitor V1;
+  V1.walk(X);
+  RecursiveOrderVisitor V2;
+  V2.visit(X);
+  ASSERT_EQ(V1.Entered, V2.Entered);
+  ASSERT_EQ(V1.Left, V2.Left);
+  X->unref();
+}
+
+TEST(CSTVisitorTest, SkipsTheChildrenOfNodesThatAreNotEntered) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile("let a = 1\nlet b = 2\n", DS);
+  struct Visitor : public CSTVisitor<Visitor> {
+    std::size_t Count = 0;
+    bool enterNode(Node* N) {
+      Count++;
+      return N->getKind() != NodeKind::LetDeclaration;
+    }
+  };
+  Visitor V;
+  V.walk(SF);
+  ASSERT_EQ(V.Count, 3);
+  SF->unref();
+}
+
+TEST(CSTVisitorTest, HandlesDeeplyNestedExpressions) {
+  auto X = createNestedExpression(1000000);
+  struct Visitor : public CSTVisitor<Visitor> {
+    std::size_t Count = 0;
+    bool enterNode(Node* N) {
+      Count++;
+      return true;
+    }
+  };
+  Visitor V;
+  V.walk(X);
+  ASSERT_EQ(V.Count, 2 + 4 * 1000000);
+  X->unref();
+}
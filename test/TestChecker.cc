@@ -3,51 +3,44 @@
 
 #include "bolt/CST.hpp"
 #include "bolt/Diagnostics.hpp"
-#include "bolt/DiagnosticEngine.hpp"
-#include "bolt/Scanner.hpp"
-#include "bolt/Parser.hpp"
 #include "bolt/Checker.hpp"
 
-using namespace bolt;
+#include "Helpers.hpp"
 
-auto checkSourceFile(std::string Input) {
-  DiagnosticStore DS;
-  TextFile T { "#<anonymous>", Input };
-  VectorStream<std::string, Char> Chars { Input, EOF };
-  Scanner S(T, Chars);
-  Punctuator PT(S);
-  Parser P(T, PT, DS);
-  LanguageConfig Config;
-  auto SF = P.parseSourceFile();
-  SF->setParents();
-  Checker C(Config, DS);
-  C.check(SF);
-  return std::make_tuple(SF, C, DS);
-}
+using namespace bolt;
 
-auto checkExpression(std::string Input) {
-  auto [SF, C, DS] = checkSourceFile(Input);
-  return std::make_tuple(
-    static_cast<ExpressionStatement*>(SF->Elements[0])->Expression,
-    C,
-    DS
-  );
+static Expression* getExpression(CheckedSourceFile& F) {
+  return static_cast<ExpressionStatement*>(F.SF->Elements[0])->Expression;
 }
 
 TEST(CheckerTest, InfersIntFromIntegerLiteral) {
-  auto [Expr, Checker, DS] = checkExpression("1");
-  ASSERT_EQ(DS.countDiagnostics(), 0);
-  ASSERT_EQ(Checker.getType(Expr), Checker.getIntType());
+  auto F = checkSourceFile("1");
+  ASSERT_EQ(F.DS.countDiagnostics(), 0);
+  ASSERT_EQ(F.C.getType(getExpression(F)), F.C.getIntType());
 }
 
 TEST(CheckerTest, TestIllegalTypingVariable) {
-  auto [SF, C, DS] = checkSourceFile("let a: Int = \"foo\"");
-  ASSERT_EQ(DS.countDiagnostics(), 1);
-  auto D1 = DS.Diagnostics[0];
+  auto F = checkSourceFile("let a: Int = \"foo\"");
+  ASSERT_EQ(F.DS.countDiagnostics(), 1);
+  auto D1 = F.DS.Diagnostics[0];
   ASSERT_EQ(D1->getKind(), DiagnosticKind::UnificationError);
   auto Diag = static_cast<UnificationErrorDiagnostic*>(D1);
   // TODO these types have to be sorted first
-  ASSERT_EQ(Diag->getLeft(), C.getIntType());
-  ASSERT_EQ(Diag->getRight(), C.getStringType());
+  ASSERT_EQ(Diag->getLeft(), F.C.getIntType());
+  ASSERT_EQ(Diag->getRight(), F.C.getStringType());
 }
 
+TEST(CheckerTest, SharesThePreludeBetweenCheckers) {
+  auto F1 = checkSourceFile("let a = 1 + 2\n");
+  auto F2 = checkSourceFile("let b = 1\n");
+  ASSERT_EQ(F1.C.getIntType(), Prelude::getDefault().getIntType());
+  ASSERT_EQ(F2.C.getIntType(), Prelude::getDefault().getIntType());
+  ASSERT_EQ(F1.DS.countDiagnostics(), 0);
+  auto Let = static_cast<LetDeclaration*>(F1.SF->Elements[0]);
+  ASSERT_EQ(*F1.C.getType(static_cast<LetExprBody*>(Let->Body)->Expression), *F2.C.getIntType());
+}
+
+TEST(CheckerTest, TopLevelBindingsShadowThePrelude) {
+  auto F = checkSourceFile("let print x = x + 1\nlet a = print 1\n");
+  ASSERT_EQ(F.DS.countDiagnostics(), 0);
+}
@@ -0,0 +1,62 @@
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/ConstantFolder.hpp"
+
+#include "Helpers.hpp"
+
+using namespace bolt;
+
+static std::size_t fold(CheckedSourceFile& F) {
+  EXPECT_EQ(F.DS.countDiagnostics(), 0);
+  ConstantFolder Folder { F.C };
+  Folder.fold(F.SF);
+  return Folder.getFoldedCount();
+}
+
+static Expression* getLastExpression(SourceFile* SF) {
+  return static_cast<ExpressionStatement*>(SF->Elements.back())->Expression;
+}
+
+TEST(ConstantFolderTest, FoldsIntegerArithmetic) {
+  auto F = checkSourceFile("(1 + 2) * (10 / 5)");
+  auto FoldedCount = fold(F);
+  auto X = getLastExpression(F.SF);
+  ASSERT_EQ(X->getKind(), NodeKind::LiteralExpression);
+  ASSERT_EQ(static_cast<LiteralExpression*>(X)->getAsInt(), 6);
+  ASSERT_EQ(FoldedCount, 3);
+}
+
+TEST(ConstantFolderTest, InlinesSmallFunctionsAndVariables) {
+  auto F = checkSourceFile(
+    "let square x : Int -> Int = x * x\n"
+    "let size = 3 + 4\n"
+    "square size\n"
+  );
+  fold(F);
+  auto X = getLastExpression(F.SF);
+  ASSERT_EQ(X->getKind(), NodeKind::LiteralExpression);
+  ASSERT_EQ(static_cast<LiteralExpression*>(X)->getAsInt(), 49);
+}
+
+TEST(ConstantFolderTest, KeepsCallsToRecursiveFunctions) {
+  auto F = checkSourceFile(
+    "let loop x : Int -> Int = loop (x - 1)\n"
+    "loop 1\n"
+  );
+  auto FoldedCount = fold(F);
+  ASSERT_EQ(getLastExpression(F.SF)->getKind(), NodeKind::CallExpression);
+  ASSERT_EQ(FoldedCount, 0);
+}
+
+TEST(ConstantFolderTest, LeavesDivisionByZeroToTheEvaluator) {
+  auto F = checkSourceFile("1 / (2 - 2)");
+  fold(F);
+  auto X = getLastExpression(F.SF);
+  ASSERT_EQ(X->getKind(), NodeKind::InfixExpression);
+  Evaluator E { &F.C };
+  Env GlobalEnv;
+  ASSERT_THROW(E.evaluateExpression(X, GlobalEnv), RuntimeError);
+}
@@ -0,0 +1,68 @@
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/Diagnostics.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+
+#include "Helpers.hpp"
+
+using namespace bolt;
+
+TEST(DiagnosticsTest, StreamsJSONLines) {
+  std::ostringstream Out;
+  JSONDiagnostics DE { Out };
+  checkSourceFile("let x : Int = \"foo\"\n", DE);
+  ASSERT_TRUE(DE.hasError());
+  ASSERT_EQ(
+    Out.str(),
+    "{\"code\":2010,\"severity\":\"error\",\"message\":\"the types Int and String failed to match\","
+    "\"file\":\"#<anonymous>\",\"range\":{\"start\":{\"line\":1,\"column\":1},\"end\":{\"line\":1,\"column\":20}},"
+    "\"left\":\"Int\",\"right\":\"String\",\"fullLeft\":\"Int\",\"fullRight\":\"String\"}\n"
+  );
+}
+
+TEST(DiagnosticsTest, WritesCompleteSARIFLog) {
+  std::ostringstream Out;
+  JSONDiagnostics DE { Out, JSONDiagnosticsFormat::SARIF };
+  checkSourceFile("let x = foo\nlet y = bar\n", DE);
+  DE.finish();
+  auto Log = Out.str();
+  ASSERT_TRUE(Log.starts_with("{\"version\":\"2.1.0\""));
+  ASSERT_TRUE(Log.ends_with("]}]}\n"));
+  ASSERT_NE(Log.find("\"name\":\"foo\"}},{\"ruleId\":\"2005\""), std::string::npos);
+}
+
+static Diagnostic* addAt(DiagnosticStore& DS, const TextFile& File, std::size_t Line, std::size_t Column) {
+  DS.add<NotSupportedDiagnostic>("test", nullptr);
+  auto D = DS.Diagnostics.back();
+  D->SortKey = { File.getId(), File.getOffset(TextLoc { Line, Column }), D->getCode() };
+  return D;
+}
+
+TEST(DiagnosticsTest, SortsByLineBeforeColumn) {
+  TextFile A { "a.bolt", "let x = 1\nlet y = 2\n" };
+  DiagnosticStore DS;
+  auto D1 = addAt(DS, A, 2, 1);
+  auto D2 = addAt(DS, A, 1, 5);
+  auto D3 = addAt(DS, A, 1, 2);
+  DS.sort();
+  ASSERT_EQ(DS.Diagnostics, (std::vector<Diagnostic*> { D3, D2, D1 }));
+}
+
+TEST(DiagnosticsTest, MergesSortedStores) {
+  TextFile A { "a.bolt", "let x = 1\nlet y = 2\nlet z = 3\n" };
+  TextFile B { "b.bolt", "let x = 1\n" };
+  TextFile C { "c.bolt", "let x = 1\n" };
+  DiagnosticStore DS1;
+  DiagnosticStore DS2;
+  auto D1 = addAt(DS1, A, 3, 1);
+  auto D2 = addAt(DS1, B, 1, 1);
+  auto D3 = addAt(DS2, A, 1, 1);
+  auto D4 = addAt(DS2, C, 1, 1);
+  DS1.merge(DS2);
+  ASSERT_EQ(DS1.Diagnostics, (std::vector<Diagnostic*> { D3, D1, D2, D4 }));
+  ASSERT_EQ(DS2.countDiagnostics(), 0);
+}
@@ -0,0 +1,113 @@
+
+#include <limits>
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/Evaluator.hpp"
+
+#include "Helpers.hpp"
+
+using namespace bolt;
+
+/**
+ * Evaluate every element of \p Input and return the value of the expression
+ * at the end.
+ */
+static Value evaluateChecked(std::string Input, std::ostream& Out = std::cout) {
+  auto F = checkSourceFile(Input);
+  EXPECT_EQ(F.DS.countDiagnostics(), 0);
+  Evaluator E { &F.C, Out };
+  Env GlobalEnv;
+  addBuiltins(GlobalEnv);
+  for (std::size_t I = 0; I + 1 < F.SF->Elements.size(); I++) {
+    E.evaluate(F.SF->Elements[I], GlobalEnv);
+  }
+  auto Stmt = static_cast<ExpressionStatement*>(F.SF->Elements.back());
+  return E.evaluateExpression(Stmt->Expression, GlobalEnv);
+}
+
+TEST(EvaluatorTest, EvaluatesIntegerArithmetic) {
+  ASSERT_EQ(evaluateChecked("((1 + 2) * 3) - (8 / 2)").asInteger(), 5);
+}
+
+TEST(EvaluatorTest, IntegerAdditionWrapsAround) {
+  auto V = evaluateChecked("9223372036854775807 + 1");
+  ASSERT_EQ(V.asInteger(), std::numeric_limits<Integer>::min());
+}
+
+TEST(EvaluatorTest, CallsBuiltinPrint) {
+  std::ostringstream Out;
+  evaluateChecked("print \"foo\"", Out);
+  ASSERT_EQ(Out.str(), "foo\n");
+}
+
+static Integer twice(Context& Ctx, Integer X) {
+  return X * 2;
+}
+
+TEST(EvaluatorTest, CallsRegisteredNativeFunction) {
+  Env GlobalEnv;
+  GlobalEnv.addNative<twice>("twice");
+  Evaluator E;
+  Value Args[1] { Integer(21) };
+  ASSERT_EQ(E.apply(GlobalEnv.lookup("twice"), Args).asInteger(), 42);
+}
+
+TEST(EvaluatorTest, RejectsNativeCallsWithTheWrongNumberOfArguments) {
+  Env GlobalEnv;
+  GlobalEnv.addNative<twice>("twice");
+  Evaluator E;
+  Value Args[2] { Integer(21), Integer(1) };
+  ASSERT_THROW(E.apply(GlobalEnv.lookup("twice"), Args), RuntimeError);
+  ASSERT_THROW(E.apply(GlobalEnv.lookup("twice"), std::span<const Value>()), RuntimeError);
+}
+
+TEST(EvaluatorTest, CallsOtherTopLevelFunctions) {
+  ASSERT_EQ(evaluateChecked("let f x = x + 1\nlet g y = f y\ng 3").asInteger(), 4);
+}
+
+TEST(EvaluatorTest, CallsBuiltinsFromFunctions) {
+  std::ostringstream Out;
+  evaluateChecked("let p x = print x\np \"hi\"", Out);
+  ASSERT_EQ(Out.str(), "hi\n");
+}
+
+TEST(EvaluatorTest, CallsRecursiveFunctions) {
+  auto V = evaluateChecked(
+    "let fact n : Int -> Int = match n.\n"
+    "  0 => 1\n"
+    "  _ => n * fact (n - 1)\n"
+    "fact 10\n"
+  );
+  ASSERT_EQ(V.asInteger(), 3628800);
+}
+
+TEST(EvaluatorTest, EvaluatesTopLevelVariablesThatCallFunctions) {
+  std::ostringstream Out;
+  evaluateChecked(
+    "let f x = x + 1\n"
+    "let g y = f y * 2\n"
+    "let x = g 3\n"
+    "let describe n : Int -> String = match n.\n"
+    "  8 => \"eight\"\n"
+    "  _ => \"other\"\n"
+    "print (describe x)\n",
+    Out
+  );
+  ASSERT_EQ(Out.str(), "eight\n");
+}
+
+TEST(EvaluatorTest, ReportsDivisionByZero) {
+  ASSERT_THROW(evaluateChecked("1 / (2 - 2)"), RuntimeError);
+}
+
+TEST(EvaluatorTest, DerivesTheTypesOfBuiltinsFromTheirSignature) {
+  auto& P = Prelude::getDefault();
+  auto Add = static_cast<Forall*>(P.lookup("+"));
+  ASSERT_EQ(*Add->Type, *TArrow::build({ P.getIntType(), P.getIntType() }, P.getIntType()));
+  auto Print = static_cast<Forall*>(P.lookup("print"));
+  ASSERT_EQ(*Print->Type, *TArrow::build({ P.getStringType() }, new TTuple({})));
+}
@@ -0,0 +1,32 @@
+
+#include "gtest/gtest.h"
+
+#include "bolt/JSON.hpp"
+
+using namespace bolt;
+
+TEST(JSONTest, ParsesNestedValues) {
+  auto Value = JSONValue::parse(R"({ "a": [1, -2.5e1, true, null], "b": { "c": "x\né😀" } })");
+  ASSERT_TRUE(Value);
+  ASSERT_TRUE(Value->isObject());
+  auto A = Value->get("a");
+  ASSERT_NE(A, nullptr);
+  ASSERT_EQ(A->getElements().size(), 4);
+  ASSERT_EQ(A->getElements()[0].asNumber(), 1);
+  ASSERT_EQ(A->getElements()[1].asNumber(), -25);
+  ASSERT_TRUE(A->getElements()[2].asBoolean());
+  ASSERT_TRUE(A->getElements()[3].isNull());
+  auto C = Value->get({ "b", "c" });
+  ASSERT_NE(C, nullptr);
+  ASSERT_EQ(C->asString(), "x\n\xC3\xA9\xF0\x9F\x98\x80");
+  ASSERT_EQ(Value->get({ "b", "d" }), nullptr);
+}
+
+TEST(JSONTest, RejectsInvalidDocuments) {
+  ASSERT_FALSE(JSONValue::parse(""));
+  ASSERT_FALSE(JSONValue::parse("{\"a\":}"));
+  ASSERT_FALSE(JSONValue::parse("[1, 2"));
+  ASSERT_FALSE(JSONValue::parse("\"unterminated"));
+  ASSERT_FALSE(JSONValue::parse("1 2"));
+  ASSERT_FALSE(JSONValue::parse(std::string(1000, '[')));
+}
@@ -0,0 +1,109 @@
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "bolt/LanguageServer.hpp"
+
+using namespace bolt;
+
+static std::string frame(const std::string& Message) {
+  return "Content-Length: " + std::to_string(Message.size()) + "\r\n\r\n" + Message;
+}
+
+static std::string notify(LanguageServer& Server, std::ostringstream& Out, const std::string& Message) {
+  Out.str("");
+  Server.handle(*JSONValue::parse(Message));
+  return Out.str();
+}
+
+TEST(LanguageServerTest, PublishesDiagnosticsAfterEdits) {
+  LanguageConfig Config;
+  std::ostringstream Out;
+  LanguageServer Server { Config, Out };
+
+  auto Opened = notify(Server, Out, R"({"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"file:///a.bolt","text":"let a : Int = \"foo\"\n"}}})");
+  ASSERT_NE(Opened.find("textDocument/publishDiagnostics"), std::string::npos);
+  ASSERT_NE(Opened.find("\"code\":2010"), std::string::npos);
+  ASSERT_NE(Opened.find("\"start\":{\"line\":0"), std::string::npos);
+
+  // Replace "foo" including its quotes with 1
+  auto Changed = notify(Server, Out, R"({"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":"file:///a.bolt","version":2},"contentChanges":[{"range":{"start":{"line":0,"character":14},"end":{"line":0,"character":19}},"text":"1"}]}})");
+  ASSERT_NE(Changed.find("\"diagnostics\":[]"), std::string::npos);
+  ASSERT_EQ(Server.getRebuildCount(), 2);
+
+  auto Hover = notify(Server, Out, R"({"jsonrpc":"2.0","id":7,"method":"textDocument/hover","params":{"textDocument":{"uri":"file:///a.bolt"},"position":{"line":0,"character":14}}})");
+  ASSERT_NE(Hover.find("\"id\":7"), std::string::npos);
+  ASSERT_NE(Hover.find("\"value\":\"Int\""), std::string::npos);
+}
+
+TEST(LanguageServerTest, FollowsTheLifecycle) {
+  LanguageConfig Config;
+  std::ostringstream Out;
+  LanguageServer Server { Config, Out };
+  std::istringstream In {
+    frame(R"({"jsonrpc":"2.0","id":1,"method":"initialize","params":{}})")
+    + frame(R"({"jsonrpc":"2.0","id":"two","method":"workspace/symbol","params":{}})")
+    + frame(R"({"jsonrpc":"2.0","id":3,"method":"shutdown"})")
+    + frame(R"({"jsonrpc":"2.0","method":"exit"})")
+  };
+  ASSERT_EQ(Server.serve(In), 0);
+  auto Output = Out.str();
+  ASSERT_NE(Output.find("\"hoverProvider\":true"), std::string::npos);
+  ASSERT_NE(Output.find("\"id\":\"two\",\"error\":{\"code\":-32601"), std::string::npos);
+  ASSERT_NE(Output.find("\"id\":3,\"result\":null"), std::string::npos);
+}
+
+// The literal 1 starts at byte 21, but at UTF-16 code unit 18, because é
+// takes up two bytes and 😀 takes up four bytes and a surrogate pair.
+static const std::string UnicodeDocument = R"({"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"file:///u.bolt","text":"let f x : Int -> Int = x\nlet a = (\"é😀\", f 1)\n"}}})";
+
+TEST(LanguageServerTest, CountsUTF16CodeUnitsByDefault) {
+  LanguageConfig Config;
+  std::ostringstream Out;
+  LanguageServer Server { Config, Out };
+  auto Initialized = notify(Server, Out, R"({"jsonrpc":"2.0","id":1,"method":"initialize","params":{"capabilities":{}}})");
+  ASSERT_NE(Initialized.find("\"positionEncoding\":\"utf-16\""), std::string::npos);
+  notify(Server, Out, UnicodeDocument);
+  auto Hover = notify(Server, Out, R"({"jsonrpc":"2.0","id":2,"method":"textDocument/hover","params":{"textDocument":{"uri":"file:///u.bolt"},"position":{"line":1,"character":18}}})");
+  ASSERT_NE(Hover.find("\"value\":\"Int\""), std::string::npos);
+  ASSERT_NE(Hover.find("{\"start\":{\"line\":1,\"character\":18},\"end\":{\"line\":1,\"character\":19}}"), std::string::npos);
+}
+
+TEST(LanguageServerTest, CountsBytesWhenTheClientSupportsUTF8) {
+  LanguageConfig Config;
+  std::ostringstream Out;
+  LanguageServer Server { Config, Out };
+  auto Initialized = notify(Server, Out, R"({"jsonrpc":"2.0","id":1,"method":"initialize","params":{"capabilities":{"general":{"positionEncodings":["utf-8","utf-16"]}}}})");
+  ASSERT_NE(Initialized.find("\"positionEncoding\":\"utf-8\""), std::string::npos);
+  notify(Server, Out, UnicodeDocument);
+  auto Hover = notify(Server, Out, R"({"jsonrpc":"2.0","id":2,"method":"textDocument/hover","params":{"textDocument":{"uri":"file:///u.bolt"},"position":{"line":1,"character":21}}})");
+  ASSERT_NE(Hover.find("\"value\":\"Int\""), std::string::npos);
+  ASSERT_NE(Hover.find("{\"start\":{\"line\":1,\"character\":21},\"end\":{\"line\":1,\"character\":22}}"), std::string::npos);
+}
+
+TEST(LanguageServerTest, PublishesDiagnosticsOfIncompleteDeclarations) {
+  LanguageConfig Config;
+  std::ostringstream Out;
+  LanguageServer Server { Config, Out };
+  auto Opened = notify(Server, Out, R"({"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"file:///a.bolt","text":"let z =\n"}}})");
+  ASSERT_NE(Opened.find("\"code\":1101"), std::string::npos);
+  auto Unterminated = notify(Server, Out, R"({"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"file:///b.bolt","text":"let z = \"s\n"}}})");
+  ASSERT_NE(Unterminated.find("textDocument/publishDiagnostics"), std::string::npos);
+  ASSERT_EQ(Unterminated.find("\"diagnostics\":[]"), std::string::npos);
+}
+
+TEST(LanguageServerTest, PublishesDiagnosticsWhileADeclarationIsTyped) {
+  LanguageConfig Config;
+  std::ostringstream Out;
+  LanguageServer Server { Config, Out };
+  auto Opened = notify(Server, Out, R"({"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"file:///a.bolt","text":"let z = 1\n"}}})");
+  ASSERT_NE(Opened.find("\"diagnostics\":[]"), std::string::npos);
+  // Remove the 1
+  auto Removed = notify(Server, Out, R"({"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":"file:///a.bolt","version":2},"contentChanges":[{"range":{"start":{"line":0,"character":8},"end":{"line":0,"character":9}},"text":""}]}})");
+  ASSERT_NE(Removed.find("\"code\":1101"), std::string::npos);
+  // Hovering does not change the text, so the same diagnostics stay around
+  notify(Server, Out, R"({"jsonrpc":"2.0","id":3,"method":"textDocument/hover","params":{"textDocument":{"uri":"file:///a.bolt"},"position":{"line":0,"character":4}}})");
+  auto Typed = notify(Server, Out, R"({"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":"file:///a.bolt","version":3},"contentChanges":[{"range":{"start":{"line":0,"character":8},"end":{"line":0,"character":8}},"text":"2"}]}})");
+  ASSERT_NE(Typed.find("\"diagnostics\":[]"), std::string::npos);
+}
@@ -0,0 +1,210 @@
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/MatchCompiler.hpp"
+#include "bolt/Evaluator.hpp"
+
+#include "Helpers.hpp"
+
+using namespace bolt;
+
+static MatchExpression* getLastMatch(SourceFile* SF) {
+  auto Stmt = static_cast<ExpressionStatement*>(SF->Elements.back());
+  return static_cast<MatchExpression*>(Stmt->Expression);
+}
+
+TEST(MatchCompilerTest, DispatchesOnEnumThroughTable) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile(
+    "enum Color.\n"
+    "  Red\n"
+    "  Green\n"
+    "  Blue\n"
+    "  Cyan\n"
+    "match Blue.\n"
+    "  Cyan => 1\n"
+    "  Red => 2\n"
+    "  _ => 3\n",
+    DS
+  );
+  auto M = getLastMatch(SF);
+  MatchCompiler Compiler;
+  auto Tree = Compiler.compile(M);
+  ASSERT_EQ(Tree->getKind(), DecisionKind::Switch);
+  auto Switch = static_cast<DecisionSwitch*>(Tree);
+  ASSERT_EQ(Switch->Test, SwitchKind::Constructor);
+  ASSERT_EQ(Switch->Table.size(), 4);
+  ASSERT_EQ(static_cast<DecisionLeaf*>(Switch->getCase(3))->Case, M->Cases[0]);
+  ASSERT_EQ(static_cast<DecisionLeaf*>(Switch->getCase(0))->Case, M->Cases[1]);
+  ASSERT_EQ(static_cast<DecisionLeaf*>(Switch->getCase(1))->Case, M->Cases[2]);
+  ASSERT_EQ(Switch->getCase(1), Switch->getCase(2));
+  SF->unref();
+}
+
+TEST(MatchCompilerTest, TestsEachValueOnlyOnce) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile(
+    "match (1, 2).\n"
+    "  (1, 1) => 1\n"
+    "  (1, 2) => 2\n"
+    "  (2, _) => 3\n",
+    DS
+  );
+  auto M = getLastMatch(SF);
+  MatchCompiler Compiler;
+  auto Tree = Compiler.compile(M);
+  ASSERT_EQ(Tree->getKind(), DecisionKind::Switch);
+  auto Outer = static_cast<DecisionSwitch*>(Tree);
+  ASSERT_EQ(Outer->Path, MatchPath { 0 });
+  ASSERT_EQ(Outer->Cases.size(), 2);
+  ASSERT_EQ(Outer->Default->getKind(), DecisionKind::Fail);
+  auto Inner = static_cast<DecisionSwitch*>(Outer->getCase(LiteralValue(Integer(1))));
+  ASSERT_EQ(Inner->Path, MatchPath { 1 });
+  ASSERT_EQ(Inner->Cases.size(), 2);
+  auto Last = static_cast<DecisionLeaf*>(Outer->getCase(LiteralValue(Integer(2))));
+  ASSERT_EQ(Last->getKind(), DecisionKind::Leaf);
+  ASSERT_EQ(Last->Case, M->Cases[2]);
+  SF->unref();
+}
+
+TEST(MatchCompilerTest, EvaluatesMatchOnConstructorFields) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile(
+    "enum Shape.\n"
+    "  Square Int\n"
+    "  Rect Int Int\n"
+    "match Rect 3 4.\n"
+    "  Square s => s\n"
+    "  Rect 3 h => h\n"
+    "  Rect w _ => w\n",
+    DS
+  );
+  Evaluator E;
+  Env GlobalEnv;
+  E.evaluate(SF->Elements[0], GlobalEnv);
+  auto V = E.evaluateExpression(getLastMatch(SF), GlobalEnv);
+  ASSERT_EQ(V.asInteger(), 4);
+  SF->unref();
+}
+
+TEST(MatchCompilerTest, EvaluatesMatchWithoutValueToAFunction) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile(
+    "enum Color.\n"
+    "  Red\n"
+    "  Green\n"
+    "let f = match.\n"
+    "  Red => 1\n"
+    "  Green => 2\n"
+    "f Green\n",
+    DS
+  );
+  Evaluator E;
+  Env GlobalEnv;
+  E.evaluate(SF->Elements[0], GlobalEnv);
+  E.evaluate(SF->Elements[1], GlobalEnv);
+  auto Stmt = static_cast<ExpressionStatement*>(SF->Elements[2]);
+  ASSERT_EQ(E.evaluateExpression(Stmt->Expression, GlobalEnv).asInteger(), 2);
+  SF->unref();
+}
+
+/**
+ * Evaluate every element of \p SF and return the value of the expression at
+ * the end.
+ */
+static Value evaluateElements(SourceFile* SF) {
+  Evaluator E;
+  Env GlobalEnv;
+  addBuiltins(GlobalEnv);
+  for (std::size_t I = 0; I + 1 < SF->Elements.size(); I++) {
+    E.evaluate(SF->Elements[I], GlobalEnv);
+  }
+  auto Stmt = static_cast<ExpressionStatement*>(SF->Elements.back());
+  return E.evaluateExpression(Stmt->Expression, GlobalEnv);
+}
+
+TEST(MatchCompilerTest, EvaluatesRecursiveMatchFunction) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile(
+    "enum List.\n"
+    "  Nil\n"
+    "  Cons Int List\n"
+    "let sum = match.\n"
+    "  Nil => 0\n"
+    "  Cons x rest => x + sum rest\n"
+    "sum (Cons 1 (Cons 2 (Cons 3 Nil)))\n",
+    DS
+  );
+  ASSERT_EQ(evaluateElements(SF).asInteger(), 6);
+  SF->unref();
+}
+
+TEST(MatchCompilerTest, KeepsTheParametersOfTheFunctionThatReturnedAMatch) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile(
+    "let add n = match.\n"
+    "  0 => n\n"
+    "  m => n + m\n"
+    "let addTwo = add 2\n"
+    "addTwo 3\n",
+    DS
+  );
+  ASSERT_EQ(evaluateElements(SF).asInteger(), 5);
+  SF->unref();
+}
+
+TEST(MatchCompilerTest, ReportsWhenNoCaseApplies) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile(
+    "enum Color.\n"
+    "  Red\n"
+    "  Green\n"
+    "match Green.\n"
+    "  Red => 1\n",
+    DS
+  );
+  Evaluator E;
+  Env GlobalEnv;
+  E.evaluate(SF->Elements[0], GlobalEnv);
+  ASSERT_THROW(E.evaluateExpression(getLastMatch(SF), GlobalEnv), RuntimeError);
+  SF->unref();
+}
+
+TEST(MatchCompilerTest, ReportsConstructorsWithoutADeclaration) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile(
+    "match 1.\n"
+    "  Red => 1\n"
+    "  _ => 2\n",
+    DS
+  );
+  auto M = getLastMatch(SF);
+  MatchCompiler Compiler;
+  ASSERT_EQ(Compiler.compile(M), nullptr);
+  ASSERT_EQ(Compiler.getUnknownConstructor(), M->Cases[0]->Pattern);
+  Evaluator E;
+  Env GlobalEnv;
+  ASSERT_THROW(E.evaluateExpression(M, GlobalEnv), RuntimeError);
+  SF->unref();
+}
+
+
+TEST(MatchCompilerTest, CompilesConstructorWithTheNameOfItsType) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile(
+    "enum Box.\n"
+    "  Box Int\n"
+    "  Empty\n"
+    "match Empty.\n"
+    "  Box x => 1\n"
+    "  Empty => 2\n",
+    DS
+  );
+  MatchCompiler Compiler;
+  auto Tree = Compiler.compile(getLastMatch(SF));
+  ASSERT_EQ(Tree->getKind(), DecisionKind::Switch);
+  ASSERT_EQ(static_cast<DecisionSwitch*>(Tree)->Test, SwitchKind::Constructor);
+  SF->unref();
+}
@@ -0,0 +1,110 @@
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/Diagnostics.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/ModuleInterface.hpp"
+
+#include "Helpers.hpp"
+
+using namespace bolt;
+
+static ByteString getMathInterface() {
+  DiagnosticStore DS;
+  LanguageConfig Config;
+  auto SF = parseSourceFile(
+    "pub let add x y = x + y\n"
+    "pub let twice f x = f (f x)\n"
+    "let hidden = 1\n"
+    "pub enum Color.\n"
+    "  Red\n"
+    "  Green\n",
+    DS
+  );
+  Checker C { Config, DS };
+  C.check(SF);
+  EXPECT_EQ(DS.countDiagnostics(), 0);
+  ByteString Out;
+  C.writeInterface(SF, "Math", Out);
+  return Out;
+}
+
+TEST(ModuleInterfaceTest, ChecksAgainstLoadedInterfaces) {
+  auto Interface = getMathInterface();
+  // The same module always produces the same interface
+  ASSERT_EQ(Interface, getMathInterface());
+
+  DiagnosticStore DS;
+  LanguageConfig Config;
+  auto SF = parseSourceFile(
+    "let a = Math.add 1 2\n"
+    "let b : Math.Color = Math.Red\n"
+    "let c = Math.twice (Math.add 1) 3\n",
+    DS
+  );
+  ASSERT_EQ(getImportedModules(SF), std::vector<ByteString> { "Math" });
+  Checker C { Config, DS };
+  ASSERT_TRUE(C.loadInterface(Interface));
+  C.check(SF);
+  ASSERT_EQ(DS.countDiagnostics(), 0);
+}
+
+TEST(ModuleInterfaceTest, ReportsMisuseOfOtherModules) {
+  DiagnosticStore DS;
+  LanguageConfig Config;
+  auto SF = parseSourceFile(
+    "let a = Math.add \"x\" 2\n"
+    "let b = Math.hidden\n"
+    "let c = Nope.foo\n",
+    DS
+  );
+  Checker C { Config, DS };
+  ASSERT_TRUE(C.loadInterface(getMathInterface()));
+  C.check(SF);
+  DS.sort();
+  ASSERT_EQ(DS.countDiagnostics(), 3);
+  ASSERT_EQ(DS.Diagnostics[0]->getKind(), DiagnosticKind::UnificationError);
+  ASSERT_EQ(static_cast<BindingNotFoundDiagnostic*>(DS.Diagnostics[1])->Name, "Math.hidden");
+  ASSERT_EQ(static_cast<BindingNotFoundDiagnostic*>(DS.Diagnostics[2])->Name, "Nope.foo");
+}
+
+TEST(ModuleInterfaceTest, RejectsCorruptInterfaces) {
+  auto Interface = getMathInterface();
+  DiagnosticStore DS;
+  LanguageConfig Config;
+  Checker C { Config, DS };
+  ASSERT_FALSE(C.loadInterface(""));
+  ASSERT_FALSE(C.loadInterface(Interface.substr(0, Interface.size() - 1)));
+  ASSERT_FALSE(C.hasModule("Math"));
+  ASSERT_TRUE(C.loadInterface(Interface));
+  ASSERT_TRUE(C.hasModule("Math"));
+}
+
+static ByteString getInterface(std::string Input) {
+  DiagnosticStore DS;
+  LanguageConfig Config;
+  auto SF = parseSourceFile(Input, DS);
+  Checker C { Config, DS };
+  C.check(SF);
+  ByteString Out;
+  C.writeInterface(SF, "Math", Out);
+  return Out;
+}
+
+TEST(ModuleInterfaceTest, StampsOnlyChangeWithTheInterfacesOfImports) {
+  LanguageConfig Config;
+  auto Old = getInterface("pub let add x y = x + y\n");
+  // Only the body changed, which gives the same interface
+  auto Same = getInterface("pub let add x y = y + x\n");
+  auto New = getInterface("pub let add x = x + 1\n");
+  ASSERT_EQ(Old, Same);
+  ByteString Text = "let z = Math.add 1 2\n";
+  auto Stamp = getModuleStamp(Config, Text, { { "Math", Old } });
+  ASSERT_EQ(Stamp.size(), 17);
+  ASSERT_EQ(getModuleStamp(Config, Text, { { "Math", Same } }), Stamp);
+  ASSERT_NE(getModuleStamp(Config, Text, { { "Math", New } }), Stamp);
+  ASSERT_NE(getModuleStamp(Config, Text, { { "Math", "" } }), Stamp);
+  ASSERT_NE(getModuleStamp(Config, "let z = Math.add 2 1\n", { { "Math", Old } }), Stamp);
+}
@@ -0,0 +1,140 @@
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/Diagnostics.hpp"
+#include "bolt/Parser.hpp"
+#include "bolt/Checker.hpp"
+
+#include "Helpers.hpp"
+
+using namespace bolt;
+
+TEST(ParserTest, KeepsDeclarationsWithABrokenBody) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile("let x = ) 1\nlet y = x + 1\n", DS);
+  ASSERT_EQ(DS.countDiagnostics(), 1);
+  ASSERT_EQ(SF->Elements.size(), 2);
+  auto Let = static_cast<LetDeclaration*>(SF->Elements[0]);
+  ASSERT_EQ(Let->Body->getKind(), NodeKind::LetExprBody);
+  auto Body = static_cast<LetExprBody*>(Let->Body)->Expression;
+  ASSERT_EQ(Body->getKind(), NodeKind::InvalidExpression);
+  ASSERT_EQ(static_cast<InvalidExpression*>(Body)->Tokens.size(), 2);
+  ASSERT_EQ(Body->getFirstToken()->getKind(), NodeKind::RParen);
+  ASSERT_EQ(Body->getLastToken()->getKind(), NodeKind::IntegerLiteral);
+}
+
+TEST(ParserTest, KeepsTheTokensOfBrokenElements) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile("let a = 1\nstruct ) bad\nlet b = a\n", DS);
+  ASSERT_EQ(DS.countDiagnostics(), 1);
+  ASSERT_EQ(SF->Elements.size(), 3);
+  ASSERT_EQ(SF->Elements[1]->getKind(), NodeKind::ExpressionStatement);
+  auto Invalid = static_cast<ExpressionStatement*>(SF->Elements[1])->Expression;
+  ASSERT_EQ(Invalid->getKind(), NodeKind::InvalidExpression);
+  ASSERT_EQ(Invalid->getFirstToken()->getStartLine(), 2);
+  ASSERT_EQ(Invalid->Parent, SF->Elements[1]);
+}
+
+TEST(ParserTest, ChecksTheValidPartsOfABrokenFile) {
+  DiagnosticStore DS;
+  LanguageConfig Config;
+  auto SF = parseSourceFile("let x = 1 + )\nlet y : String = x\nlet f a =\n  return )\n", DS);
+  ASSERT_EQ(DS.countDiagnostics(), 2);
+  Checker C { Config, DS };
+  C.check(SF);
+  // The broken declarations do not cause any errors of their own
+  ASSERT_EQ(DS.countDiagnostics(), 2);
+}
+
+/**
+ * Parse \p Input the way a language server does, by editing an empty file.
+ */
+static SourceFile* createSourceFile(std::string Input, DiagnosticStore& DS) {
+  TextFile Empty { "#<anonymous>", "" };
+  auto SF = new SourceFile(Empty, {});
+  reparseSourceFile(SF, 0, 0, Input, DS);
+  return SF;
+}
+
+TEST(ParserTest, ReparsesOnlyTheEditedElement) {
+  DiagnosticStore DS;
+  auto SF = createSourceFile("let a = 1\nlet b = 2\nlet c = 3\n", DS);
+  ASSERT_EQ(SF->Elements.size(), 3);
+  auto A = SF->Elements[0];
+  auto C = SF->Elements[2];
+  ASSERT_EQ(reparseSourceFile(SF, 18, 19, "20", DS), 1);
+  ASSERT_EQ(SF->getTextFile().getText(), "let a = 1\nlet b = 20\nlet c = 3\n");
+  ASSERT_EQ(SF->Elements.size(), 3);
+  ASSERT_EQ(SF->Elements[0], A);
+  ASSERT_EQ(SF->Elements[2], C);
+  auto B = static_cast<LetDeclaration*>(SF->Elements[1]);
+  ASSERT_EQ(B->Parent, SF);
+  auto Body = static_cast<LetExprBody*>(B->Body)->Expression;
+  auto Literal = static_cast<LiteralExpression*>(Body)->Token;
+  ASSERT_EQ(static_cast<IntegerLiteral*>(Literal)->getInteger(), 20);
+  ASSERT_EQ(Literal->getStartLoc().Line, 2);
+  ASSERT_EQ(Literal->getStartLoc().Column, 9);
+  ASSERT_EQ(DS.countDiagnostics(), 0);
+  SF->unref();
+}
+
+TEST(ParserTest, MovesTheElementsAfterAnEdit) {
+  DiagnosticStore DS;
+  LanguageConfig Config;
+  auto SF = createSourceFile("let a = 1\n\nlet b = a\n", DS);
+  auto B = SF->Elements[1];
+  ASSERT_EQ(reparseSourceFile(SF, 10, 10, "let x = a\nlet y = x\n", DS), 3);
+  ASSERT_EQ(SF->Elements.size(), 4);
+  ASSERT_EQ(SF->Elements[3], B);
+  ASSERT_EQ(B->getStartLine(), 5);
+  ASSERT_EQ(SF->getTextFile().getStartOffsetOfLine(5), 31);
+  Checker Ch { Config, DS };
+  Ch.check(SF);
+  ASSERT_EQ(DS.countDiagnostics(), 0);
+  SF->unref();
+}
+
+TEST(ParserTest, ReparsesEverythingWhenABraceIsLeftOpen) {
+  DiagnosticStore DS;
+  auto SF = createSourceFile("let a = 1\nlet b = 2\nlet c = 3\n", DS);
+  ASSERT_EQ(reparseSourceFile(SF, 18, 19, "{ a = 2", DS), 2);
+  ASSERT_EQ(SF->Elements.size(), 2);
+  ASSERT_EQ(SF->Elements[1]->getEndLine(), 3);
+  SF->unref();
+}
+
+TEST(ParserTest, KeepsTheDiagnosticsOfAHalfTypedDeclaration) {
+  DiagnosticStore DS;
+  auto SF = createSourceFile("let a = 1\nlet z = 1\n", DS);
+  ASSERT_EQ(DS.countDiagnostics(), 0);
+  reparseSourceFile(SF, 18, 19, "", DS);
+  ASSERT_EQ(DS.countDiagnostics(), 1);
+  ASSERT_EQ(DS.Diagnostics[0]->getKind(), DiagnosticKind::UnexpectedToken);
+  auto Start = getLocation(*DS.Diagnostics[0]).Range.Start;
+  ASSERT_GE(Start.Line, 2);
+  // Editing another element keeps the diagnostic, together with its token
+  reparseSourceFile(SF, 8, 9, "3", DS);
+  ASSERT_EQ(DS.countDiagnostics(), 1);
+  ASSERT_EQ(getLocation(*DS.Diagnostics[0]).Range.Start.Line, Start.Line);
+  ASSERT_EQ(getLocation(*DS.Diagnostics[0]).Range.Start.Column, Start.Column);
+  reparseSourceFile(SF, 18, 18, "2", DS);
+  ASSERT_EQ(SF->getTextFile().getText(), "let a = 3\nlet z = 2\n");
+  ASSERT_EQ(DS.countDiagnostics(), 0);
+  SF->unref();
+}
+
+TEST(ParserTest, ReplacesTheDiagnosticsOfTheEditedElement) {
+  DiagnosticStore DS;
+  auto SF = createSourceFile("let a = )\nlet b = 1 `\n", DS);
+  ASSERT_EQ(DS.countDiagnostics(), 2);
+  reparseSourceFile(SF, 8, 9, "1", DS);
+  ASSERT_EQ(DS.countDiagnostics(), 1);
+  ASSERT_EQ(getLocation(*DS.Diagnostics[0]).Range.Start.Line, 2);
+  reparseSourceFile(SF, 0, 0, "\n\n", DS);
+  ASSERT_EQ(DS.countDiagnostics(), 1);
+  ASSERT_EQ(getLocation(*DS.Diagnostics[0]).Range.Start.Line, 4);
+  ASSERT_EQ(DS.Diagnostics[0]->SortKey.Offset, SF->getTextFile().getOffset(getLocation(*DS.Diagnostics[0]).Range.Start));
+  SF->unref();
+}
@@ -0,0 +1,79 @@
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "bolt/Support/Graph.hpp"
+#include "bolt/Support/Scheduler.hpp"
+
+using namespace bolt;
+
+TEST(SchedulerTest, RunsDependenciesFirst) {
+  Graph<std::string> G;
+  G.addEdge("main", "math");
+  G.addEdge("main", "text");
+  G.addEdge("text", "math");
+  G.addVertex("other");
+  std::mutex Mutex;
+  std::vector<std::string> Order;
+  auto Result = runInDependencyOrder(G, 4, [&](const std::vector<std::string>& SCC) {
+    ASSERT_EQ(SCC.size(), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::lock_guard Lock { Mutex };
+    Order.push_back(SCC.front());
+  });
+  auto Position = [&](const std::string& Name) {
+    return std::find(Order.begin(), Order.end(), Name) - Order.begin();
+  };
+  ASSERT_EQ(Order.size(), 4);
+  ASSERT_LT(Position("math"), Position("text"));
+  ASSERT_LT(Position("text"), Position("main"));
+  ASSERT_EQ(Result.CriticalPathLength, 3);
+  ASSERT_LE(Result.CriticalPathTime, Result.TotalTime);
+}
+
+TEST(SchedulerTest, GroupsCyclesIntoOneTask) {
+  Graph<int> G;
+  G.addEdge(1, 2);
+  G.addEdge(2, 1);
+  G.addEdge(3, 1);
+  std::atomic<std::size_t> TaskCount = 0;
+  std::atomic<std::size_t> CycleSize = 0;
+  runInDependencyOrder(G, 2, [&](const std::vector<int>& SCC) {
+    TaskCount++;
+    if (SCC.size() > 1) {
+      CycleSize = SCC.size();
+    }
+  });
+  ASSERT_EQ(TaskCount, 2);
+  ASSERT_EQ(CycleSize, 2);
+}
+
+TEST(SchedulerTest, RunsIndependentTasksConcurrently) {
+  Graph<int> G;
+  G.addVertex(1);
+  G.addVertex(2);
+  std::atomic<std::size_t> Waiting = 0;
+  // Each task waits for the other one to have started, which can only
+  // happen when they run at the same time.
+  runInDependencyOrder(G, 2, [&](const std::vector<int>& SCC) {
+    Waiting++;
+    while (Waiting < 2) {
+      std::this_thread::yield();
+    }
+  });
+  ASSERT_EQ(Waiting, 2);
+}
+
+TEST(SchedulerTest, AcceptsAnEmptyGraph) {
+  Graph<int> G;
+  auto Result = runInDependencyOrder(G, 4, [&](const std::vector<int>& SCC) {
+    FAIL();
+  });
+  ASSERT_EQ(Result.CriticalPathLength, 0);
+}
@@ -0,0 +1,40 @@
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+
+#include "Helpers.hpp"
+
+using namespace bolt;
+
+TEST(ScopeTest, FindsConstructorWithTheNameOfItsType) {
+  DiagnosticStore DS;
+  auto SF = parseSourceFile(
+    "enum Box.\n"
+    "  Box Int\n"
+    "  Empty\n",
+    DS
+  );
+  auto Scope = SF->getScope();
+  ASSERT_EQ(Scope->lookup({ {}, "Box" }, SymbolKind::Type), SF->Elements[0]);
+  ASSERT_EQ(Scope->lookup({ {}, "Box" }, SymbolKind::Constructor), SF->Elements[0]);
+  ASSERT_EQ(Scope->lookup({ {}, "Box" }), nullptr);
+  SF->unref();
+}
+
+TEST(ScopeTest, FindsConstructorsInLargeScopes) {
+  std::string Input = "enum Many.\n";
+  for (int I = 0; I < 100; I++) {
+    Input += "  C" + std::to_string(I) + "\n";
+  }
+  DiagnosticStore DS;
+  auto SF = parseSourceFile(Input, DS);
+  auto Scope = SF->getScope();
+  for (int I = 0; I < 100; I++) {
+    ASSERT_EQ(Scope->lookup({ {}, "C" + std::to_string(I) }, SymbolKind::Constructor), SF->Elements[0]);
+  }
+  ASSERT_EQ(Scope->lookup({ {}, "Many" }, SymbolKind::Type), SF->Elements[0]);
+  ASSERT_EQ(Scope->lookup({ {}, "C100" }, SymbolKind::Constructor), nullptr);
+  SF->unref();
+}
@@ -0,0 +1,57 @@
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "bolt/Server.hpp"
+
+using namespace bolt;
+
+static void writeFile(const std::string& Path, const std::string& Text) {
+  std::ofstream File(Path);
+  File << Text;
+}
+
+static std::string request(CompileServer& Server, std::string Request) {
+  std::ostringstream Out;
+  Server.handle(Request, Out);
+  return Out.str();
+}
+
+TEST(ServerTest, ReusesFilesThatDidNotChange) {
+  auto Path = (std::filesystem::temp_directory_path() / "bolt-server-test.bolt").string();
+  writeFile(Path, "let a : Int = \"foo\"\n");
+  LanguageConfig Config;
+  CompileServer Server { Config };
+
+  auto First = request(Server, "check " + Path);
+  ASSERT_NE(First.find("\"code\":2010"), std::string::npos);
+  ASSERT_EQ(Server.getRebuildCount(), 1);
+
+  auto Second = request(Server, "check " + Path);
+  ASSERT_EQ(Server.getRebuildCount(), 1);
+  ASSERT_NE(Second.find("\"code\":2010"), std::string::npos);
+
+  writeFile(Path, "let a : Int = 1\n");
+  request(Server, "changed " + Path);
+  auto Third = request(Server, "check " + Path);
+  ASSERT_EQ(Server.getRebuildCount(), 2);
+  ASSERT_EQ(Third.find("\"code\""), std::string::npos);
+  ASSERT_NE(Third.find("\"status\":\"ok\""), std::string::npos);
+
+  std::filesystem::remove(Path);
+}
+
+TEST(ServerTest, ReportsMissingFilesAndUnknownRequests) {
+  LanguageConfig Config;
+  CompileServer Server { Config };
+  auto Missing = request(Server, "check /nonexistent/file.bolt");
+  ASSERT_NE(Missing.find("\"status\":\"error\""), std::string::npos);
+  ASSERT_NE(Missing.find("\"missing\":[\"/nonexistent/file.bolt\"]"), std::string::npos);
+  auto Unknown = request(Server, "frobnicate");
+  ASSERT_NE(Unknown.find("unknown request 'frobnicate'"), std::string::npos);
+  std::ostringstream Out;
+  ASSERT_FALSE(Server.handle("shutdown", Out));
+}
@@ -0,0 +1,28 @@
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "bolt/Statistics.hpp"
+
+using namespace bolt;
+
+TEST(StatisticsTest, AccumulatesCountersByName) {
+  Statistics Stats { true };
+  Stats.addCount("tokens", 10);
+  Stats.addCount("nodes", 3);
+  Stats.addCount("tokens", 5);
+  std::ostringstream Out;
+  Stats.writeJSON(Out, false, true);
+  ASSERT_EQ(Out.str(), "{\"counters\":{\"tokens\":15,\"nodes\":3}}\n");
+}
+
+TEST(StatisticsTest, DisabledTimersRecordNothing) {
+  Statistics Stats;
+  {
+    ScopedTimer T { Stats, "parse" };
+  }
+  std::ostringstream Out;
+  Stats.writeJSON(Out, true, false);
+  ASSERT_EQ(Out.str(), "{\"timers\":{}}\n");
+}
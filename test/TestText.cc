@@ -45,3 +45,25 @@ TEST(TextFileTest, ReportsCorrectColumn) {
   ASSERT_EQ(T1.getColumn(10), 3);
   ASSERT_EQ(T1.getColumn(11), 4);
 }
+
+static void expectSameLines(const TextFile& Actual, const TextFile& Expected) {
+  ASSERT_EQ(Actual.getText(), Expected.getText());
+  ASSERT_EQ(Actual.getLineCount(), Expected.getLineCount());
+  for (size_t Line = 1; Line <= Expected.getLineCount() + 1; Line++) {
+    ASSERT_EQ(Actual.getStartOffsetOfLine(Line), Expected.getStartOffsetOfLine(Line));
+  }
+}
+
+TEST(TextFileTest, UpdatesLinesAfterReplace) {
+  TextFile T1 { "foo.txt", "bar\nbaz\nbax\n" };
+  T1.replace(4, 7, "a\nb\nc");
+  expectSameLines(T1, TextFile { "foo.txt", "bar\na\nb\nc\nbax\n" });
+  T1.replace(5, 10, "");
+  expectSameLines(T1, TextFile { "foo.txt", "bar\nabax\n" });
+  T1.replace(0, 0, "\n");
+  expectSameLines(T1, TextFile { "foo.txt", "\nbar\nabax\n" });
+  T1.replace(10, 10, "qux");
+  expectSameLines(T1, TextFile { "foo.txt", "\nbar\nabax\nqux" });
+  ASSERT_EQ(T1.getLine(11), 4);
+  ASSERT_EQ(T1.getColumn(12), 3);
+}
@@ -0,0 +1,55 @@
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/Scanner.hpp"
+#include "bolt/Parser.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/Trace.hpp"
+
+using namespace bolt;
+
+TEST(TraceTest, WritesCompleteEvents) {
+  std::ostringstream Out;
+  {
+    TraceWriter W { Out };
+    TraceEvent Event { &W, "checker", "solve" };
+    Event.addArg("file", "a \"quoted\" name.bolt");
+  }
+  auto Text = Out.str();
+  ASSERT_EQ(Text.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["), 0);
+  ASSERT_NE(Text.find("{\"name\":\"solve\",\"cat\":\"checker\",\"ph\":\"X\""), std::string::npos);
+  ASSERT_NE(Text.find("\"args\":{\"file\":\"a \\\"quoted\\\" name.bolt\"}"), std::string::npos);
+  ASSERT_EQ(Text.substr(Text.size() - 4), "\n]}\n");
+}
+
+TEST(TraceTest, RecordsEachDeclarationAndBindingGroup) {
+  std::string Input =
+    "let even n : Int -> Bool = odd (n - 1)\n"
+    "let odd n : Int -> Bool = even (n - 1)\n";
+  DiagnosticStore DS;
+  TextFile T { "mutual.bolt", Input };
+  VectorStream<std::string, Char> Chars { Input, EOF };
+  Scanner S(DS, T, Chars);
+  Punctuator PT(S);
+  Parser P(T, PT, DS);
+  LanguageConfig Config;
+  auto SF = P.parseSourceFile();
+  SF->setParents();
+  std::ostringstream Out;
+  {
+    TraceWriter W { Out };
+    Checker C { Config, DS };
+    C.setTrace(&W);
+    C.check(SF);
+  }
+  auto Text = Out.str();
+  ASSERT_NE(Text.find("\"cat\":\"infer\""), std::string::npos);
+  ASSERT_NE(Text.find("\"declaration\":\"even\",\"file\":\"mutual.bolt\",\"range\":\"1:1-1:"), std::string::npos);
+  ASSERT_NE(Text.find("\"declaration\":\"odd\",\"file\":\"mutual.bolt\",\"range\":\"2:1-2:"), std::string::npos);
+  ASSERT_NE(Text.find("\"cat\":\"scc\""), std::string::npos);
+  ASSERT_NE(Text.find("\"name\":\"solve\""), std::string::npos);
+}
@@ -0,0 +1,70 @@
+
+#include "gtest/gtest.h"
+
+#include "bolt/CST.hpp"
+#include "bolt/DiagnosticEngine.hpp"
+#include "bolt/Scanner.hpp"
+#include "bolt/Parser.hpp"
+#include "bolt/Checker.hpp"
+#include "bolt/Evaluator.hpp"
+#include "bolt/Workload.hpp"
+
+#include "Helpers.hpp"
+
+using namespace bolt;
+
+static std::size_t countDiagnostics(std::string Input) {
+  DiagnosticStore DS;
+  TextFile T { "#<workload>", Input };
+  VectorStream<std::string, Char> Chars { Input, EOF };
+  Scanner S(DS, T, Chars);
+  Punctuator PT(S);
+  Parser P(T, PT, DS);
+  LanguageConfig Config;
+  auto SF = P.parseSourceFile();
+  if (SF == nullptr) {
+    return DS.countDiagnostics() + 1;
+  }
+  SF->setParents();
+  Checker C { Config, DS };
+  C.check(SF);
+  return DS.countDiagnostics();
+}
+
+TEST(WorkloadTest, GeneratesWellTypedPrograms) {
+  WorkloadOptions Options;
+  Options.Functions = 5;
+  Options.LetDepth = 4;
+  Options.CycleLength = 3;
+  Options.Recursions = 2;
+  Options.RecordWidth = 6;
+  Options.MatchCases = 7;
+  Options.ClassUses = 4;
+  Options.Tuples = 2;
+  Options.Repeat = 2;
+  ASSERT_EQ(countDiagnostics(generateWorkload(Options)), 0);
+}
+
+TEST(WorkloadTest, RepeatsUntilMinimumSize) {
+  WorkloadOptions Options;
+  Options.Functions = 1;
+  Options.MinSize = 4096;
+  ASSERT_GE(generateWorkload(Options).size(), 4096);
+  Options.Functions = 0;
+  ASSERT_EQ(generateWorkload(Options).size(), 0);
+}
+
+TEST(WorkloadTest, GeneratesProgramsThatEvaluateRecursiveCalls) {
+  WorkloadOptions Options;
+  Options.CycleLength = 3;
+  Options.Recursions = 2;
+  auto F = checkSourceFile(generateWorkload(Options));
+  ASSERT_EQ(F.DS.countDiagnostics(), 0);
+  Evaluator E { &F.C, std::cout };
+  Env GlobalEnv;
+  addBuiltins(GlobalEnv);
+  E.evaluate(F.SF, GlobalEnv);
+  ASSERT_EQ(GlobalEnv.lookup("cr0").asInteger(), 1);
+  ASSERT_EQ(GlobalEnv.lookup("dr0_0").asInteger(), 1024);
+  ASSERT_EQ(GlobalEnv.lookup("dr0_1").asInteger(), 3070);
+}